@@ -90,6 +90,7 @@ InstEditBackend::update_instrument (const Instrument *instrument, const string&
 {
   WavSetBuilder *builder = new WavSetBuilder (instrument, true);
   builder->set_cache_group (cache_group.get());
+  builder->set_n_threads (0); // rebuild latency matters while editing: use all cpu cores
 
   builder_thread.kill_all_jobs();
 
@@ -130,7 +131,7 @@ InstEditBackend::on_timer()
       Index index;
       index.load_file ("instruments:standard");
 
-      WavSet *ref_wav_set = WavSetRepo::the()->get (index.smset_dir() + "/" + reference);
+      std::shared_ptr<WavSet> ref_wav_set = WavSetRepo::the()->get (index.smset_dir() + "/" + reference);
 
       synth_interface->synth_inst_edit_update (true, result_wav_set.release(), ref_wav_set);
     }
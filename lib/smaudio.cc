@@ -4,15 +4,16 @@
 #include "smoutfile.hh"
 #include "sminfile.hh"
 #include "smstdioout.hh"
-#include "smmemout.hh"
-#include "smmmapin.hh"
 #include "smwavsetrepo.hh"
 #include "smaudiotool.hh"
+#include "smframecodec.hh"
 #include <fcntl.h>
 #include <errno.h>
 #include <stdio.h>
 #include <assert.h>
 
+#include <algorithm>
+
 using std::string;
 using std::vector;
 
@@ -39,39 +40,144 @@ SpectMorph::Audio::load (const string& filename, AudioLoadOptions load_options)
   return load (file, load_options);
 }
 
-Error
-SpectMorph::Audio::load (GenericInP file, AudioLoadOptions load_options)
+namespace
 {
-  SpectMorph::AudioBlock *audio_block = NULL;
 
-  InFile ifile (file);
+/* event names used in SpectMorph::Audio files, interned in this order (see InFile::intern) */
+enum AudioEventID
+{
+  EV_HEADER,
+  EV_FRAME,
+  EV_ZEROPAD,
+  EV_LOOP_START,
+  EV_LOOP_END,
+  EV_LOOP_TYPE,
+  EV_ZERO_VALUES_AT_START,
+  EV_SAMPLE_COUNT,
+  EV_FRAME_COUNT,
+  EV_MIX_FREQ,
+  EV_FRAME_SIZE_MS,
+  EV_FRAME_STEP_MS,
+  EV_ATTACK_START_MS,
+  EV_ATTACK_END_MS,
+  EV_FUNDAMENTAL_FREQ,
+  EV_ORIGINAL_SAMPLES_NORM_DB,
+  EV_ENV_F0,
+  EV_ORIGINAL_SAMPLES,
+  EV_ORIGINAL_FFT,
+  EV_DEBUG_SAMPLES,
+  EV_FREQS,
+  EV_MAGS,
+  EV_PHASES,
+  EV_ENV,
+  EV_NOISE,
+  EV_COMPRESSED_FRAMES
+};
+
+const char *const audio_event_names[] =
+{
+  "header", "frame", "zeropad", "loop_start", "loop_end", "loop_type", "zero_values_at_start",
+  "sample_count", "frame_count", "mix_freq", "frame_size_ms", "frame_step_ms", "attack_start_ms",
+  "attack_end_ms", "fundamental_freq", "original_samples_norm_db", "env_f0", "original_samples",
+  "original_fft", "debug_samples", "freqs", "mags", "phases", "env", "noise",
+  "compressed_frames"
+};
+
+/* ensure that freqs are sorted (we need that for LiveDecoder) */
+bool
+frames_sorted (const vector<AudioBlock>& contents, size_t start, size_t end)
+{
+  for (size_t f = start; f < end; f++)
+    {
+      if (!std::is_sorted (contents[f].freqs.begin(), contents[f].freqs.end()))
+        {
+          printf ("frequency data is not sorted, can't play file\n");
+          return false;
+        }
+    }
+  return true;
+}
+
+}
 
-  string section;
-  size_t contents_pos = 0; /* init to get rid of gcc warning */
+/**
+ * This function loads a SM-File from a GenericIn object.
+ *
+ * \param file the input stream to read the SM-File from
+ * \param load_options specify whether to load or skip debug information
+ * \param max_frames if smaller than the number of frames, only the first max_frames frames
+ * are loaded; the remaining frames can be loaded on demand (see AudioLazyFrames), as long
+ * as the data of the input stream stays valid
+ * \returns a SpectMorph::Error indicating whether loading was successful
+ */
+Error
+SpectMorph::Audio::load (GenericInP file, AudioLoadOptions load_options, size_t max_frames)
+{
+  /* for lazy loading, the InFile is needed after load() (see AudioLazyFrames) */
+  std::unique_ptr<InFile> ifile (new InFile (file));
 
-  if (!ifile.open_ok())
+  if (!ifile->open_ok())
     return Error::Code::FILE_NOT_FOUND;
 
-  if (ifile.file_type() != "SpectMorph::Audio")
+  if (ifile->file_type() != "SpectMorph::Audio")
     return Error::Code::FORMAT_INVALID;
 
-  if (ifile.file_version() != SPECTMORPH_BINARY_FILE_VERSION)
+  if (ifile->file_version() != SPECTMORPH_BINARY_FILE_VERSION &&
+      ifile->file_version() != SPECTMORPH_COMPRESSED_FILE_VERSION)
     return Error::Code::FORMAT_INVALID;
 
-  if (load_options == AUDIO_SKIP_DEBUG)
+  for (size_t id = 0; id < std::size (audio_event_names); id++)
+    {
+      const int interned_id = ifile->intern (audio_event_names[id]);
+      assert (interned_id == int (id));
+    }
+
+  if (load_options != AUDIO_LOAD_DEBUG)
     {
-      ifile.add_skip_event ("original_fft");
-      ifile.add_skip_event ("debug_samples");
+      ifile->add_skip_event ("original_fft");
+      ifile->add_skip_event ("debug_samples");
     }
 
+  lazy_frames.reset();
+
+  size_t contents_pos = 0;
+  Error error = load_events (*ifile, contents_pos, max_frames);
+  if (error)
+    return error;
+
+  if (contents_pos == max_frames && contents_pos < contents.size())
+    {
+      /* partial load: for compressed frames, load_events() already created the decoder state */
+      if (!lazy_frames)
+        {
+          lazy_frames.reset (new AudioLazyFrames());
+          lazy_frames->ifile = std::move (ifile);
+        }
+      lazy_frames->lookahead = max_frames;
+      lazy_frames->available.store (contents_pos);
+      lazy_frames->wanted.store (contents_pos);
+    }
+  return Error::Code::NONE;
+}
+
+/* parses events until the end of the file or until contents_pos reaches max_frames */
+Error
+SpectMorph::Audio::load_events (InFile& ifile, size_t& contents_pos, size_t max_frames)
+{
+  SpectMorph::AudioBlock *audio_block = NULL;
+
+  /* section: NO_SECTION or the event id of the section name (UNKNOWN_ID for unknown sections) */
+  const int NO_SECTION = -2;
+  int section = NO_SECTION;
+
   while (ifile.event() != InFile::END_OF_FILE)
     {
       if (ifile.event() == InFile::BEGIN_SECTION)
         {
-          assert (section == "");
-          section = ifile.event_name();
+          assert (section == NO_SECTION);
+          section = ifile.event_id();
 
-          if (section == "frame")
+          if (section == EV_FRAME)
             {
               assert (audio_block == NULL);
               assert (contents_pos < contents.size());
@@ -81,7 +187,7 @@ SpectMorph::Audio::load (GenericInP file, AudioLoadOptions load_options)
         }
       else if (ifile.event() == InFile::END_SECTION)
         {
-          if (section == "frame")
+          if (section == EV_FRAME)
             {
               assert (audio_block);
 
@@ -89,26 +195,32 @@ SpectMorph::Audio::load (GenericInP file, AudioLoadOptions load_options)
               audio_block = NULL;
             }
 
-          assert (section != "");
-          section = "";
+          assert (section != NO_SECTION);
+          section = NO_SECTION;
+
+          /* partial load: the remaining frames are not needed (yet) */
+          if (contents_pos == max_frames)
+            break;
         }
       else if (ifile.event() == InFile::INT)
         {
-          if (section == "header")
+          if (section == EV_HEADER)
             {
-              if (ifile.event_name() == "zeropad")
+              const int id = ifile.event_id();
+
+              if (id == EV_ZEROPAD)
                 zeropad = ifile.event_int();
-              else if (ifile.event_name() == "loop_start")
+              else if (id == EV_LOOP_START)
                 loop_start = ifile.event_int();
-              else if (ifile.event_name() == "loop_end")
+              else if (id == EV_LOOP_END)
                 loop_end = ifile.event_int();
-              else if (ifile.event_name() == "loop_type")
+              else if (id == EV_LOOP_TYPE)
                 loop_type = static_cast<LoopType> (ifile.event_int());
-              else if (ifile.event_name() == "zero_values_at_start")
+              else if (id == EV_ZERO_VALUES_AT_START)
                 zero_values_at_start = ifile.event_int();
-              else if (ifile.event_name() == "sample_count")
+              else if (id == EV_SAMPLE_COUNT)
                 sample_count = ifile.event_int();
-              else if (ifile.event_name() == "frame_count")
+              else if (id == EV_FRAME_COUNT)
                 {
                   int frame_count = ifile.event_int();
 
@@ -117,79 +229,82 @@ SpectMorph::Audio::load (GenericInP file, AudioLoadOptions load_options)
                   contents_pos = 0;
                 }
               else
-                printf ("unhandled int %s %s\n", section.c_str(), ifile.event_name().c_str());
+                printf ("unhandled int header %s\n", ifile.event_name().c_str());
             }
           else
             assert (false);
         }
       else if (ifile.event() == InFile::FLOAT)
         {
-          if (section == "header")
+          if (section == EV_HEADER)
             {
-              if (ifile.event_name() == "mix_freq")
+              const int id = ifile.event_id();
+
+              if (id == EV_MIX_FREQ)
                 mix_freq = ifile.event_float();
-              else if (ifile.event_name() == "frame_size_ms")
+              else if (id == EV_FRAME_SIZE_MS)
                 frame_size_ms = ifile.event_float();
-              else if (ifile.event_name() == "frame_step_ms")
+              else if (id == EV_FRAME_STEP_MS)
                 frame_step_ms = ifile.event_float();
-              else if (ifile.event_name() == "attack_start_ms")
+              else if (id == EV_ATTACK_START_MS)
                 attack_start_ms = ifile.event_float();
-              else if (ifile.event_name() == "attack_end_ms")
+              else if (id == EV_ATTACK_END_MS)
                 attack_end_ms = ifile.event_float();
-              else if (ifile.event_name() == "fundamental_freq")
+              else if (id == EV_FUNDAMENTAL_FREQ)
                 fundamental_freq = ifile.event_float();
-              else if (ifile.event_name() == "original_samples_norm_db")
+              else if (id == EV_ORIGINAL_SAMPLES_NORM_DB)
                 original_samples_norm_db = ifile.event_float();
               else
-                printf ("unhandled float %s  %s\n", section.c_str(), ifile.event_name().c_str());
+                printf ("unhandled float header  %s\n", ifile.event_name().c_str());
             }
-          else if (section == "frame")
+          else if (section == EV_FRAME)
             {
-              if (ifile.event_name() == "env_f0")
+              if (ifile.event_id() == EV_ENV_F0)
                 audio_block->env_f0 = ifile.event_float();
               else
-                printf ("unhandled float %s  %s\n", section.c_str(), ifile.event_name().c_str());
+                printf ("unhandled float frame  %s\n", ifile.event_name().c_str());
             }
           else
             assert (false);
         }
       else if (ifile.event() == InFile::FLOAT_BLOCK)
         {
-          const vector<float>& fb = ifile.event_float_block();
-
-          if (section == "header")
+          if (section == EV_HEADER)
             {
-              if (ifile.event_name() == "original_samples")
+              if (ifile.event_id() == EV_ORIGINAL_SAMPLES)
                 {
-                  original_samples = fb;
+                  ifile.read_event_float_block (original_samples);
                 }
               else
-                printf ("unhandled float block %s  %s\n", section.c_str(), ifile.event_name().c_str());
+                printf ("unhandled float block header  %s\n", ifile.event_name().c_str());
             }
           else
             {
               assert (audio_block != NULL);
-              if (ifile.event_name() == "original_fft")
+              if (ifile.event_id() == EV_ORIGINAL_FFT)
                 {
-                  audio_block->original_fft = fb;
+                  ifile.read_event_float_block (audio_block->original_fft);
                 }
-              else if (ifile.event_name() == "debug_samples")
+              else if (ifile.event_id() == EV_DEBUG_SAMPLES)
                 {
-                  audio_block->debug_samples = fb;
+                  ifile.read_event_float_block (audio_block->debug_samples);
                 }
               else
                 {
-                  printf ("unhandled fblock %s %s\n", section.c_str(), ifile.event_name().c_str());
+                  printf ("unhandled fblock %s\n", ifile.event_name().c_str());
                   assert (false);
                 }
             }
         }
       else if (ifile.event() == InFile::UINT16_BLOCK)
         {
-          const vector<uint16_t>& ib = ifile.event_uint16_block();
-          if (ifile.event_name() == "freqs")
+          const int id = ifile.event_id();
+
+          if (id == EV_FREQS)
             {
-              audio_block->freqs = ib;
+              /* read directly into the frame (no intermediate copy) */
+              vector<uint16_t>& ib = audio_block->freqs;
+              ifile.read_event_uint16_block (ib);
 
               // ensure that freqs are sorted (we need that for LiveDecoder)
               int old_freq = -1;
@@ -204,28 +319,69 @@ SpectMorph::Audio::load (GenericInP file, AudioLoadOptions load_options)
                   old_freq = ib[i];
                 }
             }
-          else if (ifile.event_name() == "mags")
+          else if (id == EV_MAGS)
             {
-              audio_block->mags = ib;
+              ifile.read_event_uint16_block (audio_block->mags);
             }
-          else if (ifile.event_name() == "phases")
+          else if (id == EV_PHASES)
             {
-              audio_block->phases = ib;
+              ifile.read_event_uint16_block (audio_block->phases);
             }
-          else if (ifile.event_name() == "env")
+          else if (id == EV_ENV)
             {
-              audio_block->env = ib;
+              ifile.read_event_uint16_block (audio_block->env);
             }
-          else if (ifile.event_name() == "noise")
+          else if (id == EV_NOISE)
             {
-              audio_block->noise = ib;
+              ifile.read_event_uint16_block (audio_block->noise);
             }
           else
             {
-              printf ("unhandled int16 block %s %s\n", section.c_str(), ifile.event_name().c_str());
+              printf ("unhandled int16 block %s\n", ifile.event_name().c_str());
               assert (false);
             }
         }
+      else if (ifile.event() == InFile::BLOB && section == EV_HEADER && ifile.event_id() == EV_COMPRESSED_FRAMES)
+        {
+          /* all frames in one blob, see FrameCodec */
+          GenericInP blob_in = ifile.open_blob();
+          if (!blob_in)
+            return Error::Code::PARSE_ERROR;
+
+          vector<unsigned char> blob_data;
+          size_t blob_size;
+          const unsigned char *blob_mem = blob_in->mmap_mem (blob_size);
+          if (!blob_mem) /* slow variant for the non-mmap case */
+            {
+              int ch;
+              while ((ch = blob_in->get_byte()) >= 0)
+                blob_data.push_back (ch);
+
+              blob_mem  = blob_data.data();
+              blob_size = blob_data.size();
+            }
+          const size_t n_frames = std::min (contents.size(), max_frames);
+
+          std::unique_ptr<FrameCodec::Decoder> decoder (new FrameCodec::Decoder());
+          if (!decoder->init (blob_mem, blob_size, contents.size()) || !decoder->decode (contents, n_frames))
+            return Error::Code::PARSE_ERROR;
+
+          if (!frames_sorted (contents, 0, n_frames))
+            return Error::Code::PARSE_ERROR;
+
+          if (n_frames < contents.size())
+            {
+              /* partial load: keep decoder (and data) to decode the remaining frames later */
+              lazy_frames.reset (new AudioLazyFrames());
+              lazy_frames->decoder = std::move (decoder);
+              if (blob_data.empty())
+                lazy_frames->compressed_in = blob_in;
+              else
+                lazy_frames->compressed_data = std::move (blob_data); // moving doesn't change the data pointer
+            }
+          contents_pos = n_frames;
+          compress_frames = true;
+        }
       else if (ifile.event() == InFile::READ_ERROR)
         {
           return Error::Code::PARSE_ERROR;
@@ -257,10 +413,32 @@ SpectMorph::Audio::save (const string& filename) const
   return save (out);
 }
 
+/**
+ * Files with compressed frames get a different file version, so that older versions
+ * of SpectMorph (which can't decode them) reject these files.
+ *
+ * \returns the file version save() uses for this Audio object
+ */
+int
+SpectMorph::Audio::save_file_version() const
+{
+  if (compress_frames && FrameCodec::can_encode (contents))
+    return SPECTMORPH_COMPRESSED_FILE_VERSION;
+
+  return SPECTMORPH_BINARY_FILE_VERSION;
+}
+
 Error
 SpectMorph::Audio::save (GenericOutP file) const
 {
-  OutFile of (file, "SpectMorph::Audio", SPECTMORPH_BINARY_FILE_VERSION);
+  if (mapped_frames)
+    {
+      /* frame data is in the mapped file, save a copy that has it in contents */
+      std::unique_ptr<Audio> audio_copy (clone());
+      return audio_copy->save (file);
+    }
+
+  OutFile of (file, "SpectMorph::Audio", save_file_version());
   assert (of.open_ok());
 
   of.begin_section ("header");
@@ -279,7 +457,6 @@ SpectMorph::Audio::save (GenericOutP file) const
   of.write_int ("frame_count", contents.size());
   of.write_int ("sample_count", sample_count);
   of.write_float_block ("original_samples", original_samples);
-  of.end_section();
 
   for (size_t i = 0; i < contents.size(); i++)
     {
@@ -291,7 +468,20 @@ SpectMorph::Audio::save (GenericOutP file) const
           assert (contents[i].freqs[f] >= old_freq);
           old_freq = contents[i].freqs[f];
         }
+    }
 
+  /* frames with debug information are always stored uncompressed */
+  const bool compressed = save_file_version() == SPECTMORPH_COMPRESSED_FILE_VERSION;
+  if (compressed)
+    {
+      vector<unsigned char> frame_data;
+      FrameCodec::encode (contents, frame_data);
+      of.write_blob ("compressed_frames", frame_data.data(), frame_data.size());
+    }
+  of.end_section();
+
+  for (size_t i = 0; i < contents.size() && !compressed; i++)
+    {
       of.begin_section ("frame");
       of.write_uint16_block ("noise", contents[i].noise);
       of.write_uint16_block ("freqs", contents[i].freqs);
@@ -309,15 +499,215 @@ SpectMorph::Audio::save (GenericOutP file) const
 Audio *
 Audio::clone() const
 {
-  // create a deep copy (by saving/loading)
-  vector<unsigned char> audio_data;
-  save (MemOut::open (&audio_data));
-
+  // create a deep copy (copying is a lot faster than saving/loading)
   Audio *audio_clone = new Audio();
-  audio_clone->load (MMapIn::open_vector (audio_data));
+
+  audio_clone->fundamental_freq         = fundamental_freq;
+  audio_clone->mix_freq                 = mix_freq;
+  audio_clone->frame_size_ms            = frame_size_ms;
+  audio_clone->frame_step_ms            = frame_step_ms;
+  audio_clone->attack_start_ms          = attack_start_ms;
+  audio_clone->attack_end_ms            = attack_end_ms;
+  audio_clone->zeropad                  = zeropad;
+  audio_clone->loop_type                = loop_type;
+  audio_clone->loop_start               = loop_start;
+  audio_clone->loop_end                 = loop_end;
+  audio_clone->zero_values_at_start     = zero_values_at_start;
+  audio_clone->sample_count             = sample_count;
+  audio_clone->original_samples         = original_samples;
+  audio_clone->original_samples_norm_db = original_samples_norm_db;
+  audio_clone->contents                 = contents;
+  if (mapped_frames)
+    {
+      audio_clone->contents.resize (mapped_frames->frames.size());
+      for (size_t f = 0; f < mapped_frames->frames.size(); f++)
+        mapped_frames->copy_frame (f, audio_clone->contents[f]);
+    }
+  audio_clone->compress_frames          = compress_frames;
+
+  if (float_cache)
+    audio_clone->build_float_cache();
   return audio_clone;
 }
 
+AudioLazyFrames::AudioLazyFrames()
+{
+}
+
+AudioLazyFrames::~AudioLazyFrames()
+{
+}
+
+/**
+ * Checks if playback needs frames of a lazily loaded Audio object that are not
+ * available yet (see request_frames()).
+ */
+bool
+Audio::lazy_frames_wanted() const
+{
+  if (!lazy_frames || (!lazy_frames->ifile && !lazy_frames->decoder))
+    return false;
+
+  return lazy_frames->wanted.load() > lazy_frames->available.load();
+}
+
+/**
+ * Loads the frames of a lazily loaded Audio object that were requested but are not
+ * available yet (see AudioLazyFrames). Only these frames are parsed, continuing where
+ * the last call stopped. Frames are published in chunks, so playback can use them
+ * before loading is complete.
+ */
+Error
+Audio::load_lazy_frames()
+{
+  if (!lazy_frames_wanted())
+    return Error::Code::NONE;
+
+  const size_t CHUNK_SIZE = 64;
+  const size_t end_frame  = lazy_frames->wanted.load();
+
+  /* frames that are not available yet are not used by other threads, so we can modify them */
+  size_t frame = lazy_frames->available.load();
+  Error  error = Error::Code::NONE;
+  while (frame < end_frame && !error)
+    {
+      const size_t chunk_end = std::min (frame + CHUNK_SIZE, end_frame);
+
+      if (lazy_frames->decoder)
+        {
+          if (!lazy_frames->decoder->decode (contents, chunk_end) || !frames_sorted (contents, frame, chunk_end))
+            error = Error::Code::PARSE_ERROR;
+        }
+      else
+        {
+          InFile& ifile = *lazy_frames->ifile;
+          ifile.next_event(); // skip end of the last frame loaded
+
+          size_t contents_pos = frame;
+          error = load_events (ifile, contents_pos, chunk_end);
+          if (!error && contents_pos != chunk_end) // file too short
+            error = Error::Code::PARSE_ERROR;
+        }
+      if (!error)
+        {
+          lazy_frames->available.store (chunk_end, std::memory_order_release);
+          frame = chunk_end;
+        }
+    }
+  if (error || frame == contents.size())
+    {
+      /* done (or can't continue): close input */
+      lazy_frames->ifile.reset();
+      lazy_frames->decoder.reset();
+      lazy_frames->compressed_in.reset();
+      lazy_frames->compressed_data = vector<unsigned char>();
+    }
+  return error;
+}
+
+void
+Audio::build_float_cache()
+{
+  float_cache.reset (new AudioFloatCache (*this));
+}
+
+AudioFloatCache::AudioFloatCache (const Audio& audio)
+{
+  /* start each frame at a multiple of 4 floats */
+  auto align = [] (size_t n) { return (n + 3) & ~size_t (3); };
+
+  const size_t n_frames = audio.n_frames();
+  size_t       n_floats = 0;
+  for (size_t f = 0; f < n_frames; f++)
+    {
+      m_frame_start.push_back (n_floats);
+      n_floats += align (audio.mapped_frames ? audio.mapped_frames->frames[f].n_freqs : audio.contents[f].freqs.size());
+    }
+  m_freqs.resize (n_floats);
+  m_mags.resize (n_floats);
+
+  for (size_t f = 0; f < n_frames; f++)
+    {
+      const uint16_t *ifreqs, *imags;
+      size_t          n_freqs;
+      if (audio.mapped_frames)
+        {
+          const AudioMappedFrames::Frame& frame = audio.mapped_frames->frames[f];
+
+          ifreqs  = frame.freqs;
+          imags   = frame.mags;
+          n_freqs = frame.n_freqs;
+        }
+      else
+        {
+          const AudioBlock& block = audio.contents[f];
+
+          ifreqs  = block.freqs.data();
+          imags   = block.mags.data();
+          n_freqs = block.freqs.size();
+        }
+
+      float *freqs = m_freqs.data() + m_frame_start[f];
+      float *mags = m_mags.data() + m_frame_start[f];
+      for (size_t i = 0; i < n_freqs; i++)
+        {
+          freqs[i] = sm_ifreq2freq (ifreqs[i]);
+          mags[i] = sm_idb2factor (imags[i]);
+        }
+    }
+}
+
+void
+AudioMappedFrames::copy_frame (size_t f, AudioBlock& block) const
+{
+  const Frame& frame = frames[f];
+
+  block.noise.assign (frame.noise, frame.noise + frame.n_noise);
+  block.freqs.assign (frame.freqs, frame.freqs + frame.n_freqs);
+  block.mags.assign (frame.mags, frame.mags + frame.n_freqs);
+  block.phases.assign (frame.phases, frame.phases + frame.n_phases);
+  block.env.assign (frame.env, frame.env + frame.n_env);
+  block.env_f0 = frame.env_f0;
+}
+
+size_t
+AudioFloatCache::mem_usage() const
+{
+  return (m_freqs.capacity() + m_mags.capacity()) * sizeof (float) + m_frame_start.capacity() * sizeof (size_t);
+}
+
+size_t
+AudioBlock::mem_usage() const
+{
+  size_t bytes = sizeof (AudioBlock);
+
+  bytes += (noise.capacity() + freqs.capacity() + mags.capacity() + phases.capacity() + env.capacity()) * sizeof (uint16_t);
+  bytes += (original_fft.capacity() + debug_samples.capacity()) * sizeof (float);
+  return bytes;
+}
+
+size_t
+Audio::mem_usage() const
+{
+  size_t bytes = sizeof (Audio);
+
+  bytes += original_samples.capacity() * sizeof (float);
+  bytes += contents.capacity() * sizeof (AudioBlock);
+
+  /* frames that are not yet loaded may be modified by the loader thread */
+  const size_t n_frames = std::min (frames_available(), contents.size());
+  for (size_t f = 0; f < n_frames; f++)
+    bytes += contents[f].mem_usage() - sizeof (AudioBlock);
+
+  /* the frame data itself is part of the mapped file, not of the heap */
+  if (mapped_frames)
+    bytes += sizeof (AudioMappedFrames) + mapped_frames->frames.capacity() * sizeof (AudioMappedFrames::Frame);
+
+  if (float_cache)
+    bytes += float_cache->mem_usage();
+  return bytes;
+}
+
 bool
 Audio::loop_type_to_string (LoopType loop_type, string& s)
 {
@@ -4,6 +4,9 @@
 #define SPECTMORPH_AUDIO_HH
 
 #include <vector>
+#include <memory>
+#include <atomic>
+#include <string>
 
 #include "smgenericin.hh"
 #include "smgenericout.hh"
@@ -12,6 +15,8 @@
 #include "smleakdebugger.hh"
 
 #define SPECTMORPH_BINARY_FILE_VERSION   14
+#define SPECTMORPH_MAPPED_FILE_VERSION   15 // see WavSet::save_mapped()
+#define SPECTMORPH_COMPRESSED_FILE_VERSION 16 // like SPECTMORPH_BINARY_FILE_VERSION, but may contain compressed frames
 #define SPECTMORPH_SUPPORT_MULTI_CHANNEL 0
 
 namespace SpectMorph
@@ -39,6 +44,7 @@ public:
 
   void    sort_freqs();
   double  estimate_fundamental (int n_partials = 1) const;
+  size_t  mem_usage() const;
 
   float
   freqs_f (size_t i) const
@@ -72,10 +78,105 @@ public:
   }
 };
 
+class Audio;
+
+/**
+ * \brief Sine frequencies and magnitudes of all frames of an Audio object, decoded to float
+ *
+ * Building the cache is optional (see Audio::build_float_cache()): it uses memory to
+ * avoid converting the uint16_t frame data to float for each frame on each voice during
+ * playback. The data of each frame starts at a 16 byte aligned offset.
+ */
+class AudioFloatCache
+{
+  std::vector<float>  m_freqs;
+  std::vector<float>  m_mags;
+  std::vector<size_t> m_frame_start;
+public:
+  AudioFloatCache (const Audio& audio);
+
+  const float *
+  freqs (size_t frame) const
+  {
+    return m_freqs.data() + m_frame_start[frame];
+  }
+  const float *
+  mags (size_t frame) const
+  {
+    return m_mags.data() + m_frame_start[frame];
+  }
+  size_t mem_usage() const;
+};
+
 enum AudioLoadOptions
 {
   AUDIO_LOAD_DEBUG,
-  AUDIO_SKIP_DEBUG
+  AUDIO_SKIP_DEBUG,
+  AUDIO_MAP_FRAMES  //!< skip debug information; frames of mapped wav sets are not copied (see AudioMappedFrames)
+};
+
+class InFile;
+
+namespace FrameCodec
+{
+  class Decoder;
+}
+
+/**
+ * \brief Loading state of an Audio object whose frames are loaded on demand
+ *
+ * Only the first frames are loaded initially (see Audio::load). During playback,
+ * Audio::request_frames() announces which frames will be needed soon (playback
+ * position plus lookahead), and a non-rt thread (see WavSetRepo) parses just these
+ * frames using Audio::load_lazy_frames(). Frames that are not yet available must
+ * not be accessed; the contents vector itself has its final size from the start,
+ * so available frames never move in memory.
+ */
+class AudioLazyFrames
+{
+public:
+  AudioLazyFrames();
+  ~AudioLazyFrames();
+
+  std::string         filename;         //!< file containing the audio data (for error messages)
+  size_t              lookahead = 0;    //!< number of frames to load ahead of the playback position
+  std::atomic<size_t> available { 0 };  //!< frames [0, available) are loaded
+  std::atomic<size_t> wanted { 0 };     //!< frames [0, wanted) are needed by playback
+
+  /* loader state, only used by Audio::load_lazy_frames(); freed once all frames are loaded */
+  std::unique_ptr<InFile>              ifile;            //!< uncompressed: positioned at the end of the last frame loaded
+  std::unique_ptr<FrameCodec::Decoder> decoder;          //!< compressed: decodes the remaining frames
+  GenericInP                           compressed_in;    //!< compressed: keeps the mapped data alive
+  std::vector<unsigned char>           compressed_data;  //!< compressed: data (if not mapped)
+};
+
+/**
+ * \brief Frame data of an Audio object that points into the memory of a mapped wav set file
+ *
+ * If a mapped wav set (see WavSet::save_mapped) is loaded using AUDIO_MAP_FRAMES, the
+ * frame data is not copied: the contents vector of the Audio object stays empty, and
+ * playback uses read-only views of the file data (see RTAudioBlock::assign_view). The
+ * WavSet keeps the file mapped for as long as its Audio objects exist.
+ */
+class AudioMappedFrames
+{
+public:
+  struct Frame
+  {
+    const uint16_t *noise;
+    const uint16_t *freqs;
+    const uint16_t *mags;     //!< n_freqs entries, like freqs
+    const uint16_t *phases;
+    const uint16_t *env;
+    uint32_t        n_noise;
+    uint32_t        n_freqs;
+    uint32_t        n_phases;
+    uint32_t        n_env;
+    float           env_f0;
+  };
+  std::vector<Frame> frames;
+
+  void copy_frame (size_t frame, AudioBlock& block) const;
 };
 
 /**
@@ -89,6 +190,8 @@ class Audio
 {
   SPECTMORPH_CLASS_NON_COPYABLE (Audio);
   LeakDebugger leak_debugger { "SpectMorph::Audio" };
+
+  Error load_events (InFile& ifile, size_t& contents_pos, size_t max_frames);
 public:
   Audio();
   enum LoopType {
@@ -116,14 +219,60 @@ public:
   std::vector<float> original_samples;            //!< original time domain signal as samples (debugging only)
   float    original_samples_norm_db = 0;          //!< normalization factor to be applied to original samples
   std::vector<AudioBlock> contents;               //!< the actual frame data
+  bool     compress_frames          = false;      //!< store frame data compressed (see FrameCodec)
+  std::unique_ptr<AudioFloatCache> float_cache;   //!< optional: frame data decoded to float (see build_float_cache)
+  std::unique_ptr<AudioLazyFrames> lazy_frames;   //!< optional: frames are loaded on demand (see WavSet::load)
+  std::unique_ptr<AudioMappedFrames> mapped_frames; //!< optional: frame data is in a mapped file, contents is empty
 
   Error load (const std::string& filename, AudioLoadOptions load_options = AUDIO_LOAD_DEBUG);
-  Error load (SpectMorph::GenericInP file, AudioLoadOptions load_options = AUDIO_LOAD_DEBUG);
+  Error load (SpectMorph::GenericInP file, AudioLoadOptions load_options = AUDIO_LOAD_DEBUG, size_t max_frames = SIZE_MAX);
   Error save (const std::string& filename) const;
   Error save (SpectMorph::GenericOutP file) const;
+  int   save_file_version() const;
 
   Audio *clone() const; // create a deep copy
 
+  void build_float_cache(); // contents must not be modified afterwards
+  size_t mem_usage() const;
+
+  /* number of frames, also for mapped frames */
+  size_t
+  n_frames() const
+  {
+    return mapped_frames ? mapped_frames->frames.size() : contents.size();
+  }
+
+  /* lazy loading: rt safe */
+  size_t
+  frames_available() const
+  {
+    return lazy_frames ? lazy_frames->available.load (std::memory_order_acquire) : n_frames();
+  }
+  /* returns frame or, if it is not yet loaded, the last frame that is available */
+  size_t
+  available_frame (size_t frame) const
+  {
+    if (lazy_frames)
+      return std::min (frame, frames_available() - 1);
+    return frame;
+  }
+  /* frame (and the following lookahead frames) will be needed soon */
+  void
+  request_frames (size_t frame)
+  {
+    if (lazy_frames)
+      {
+        const size_t wanted = std::min (frame + lazy_frames->lookahead, contents.size());
+
+        size_t old_wanted = lazy_frames->wanted.load();
+        while (old_wanted < wanted && !lazy_frames->wanted.compare_exchange_weak (old_wanted, wanted))
+          ;
+      }
+  }
+  /* lazy loading: not rt safe */
+  bool  lazy_frames_wanted() const;
+  Error load_lazy_frames();
+
   static bool loop_type_to_string (LoopType loop_type, std::string& s);
   static bool string_to_loop_type (const std::string& s, LoopType& loop_type);
 };
@@ -0,0 +1,500 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smaudiostream.hh"
+#include "sminfile.hh"
+#include "smmain.hh"
+
+#include <algorithm>
+
+#include <assert.h>
+
+using namespace SpectMorph;
+
+using std::string;
+using std::vector;
+
+static constexpr uint64_t LOW_MASK = 0xffffffff;
+
+AudioStream::AudioStream()
+{
+}
+
+Error
+AudioStream::open (const string& filename, int blob_index, size_t head_frames)
+{
+  m_file = GenericIn::open (filename);
+  if (!m_file)
+    return Error::Code::FILE_NOT_FOUND;
+
+  size_t file_size;
+  if (!m_file->mmap_mem (file_size))
+    return Error ("AudioStream: file could not be memory mapped");
+
+  if (blob_index < 0)
+    {
+      m_blob = m_file->open_subfile (0, file_size);
+    }
+  else
+    {
+      /* find audio blob in wav set file */
+      InFile ifile (m_file->open_subfile (0, file_size));
+      if (!ifile.open_ok())
+        return Error::Code::FILE_NOT_FOUND;
+
+      int index = 0;
+      while (ifile.event() != InFile::END_OF_FILE && !m_blob)
+        {
+          if (ifile.event() == InFile::READ_ERROR)
+            return Error::Code::PARSE_ERROR;
+
+          if (ifile.event() == InFile::BLOB && ifile.event_name() == "audio")
+            {
+              if (index == blob_index)
+                m_blob = ifile.open_blob();
+              index++;
+            }
+          ifile.next_event();
+        }
+    }
+  if (!m_blob || !m_blob->mmap_mem (m_blob_size))
+    return Error::Code::PARSE_ERROR;
+
+  /* header and head frames */
+  Error error = m_audio.load (m_blob->open_subfile (0, m_blob_size), AUDIO_SKIP_DEBUG, head_frames);
+  if (error)
+    return error;
+
+  if (m_audio.compress_frames)
+    return Error ("AudioStream: compressed frames can not be streamed");
+
+  m_n_frames = m_audio.contents.size();
+  if (m_n_frames > LOW_MASK)
+    return Error::Code::FORMAT_INVALID;
+
+  m_audio.lazy_frames.reset(); // frames after the head frames are streamed (see read_frame), not loaded lazily
+  m_audio.contents.resize (std::min (head_frames, m_n_frames));
+  m_audio.contents.shrink_to_fit();
+
+  /* build frame index: memory mapped parsing only copies data that is read, so this is fast */
+  GenericInP in = m_blob->open_subfile (0, m_blob_size);
+  InFile ifile (in);
+
+  const int frame_id = ifile.intern ("frame");
+  ifile.add_skip_event ("original_fft");
+  ifile.add_skip_event ("debug_samples");
+  ifile.add_skip_event ("original_samples");
+
+  m_frame_pos.clear();
+  m_frame_pos.reserve (m_n_frames);
+  while (ifile.event() != InFile::END_OF_FILE)
+    {
+      if (ifile.event() == InFile::READ_ERROR)
+        return Error::Code::PARSE_ERROR;
+
+      if (ifile.event() == InFile::BEGIN_SECTION && ifile.event_id() == frame_id)
+        m_frame_pos.push_back (in->get_pos());
+
+      ifile.next_event();
+    }
+  if (m_frame_pos.size() != m_n_frames)
+    return Error::Code::PARSE_ERROR;
+
+  return Error::Code::NONE;
+}
+
+Audio *
+AudioStream::audio()
+{
+  return &m_audio;
+}
+
+size_t
+AudioStream::n_frames() const
+{
+  return m_n_frames;
+}
+
+size_t
+AudioStream::head_frames() const
+{
+  return m_audio.contents.size();
+}
+
+size_t
+AudioStream::mem_usage() const
+{
+  return m_audio.mem_usage() + m_frame_pos.capacity() * sizeof (size_t);
+}
+
+bool
+AudioStream::read_frame (size_t frame, AudioBlock& block) const
+{
+  assert (frame < m_frame_pos.size());
+
+  const size_t pos = m_frame_pos[frame];
+
+  /* parse the events of one frame section (file starts after the begin section event) */
+  InFile ifile (m_blob->open_subfile (pos, m_blob_size - pos), "SpectMorph::Audio", SPECTMORPH_BINARY_FILE_VERSION);
+
+  const int noise_id  = ifile.intern ("noise");
+  const int freqs_id  = ifile.intern ("freqs");
+  const int mags_id   = ifile.intern ("mags");
+  const int phases_id = ifile.intern ("phases");
+  const int env_id    = ifile.intern ("env");
+  const int env_f0_id = ifile.intern ("env_f0");
+  ifile.add_skip_event ("original_fft");
+  ifile.add_skip_event ("debug_samples");
+
+  /* reuse memory of the vectors */
+  block.noise.clear();
+  block.freqs.clear();
+  block.mags.clear();
+  block.phases.clear();
+  block.env.clear();
+  block.env_f0 = 0;
+
+  while (ifile.event() != InFile::END_SECTION)
+    {
+      const int id = ifile.event_id();
+
+      if (ifile.event() == InFile::UINT16_BLOCK)
+        {
+          if (id == noise_id)
+            ifile.read_event_uint16_block (block.noise);
+          else if (id == freqs_id)
+            ifile.read_event_uint16_block (block.freqs);
+          else if (id == mags_id)
+            ifile.read_event_uint16_block (block.mags);
+          else if (id == phases_id)
+            ifile.read_event_uint16_block (block.phases);
+          else if (id == env_id)
+            ifile.read_event_uint16_block (block.env);
+        }
+      else if (ifile.event() == InFile::FLOAT && id == env_f0_id)
+        {
+          block.env_f0 = ifile.event_float();
+        }
+      else if (ifile.event() != InFile::FLOAT_BLOCK)
+        {
+          return false;
+        }
+      ifile.next_event();
+    }
+  return block.freqs.size() == block.mags.size();
+}
+
+AudioStreamReader::AudioStreamReader (std::shared_ptr<AudioStream> stream, size_t ring_frames) :
+  m_stream (stream),
+  m_ring (ring_frames)
+{
+  assert (ring_frames > 0);
+
+  m_request.store (m_stream->head_frames());
+  m_consumed.store (m_stream->head_frames());
+}
+
+bool
+AudioStreamReader::try_acquire()
+{
+  bool in_use = false;
+  return m_in_use.compare_exchange_strong (in_use, true);
+}
+
+void
+AudioStreamReader::release()
+{
+  m_in_use.store (false);
+}
+
+void
+AudioStreamReader::restart (size_t start_frame)
+{
+  const uint64_t generation = (m_request.load() >> 32) + 1;
+  const uint64_t start = std::max (start_frame, m_stream->head_frames());
+
+  m_consumed.store ((generation << 32) | start);
+  m_request.store ((generation << 32) | start);
+}
+
+bool
+AudioStreamReader::rt_audio_block (size_t index, RTAudioBlock& out_block)
+{
+  const Audio *audio = m_stream->audio();
+  const size_t head = m_stream->head_frames();
+
+  if (index >= m_stream->n_frames())
+    return false;
+
+  if (index < head)
+    {
+      out_block.assign_view (*audio, index);
+      return true;
+    }
+
+  const uint64_t request    = m_request.load();
+  const uint64_t generation = request >> 32;
+  const size_t   start      = request & LOW_MASK;
+
+  const uint64_t written = m_written.load();
+  const size_t   count   = (written >> 32) == generation ? (written & LOW_MASK) : 0;
+
+  /* only the consumer modifies m_consumed, so it always belongs to the current generation */
+  const size_t consumed = m_consumed.load() & LOW_MASK;
+
+  size_t frame = index;
+  if (frame < consumed || (frame >= start + count && count == 0))
+    {
+      /* frame was released (ring slot may already be overwritten) or no frame was streamed yet */
+      if (frame >= consumed)
+        m_underruns.fetch_add (1);
+
+      if (head == 0)
+        return false;
+
+      out_block.assign_view (*audio, head - 1);
+      return true;
+    }
+  if (frame >= start + count)
+    {
+      m_underruns.fetch_add (1);
+      frame = start + count - 1;
+    }
+  if (frame > consumed)
+    m_consumed.store ((generation << 32) | frame);
+
+  out_block.assign_view (m_ring[frame % m_ring.size()]);
+  return true;
+}
+
+uint64_t
+AudioStreamReader::underruns() const
+{
+  return m_underruns.load();
+}
+
+bool
+AudioStreamReader::fill()
+{
+  if (!m_in_use.load())
+    return false;
+
+  const uint64_t request    = m_request.load();
+  const uint64_t generation = request >> 32;
+  const size_t   start      = request & LOW_MASK;
+
+  if (generation != m_fill_generation)
+    {
+      m_fill_generation = generation;
+      m_fill_count = 0;
+      m_written.store (generation << 32);
+    }
+
+  bool read = false;
+  while (start + m_fill_count < m_stream->n_frames())
+    {
+      const uint64_t consumed_gen = m_consumed.load();
+      const size_t   consumed     = (consumed_gen >> 32) == generation ? (consumed_gen & LOW_MASK) : start;
+
+      /* ring slot of this frame still contains a frame >= consumed (which may be in use) */
+      const size_t frame = start + m_fill_count;
+      if (frame >= consumed + m_ring.size())
+        break;
+
+      /* restarted: old frames are no longer needed */
+      if (m_request.load() != request)
+        break;
+
+      if (!m_stream->read_frame (frame, m_ring[frame % m_ring.size()]))
+        break;
+
+      m_fill_count++;
+      m_written.store ((generation << 32) | m_fill_count);
+      read = true;
+    }
+  return read;
+}
+
+AudioStreamReaderPool::AudioStreamReaderPool (std::shared_ptr<AudioStream> stream, size_t n_readers, size_t max_readers) :
+  m_stream (stream),
+  m_readers (std::max (n_readers, max_readers))
+{
+  for (size_t r = 0; r < n_readers; r++)
+    m_readers[r] = std::make_shared<AudioStreamReader> (stream);
+
+  m_n_readers.store (n_readers);
+}
+
+std::shared_ptr<AudioStreamReader>
+AudioStreamReaderPool::try_acquire()
+{
+  const size_t n_readers = m_n_readers.load (std::memory_order_acquire);
+
+  for (size_t r = 0; r < n_readers; r++)
+    {
+      if (m_readers[r]->try_acquire())
+        return m_readers[r]; // the pool keeps a reference, so copying doesn't allocate
+    }
+  m_exhausted.store (true);
+  return nullptr;
+}
+
+size_t
+AudioStreamReaderPool::n_readers() const
+{
+  return m_n_readers.load (std::memory_order_acquire);
+}
+
+size_t
+AudioStreamReaderPool::n_frames() const
+{
+  return m_stream->n_frames();
+}
+
+std::shared_ptr<AudioStreamReader>
+AudioStreamReaderPool::reader (size_t r) const
+{
+  assert (r < n_readers());
+
+  return m_readers[r];
+}
+
+std::shared_ptr<AudioStreamReader>
+AudioStreamReaderPool::grow()
+{
+  const size_t n_readers = m_n_readers.load();
+
+  if (!m_exhausted.exchange (false) || n_readers == m_readers.size())
+    return nullptr;
+
+  /* entry n_readers is not visible to the audio thread before m_n_readers is updated */
+  m_readers[n_readers] = std::make_shared<AudioStreamReader> (m_stream);
+  m_n_readers.store (n_readers + 1, std::memory_order_release);
+
+  return m_readers[n_readers];
+}
+
+AudioStreamer *
+AudioStreamer::the()
+{
+  return Global::audio_streamer();
+}
+
+void
+AudioStreamer::add_reader (std::shared_ptr<AudioStreamReader> reader)
+{
+  std::lock_guard<std::mutex> lock (m_mutex);
+
+  m_readers.push_back (reader);
+  if (!m_thread.joinable())
+    m_thread = std::thread (&AudioStreamer::thread_main, this);
+}
+
+void
+AudioStreamer::add_pool (std::shared_ptr<AudioStreamReaderPool> pool)
+{
+  std::lock_guard<std::mutex> lock (m_mutex);
+
+  m_pools.push_back (pool);
+  for (size_t r = 0; r < pool->n_readers(); r++)
+    m_readers.push_back (pool->reader (r));
+
+  if (!m_thread.joinable())
+    m_thread = std::thread (&AudioStreamer::thread_main, this);
+}
+
+void
+AudioStreamer::thread_main()
+{
+  vector<std::shared_ptr<AudioStreamReader>> readers;
+
+  while (!m_quit.load())
+    {
+      /* reading frames can be slow (page faults), so we don't hold the lock while filling:
+       * the references taken here keep the readers alive until we are done with them
+       */
+      {
+        std::lock_guard<std::mutex> lock (m_mutex);
+
+        /* more voices than readers: add another reader, the voice picks it up later */
+        m_pools.erase (std::remove_if (m_pools.begin(), m_pools.end(),
+                                       [] (const auto& pool) { return pool.expired(); }),
+                       m_pools.end());
+        for (const auto& weak_pool : m_pools)
+          {
+            auto pool = weak_pool.lock();
+            if (pool)
+              {
+                auto new_reader = pool->grow();
+                if (new_reader)
+                  m_readers.push_back (new_reader);
+              }
+          }
+        m_readers.erase (std::remove_if (m_readers.begin(), m_readers.end(),
+                                         [] (const auto& reader) { return reader.expired(); }),
+                         m_readers.end());
+        for (const auto& weak_reader : m_readers)
+          {
+            auto reader = weak_reader.lock();
+            if (reader)
+              readers.push_back (reader);
+          }
+      }
+      bool read = false;
+      for (const auto& reader : readers)
+        read |= reader->fill();
+
+      readers.clear(); // may free readers that are no longer used (not in audio thread)
+
+      /* frames are requested from the audio thread, so we need to poll */
+      if (!read)
+        std::this_thread::sleep_for (std::chrono::milliseconds (2));
+    }
+}
+
+AudioStreamer::~AudioStreamer()
+{
+  if (m_thread.joinable())
+    {
+      m_quit.store (true);
+      m_thread.join();
+    }
+}
+
+AudioStreamSource::AudioStreamSource (std::shared_ptr<AudioStream> stream, bool use_streamer) :
+  m_stream (stream),
+  m_reader (std::make_shared<AudioStreamReader> (stream))
+{
+  m_reader->try_acquire();
+
+  if (use_streamer)
+    AudioStreamer::the()->add_reader (m_reader);
+}
+
+AudioStreamReader *
+AudioStreamSource::reader()
+{
+  return m_reader.get();
+}
+
+void
+AudioStreamSource::retrigger (int channel, float freq, int midi_velocity)
+{
+  m_reader->restart();
+}
+
+Audio *
+AudioStreamSource::audio()
+{
+  return m_stream->audio();
+}
+
+bool
+AudioStreamSource::rt_audio_block (size_t index, RTAudioBlock& out_block)
+{
+  return m_reader->rt_audio_block (index, out_block);
+}
+
+void
+AudioStreamSource::set_portamento_freq (float freq)
+{
+}
@@ -0,0 +1,188 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#ifndef SPECTMORPH_AUDIO_STREAM_HH
+#define SPECTMORPH_AUDIO_STREAM_HH
+
+#include "smaudio.hh"
+#include "smlivedecodersource.hh"
+
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <memory>
+
+namespace SpectMorph
+{
+
+/*
+ * Frame data of an Audio object that is streamed from a memory mapped file
+ *
+ * For very long samples (minutes of sustain), keeping all frames in memory is
+ * expensive. An AudioStream only keeps the Audio header and the first frames
+ * (head) in memory, and an index with the position of each frame in the file.
+ * The remaining frames are read on demand by AudioStreamReader.
+ *
+ * Streaming requires uncompressed frames (see Audio::compress_frames) and works
+ * best for samples without frame loops, which are played sequentially.
+ */
+class AudioStream
+{
+  SPECTMORPH_CLASS_NON_COPYABLE (AudioStream);
+
+  GenericInP          m_file;         // keeps the memory mapping alive
+  GenericInP          m_blob;         // audio data
+  size_t              m_blob_size = 0;
+  std::vector<size_t> m_frame_pos;    // position of each frame section in m_blob
+  Audio               m_audio;        // header and first frames
+  size_t              m_n_frames = 0;
+
+public:
+  static constexpr size_t DEFAULT_HEAD_FRAMES = 256;
+
+  AudioStream();
+
+  /* blob_index: index of the audio in a wav set file, or -1 for SpectMorph::Audio files */
+  Error open (const std::string& filename, int blob_index, size_t head_frames = DEFAULT_HEAD_FRAMES);
+
+  Audio  *audio();
+  size_t  n_frames() const;
+  size_t  head_frames() const;
+  size_t  mem_usage() const;
+
+  /* non-rt, can be called from any thread */
+  bool    read_frame (size_t frame, AudioBlock& block) const;
+};
+
+/*
+ * Per voice ring buffer for frames of an AudioStream
+ *
+ * The audio thread (consumer) requests frames in rt_audio_block(), an I/O thread
+ * (producer) reads the frames ahead of the playback position in fill(). The ring
+ * buffer is lock-free: producer and consumer only communicate through atomics.
+ *
+ *  - frames before head_frames() are taken from the AudioStream (always available)
+ *  - if a frame is not yet available (underrun), the last available frame is used
+ *  - frames before the playback position are released, if playback moves backwards
+ *    the last head frame is used
+ *  - restart() starts streaming from the beginning (retrigger) or from a given frame
+ *
+ * Only readers that are in use (see try_acquire) are filled, so a pool of readers
+ * can be created in advance and shared between voices without allocating memory
+ * in the audio thread.
+ */
+class AudioStreamReader
+{
+  SPECTMORPH_CLASS_NON_COPYABLE (AudioStreamReader);
+
+  std::shared_ptr<AudioStream> m_stream;
+  std::vector<AudioBlock>      m_ring;
+
+  /* upper 32 bits: generation (incremented by restart), lower 32 bits: frame/count */
+  std::atomic<uint64_t>        m_request { 0 };   // first frame to be streamed
+  std::atomic<uint64_t>        m_consumed { 0 };  // oldest frame still needed by the consumer
+  std::atomic<uint64_t>        m_written { 0 };   // number of frames available
+  std::atomic<uint64_t>        m_underruns { 0 };
+  std::atomic<bool>            m_in_use { false };
+
+  /* producer state */
+  uint64_t                     m_fill_generation = 0;
+  size_t                       m_fill_count = 0;
+
+public:
+  static constexpr size_t DEFAULT_RING_FRAMES = 512;
+
+  AudioStreamReader (std::shared_ptr<AudioStream> stream, size_t ring_frames = DEFAULT_RING_FRAMES);
+
+  /* consumer: rt safe */
+  bool     try_acquire();
+  void     release();
+  void     restart (size_t start_frame = 0);
+  bool     rt_audio_block (size_t index, RTAudioBlock& out_block);
+  uint64_t underruns() const;
+
+  /* producer: returns true if frames were read (only while the reader is in use) */
+  bool     fill();
+};
+
+/*
+ * Readers of one AudioStream, shared by all voices that play it
+ *
+ * The audio thread takes a reader using try_acquire(). If all readers are in use,
+ * the pool is marked as exhausted and the AudioStreamer thread creates another
+ * reader (up to max_readers), so the pool grows without allocating memory in the
+ * audio thread. Readers are never removed, so the audio thread can use the first
+ * n_readers() entries without locking.
+ */
+class AudioStreamReaderPool
+{
+  SPECTMORPH_CLASS_NON_COPYABLE (AudioStreamReaderPool);
+
+  std::shared_ptr<AudioStream>                    m_stream;
+  std::vector<std::shared_ptr<AudioStreamReader>> m_readers;        // max_readers entries, only the first n_readers are set
+  std::atomic<size_t>                             m_n_readers { 0 };
+  std::atomic<bool>                               m_exhausted { false };
+
+public:
+  static constexpr size_t DEFAULT_MAX_READERS = 128;
+
+  AudioStreamReaderPool (std::shared_ptr<AudioStream> stream, size_t n_readers, size_t max_readers = DEFAULT_MAX_READERS);
+
+  /* rt safe: returns nullptr if no reader is available right now */
+  std::shared_ptr<AudioStreamReader> try_acquire();
+  size_t n_readers() const;
+  size_t n_frames() const;
+
+  /* non-rt */
+  std::shared_ptr<AudioStreamReader> reader (size_t r) const;
+
+  /* non-rt: creates a new reader if the pool was exhausted (called by the AudioStreamer) */
+  std::shared_ptr<AudioStreamReader> grow();
+};
+
+/*
+ * I/O thread that fills the ring buffers of all registered AudioStreamReaders
+ */
+class AudioStreamer
+{
+  std::mutex                                        m_mutex;
+  std::vector<std::weak_ptr<AudioStreamReader>>     m_readers;
+  std::vector<std::weak_ptr<AudioStreamReaderPool>> m_pools;
+  std::thread                                       m_thread;
+  std::atomic<bool>                                 m_quit { false };
+
+  void thread_main();
+public:
+  ~AudioStreamer();
+
+  /* non-rt: the I/O thread only keeps a weak reference, readers are removed when they are destroyed */
+  void add_reader (std::shared_ptr<AudioStreamReader> reader);
+
+  /* non-rt: adds all readers of the pool, and the readers the pool creates later on */
+  void add_pool (std::shared_ptr<AudioStreamReaderPool> pool);
+
+  static AudioStreamer *the(); // Singleton
+};
+
+/*
+ * LiveDecoderSource that plays an AudioStream, so only a window of frames needs to be in memory
+ */
+class AudioStreamSource : public LiveDecoderSource
+{
+  std::shared_ptr<AudioStream>       m_stream;
+  std::shared_ptr<AudioStreamReader> m_reader;
+
+public:
+  /* without streamer, the caller needs to call reader()->fill() (for instance for tests) */
+  AudioStreamSource (std::shared_ptr<AudioStream> stream, bool use_streamer = true);
+
+  AudioStreamReader *reader();
+
+  void   retrigger (int channel, float freq, int midi_velocity) override;
+  Audio *audio() override;
+  bool   rt_audio_block (size_t index, RTAudioBlock& out_block) override;
+  void   set_portamento_freq (float freq) override;
+};
+
+}
+
+#endif
@@ -42,6 +42,30 @@ Config::Config()
         {
           m_font_bold = s;
         }
+      else if (cfg_parser.command ("render_threads", i))
+        {
+          m_render_threads = i;
+        }
+      else if (cfg_parser.command ("float_frame_cache", i))
+        {
+          m_float_frame_cache = i;
+        }
+      else if (cfg_parser.command ("lazy_load_frames", i))
+        {
+          m_lazy_load_frames = i;
+        }
+      else if (cfg_parser.command ("lazy_load_lookahead", i))
+        {
+          m_lazy_load_lookahead = i;
+        }
+      else if (cfg_parser.command ("stream_frames", i))
+        {
+          m_stream_frames = i;
+        }
+      else if (cfg_parser.command ("wav_set_repo_mb", i))
+        {
+          m_wav_set_repo_mb = i;
+        }
       else
         {
           //cfg.die_if_unknown();
@@ -79,6 +103,42 @@ Config::font_bold() const
   return m_font_bold;
 }
 
+int
+Config::render_threads() const
+{
+  return m_render_threads;
+}
+
+bool
+Config::float_frame_cache() const
+{
+  return m_float_frame_cache;
+}
+
+int
+Config::lazy_load_frames() const
+{
+  return m_lazy_load_frames;
+}
+
+int
+Config::lazy_load_lookahead() const
+{
+  return m_lazy_load_lookahead;
+}
+
+int
+Config::stream_frames() const
+{
+  return m_stream_frames;
+}
+
+int
+Config::wav_set_repo_mb() const
+{
+  return m_wav_set_repo_mb;
+}
+
 void
 Config::store()
 {
@@ -94,6 +154,24 @@ Config::store()
   for (auto area : m_debug)
     fprintf (file, "debug %s\n", area.c_str());
 
+  if (m_render_threads != 1)
+    fprintf (file, "render_threads %d\n", m_render_threads);
+
+  if (m_float_frame_cache)
+    fprintf (file, "float_frame_cache 1\n");
+
+  if (m_lazy_load_frames)
+    fprintf (file, "lazy_load_frames %d\n", m_lazy_load_frames);
+
+  if (m_lazy_load_lookahead)
+    fprintf (file, "lazy_load_lookahead %d\n", m_lazy_load_lookahead);
+
+  if (m_stream_frames)
+    fprintf (file, "stream_frames %d\n", m_stream_frames);
+
+  if (m_wav_set_repo_mb)
+    fprintf (file, "wav_set_repo_mb %d\n", m_wav_set_repo_mb);
+
   if (m_font != "")
     fprintf (file, "font \"%s\"", m_font.c_str());
 
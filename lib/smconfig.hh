@@ -16,6 +16,12 @@ class Config
   std::vector<std::string> m_debug;
   std::string              m_font;
   std::string              m_font_bold;
+  int                      m_render_threads = 1;
+  bool                     m_float_frame_cache = false;
+  int                      m_lazy_load_frames = 0;
+  int                      m_lazy_load_lookahead = 0;
+  int                      m_stream_frames = 0;
+  int                      m_wav_set_repo_mb = 0;
 
   std::string get_config_filename();
 public:
@@ -29,6 +35,13 @@ public:
   std::string font() const;
   std::string font_bold() const;
 
+  int   render_threads() const;
+  bool  float_frame_cache() const;
+  int   lazy_load_frames() const;
+  int   lazy_load_lookahead() const;
+  int   stream_frames() const;
+  int   wav_set_repo_mb() const;
+
   void store();
 };
 
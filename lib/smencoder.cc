@@ -10,6 +10,7 @@
 #include "smalignedarray.hh"
 #include "smrandom.hh"
 #include "smaudiotool.hh"
+#include "smparallel.hh"
 #include "config.h"
 
 #include <math.h>
@@ -278,6 +279,34 @@ Encoder::Encoder (const EncoderParams& enc_params)
   optimal_attack.attack_end_ms = 0;
 }
 
+/**
+ * This function calls func (start, end) for consecutive ranges of frames that
+ * together cover all audio_blocks. With more than one thread, the ranges are
+ * processed concurrently, so func must only modify the data of its own frames.
+ */
+void
+Encoder::parallel_frames (const std::function<void (size_t start, size_t end)>& func)
+{
+  const size_t n_frames  = audio_blocks.size();
+  const size_t n_workers = n_threads > 0 ? n_threads : sm_cpu_count();
+
+  /* a few ranges per thread for load balancing; each range needs its own buffers, so don't make them too small */
+  const size_t n_ranges = n_workers > 1 ? std::clamp<size_t> (n_frames / 16, 1, n_workers * 4) : 1;
+
+  sm_parallel_for (n_ranges,
+    [&] (size_t r)
+      {
+        func (r * n_frames / n_ranges, (r + 1) * n_frames / n_ranges);
+      },
+    n_threads);
+}
+
+void
+Encoder::set_n_threads (int new_n_threads)
+{
+  n_threads = new_n_threads;
+}
+
 /**
  * This function computes the short-time-fourier-transform (STFT) of the input
  * signal using a window to cut the individual frames out of the sample.
@@ -310,49 +339,54 @@ Encoder::compute_stft (const WavData& multi_channel_wav_data, int channel)
 
   sample_count = n_values;
 
-  vector<double> in (block_size * zeropad), out (block_size * zeropad + 2);
+  /* one frame per frame step, starting at position 0 */
+  audio_blocks.resize ((n_values + enc_params.frame_step - 1) / enc_params.frame_step);
 
-  float *fft_in = FFT::new_array_float (in.size());
-  float *fft_out = FFT::new_array_float (in.size());
-
-  for (uint64 pos = 0; pos < n_values; pos += enc_params.frame_step)
+  parallel_frames ([&] (size_t start, size_t end)
     {
-      EncoderBlock audio_block;
+      vector<double> in (block_size * zeropad), out (block_size * zeropad + 2);
 
-      /* start with zero block, so the incomplete blocks at end are zeropadded */
-      vector<float> block (block_size);
+      float *fft_in = FFT::new_array_float (in.size());
+      float *fft_out = FFT::new_array_float (in.size());
 
-      for (size_t offset = 0; offset < block.size(); offset++)
+      for (size_t frame = start; frame < end; frame++)
         {
-          if (pos + offset < wav_data.n_values())
-            block[offset] = wav_data[pos + offset];
-        }
-      vector<float> debug_samples (block.begin(), block.end());
-      Block::mul (enc_params.block_size, &block[0], &window[0]);
+          const uint64 pos = frame * enc_params.frame_step;
+          EncoderBlock& audio_block = audio_blocks[frame];
 
-      int j = in.size() - enc_params.frame_size / 2;
-      for (vector<float>::const_iterator i = block.begin(); i != block.end(); i++)
-        in[(j++) % in.size()] = *i;
+          /* start with zero block, so the incomplete blocks at end are zeropadded */
+          vector<float> block (block_size);
 
-      std::copy (in.begin(), in.end(), fft_in);
-      FFT::fftar_float (in.size(), fft_in, fft_out);
-      std::copy (fft_out, fft_out + in.size(), out.begin());
+          for (size_t offset = 0; offset < block.size(); offset++)
+            {
+              if (pos + offset < wav_data.n_values())
+                block[offset] = wav_data[pos + offset];
+            }
+          vector<float> debug_samples (block.begin(), block.end());
+          Block::mul (enc_params.block_size, &block[0], &window[0]);
 
-      out[block_size * zeropad] = out[1];
-      out[block_size * zeropad + 1] = 0;
-      out[1] = 0;
+          int j = in.size() - enc_params.frame_size / 2;
+          for (vector<float>::const_iterator i = block.begin(); i != block.end(); i++)
+            in[(j++) % in.size()] = *i;
 
-      audio_block.noise.assign (out.begin(), out.end()); // <- will be overwritten by noise spectrum later on
-      audio_block.original_fft.assign (out.begin(), out.end());
-      audio_block.debug_samples.assign (debug_samples.begin(), debug_samples.begin() + frame_size);
+          std::copy (in.begin(), in.end(), fft_in);
+          FFT::fftar_float (in.size(), fft_in, fft_out);
+          std::copy (fft_out, fft_out + in.size(), out.begin());
 
-      audio_blocks.push_back (audio_block);
+          out[block_size * zeropad] = out[1];
+          out[block_size * zeropad + 1] = 0;
+          out[1] = 0;
 
-      if (killed ("_stft", audio_blocks.size() & 63))
-        break; // break to avoid leaking fft_in, fft_out
-    }
-  FFT::free_array_float (fft_in);
-  FFT::free_array_float (fft_out);
+          audio_block.noise.assign (out.begin(), out.end()); // <- will be overwritten by noise spectrum later on
+          audio_block.original_fft.assign (out.begin(), out.end());
+          audio_block.debug_samples.assign (debug_samples.begin(), debug_samples.begin() + frame_size);
+
+          if (killed ("_stft", frame & 63))
+            break; // break to avoid leaking fft_in, fft_out
+        }
+      FFT::free_array_float (fft_in);
+      FFT::free_array_float (fft_out);
+    });
 }
 
 namespace
@@ -409,119 +443,122 @@ Encoder::search_local_maxima()
 	}
     }
 
-  for (size_t n = 0; n < audio_blocks.size(); n++)
+  parallel_frames ([&] (size_t start, size_t end)
     {
-      vector<double> mag_values (audio_blocks[n].noise.size() / 2);
-      for (size_t d = 0; d < block_size * zeropad; d += 2)
-        mag_values[d / 2] = magnitude (audio_blocks[n].noise.begin() + d);
+      for (size_t n = start; n < end; n++)
+        {
+          vector<double> mag_values (audio_blocks[n].noise.size() / 2);
+          for (size_t d = 0; d < block_size * zeropad; d += 2)
+            mag_values[d / 2] = magnitude (audio_blocks[n].noise.begin() + d);
 
-      for (size_t d = 2; d < block_size * zeropad; d += 2)
-	{
+          for (size_t d = 2; d < block_size * zeropad; d += 2)
+            {
 #if 0
-	  double phase = atan2 (*(audio_blocks[n]->noise.begin() + d),
-	                        *(audio_blocks[n]->noise.begin() + d + 1)) / 2 / M_PI;  /* range [-0.5 .. 0.5] */
+              double phase = atan2 (*(audio_blocks[n]->noise.begin() + d),
+                                    *(audio_blocks[n]->noise.begin() + d + 1)) / 2 / M_PI;  /* range [-0.5 .. 0.5] */
 #endif
-          enum { PEAK_NONE, PEAK_SINGLE, PEAK_DOUBLE } peak_type = PEAK_NONE;
+              enum { PEAK_NONE, PEAK_SINGLE, PEAK_DOUBLE } peak_type = PEAK_NONE;
 
-          if (mag_values[d/2] > mag_values[d/2-1] && mag_values[d/2] > mag_values[d/2+1])   /* search for peaks in fft magnitudes */
-            {
-              /* single peak is the common case, where the magnitude of the middle value is
-               * larger than the magnitude of the left and right neighbour
-               */
-              peak_type = PEAK_SINGLE;
-            }
-          else
-            {
-              double epsilon_fact = 1.0 + 1e-8;
-              if (mag_values[d/2] < mag_values[d/2+1] * epsilon_fact && mag_values[d/2] * epsilon_fact > mag_values[d/2 + 1]
-              &&  mag_values[d/2] > mag_values[d/2-1] && mag_values[d/2] > mag_values[d/2+2])
+              if (mag_values[d/2] > mag_values[d/2-1] && mag_values[d/2] > mag_values[d/2+1])   /* search for peaks in fft magnitudes */
                 {
-                  /* double peak is a special case, where two values in the spectrum have (almost) equal magnitude
-                   * in this case, this magnitude must be larger than the value left and right of the _two_
-                   * maximal values in the spectrum
+                  /* single peak is the common case, where the magnitude of the middle value is
+                   * larger than the magnitude of the left and right neighbour
                    */
-                  peak_type = PEAK_DOUBLE;
+                  peak_type = PEAK_SINGLE;
+                }
+              else
+                {
+                  double epsilon_fact = 1.0 + 1e-8;
+                  if (mag_values[d/2] < mag_values[d/2+1] * epsilon_fact && mag_values[d/2] * epsilon_fact > mag_values[d/2 + 1]
+                  &&  mag_values[d/2] > mag_values[d/2-1] && mag_values[d/2] > mag_values[d/2+2])
+                    {
+                      /* double peak is a special case, where two values in the spectrum have (almost) equal magnitude
+                       * in this case, this magnitude must be larger than the value left and right of the _two_
+                       * maximal values in the spectrum
+                       */
+                      peak_type = PEAK_DOUBLE;
+                    }
                 }
-            }
 
-          const double mag2 = db_from_factor (mag_values[d / 2] / max_mag, -100);
-          debug ("dbspectrum:%zd %f\n", n, mag2);
+              const double mag2 = db_from_factor (mag_values[d / 2] / max_mag, -100);
+              debug ("dbspectrum:%zd %f\n", n, mag2);
 
-          if (peak_type != PEAK_NONE)
-            {
-              if (mag2 > -90)
+              if (peak_type != PEAK_NONE)
                 {
-                  size_t ds, de;
-                  for (ds = d / 2 - 1; ds > 0 && mag_values[ds] < mag_values[ds + 1]; ds--);
-                  for (de = d / 2 + 1; de < (mag_values.size() - 1) && mag_values[de] > mag_values[de + 1]; de++);
+                  if (mag2 > -90)
+                    {
+                      size_t ds, de;
+                      for (ds = d / 2 - 1; ds > 0 && mag_values[ds] < mag_values[ds + 1]; ds--);
+                      for (de = d / 2 + 1; de < (mag_values.size() - 1) && mag_values[de] > mag_values[de + 1]; de++);
 
-                  const double normalized_peak_width = (de - ds) * frame_size / double (block_size * zeropad);
+                      const double normalized_peak_width = (de - ds) * frame_size / double (block_size * zeropad);
 
-                  bool peak_ok;
-                  double value;
-                  if (enc_params.get_param ("peak-width", value))
-                    peak_ok = normalized_peak_width > value;
-                  else
-                    peak_ok = normalized_peak_width > 2.9;
+                      bool peak_ok;
+                      double value;
+                      if (enc_params.get_param ("peak-width", value))
+                        peak_ok = normalized_peak_width > value;
+                      else
+                        peak_ok = normalized_peak_width > 2.9;
 
-                  if (peak_ok)
-                    {
-                      const double mag1 = db_from_factor (mag_values[d / 2 - 1] / max_mag, -100);
-                      const double mag3 = db_from_factor (mag_values[d / 2 + 1] / max_mag, -100);
-                      //double freq = d / 2 * mix_freq / (block_size * zeropad); /* bin frequency */
-
-                      QInterpolator mag_interp (mag1, mag2, mag3);
-                      double x_max = mag_interp.x_max();
-                      double tfreq = (d / 2 + x_max) * mix_freq / (block_size * zeropad);
-
-                      double peak_mag_db = mag_interp.eval (x_max);
-                      double peak_mag = db_to_factor (peak_mag_db) * max_mag;
-
-                      // use the interpolation formula for the complex values to find the phase
-                      QInterpolator re_interp (audio_blocks[n].noise[d-2], audio_blocks[n].noise[d], audio_blocks[n].noise[d+2]);
-                      QInterpolator im_interp (audio_blocks[n].noise[d-1], audio_blocks[n].noise[d+1], audio_blocks[n].noise[d+3]);
-    /*
-                      if (mag2 > -20)
-                        printf ("%f %f %f %f %f\n", phase, last_phase[d], phase_diff, phase_diff * mix_freq / (block_size * zeropad) * overlap, tfreq);
-    */
-                      Tracksel tracksel;
-                      tracksel.frame = n;
-                      tracksel.d = d;
-                      tracksel.freq = tfreq;
-                      tracksel.mag = peak_mag * window_scale;
-                      tracksel.mag2 = mag2;
-                      tracksel.next = 0;
-                      tracksel.prev = 0;
-
-                      const double re_mag = re_interp.eval (x_max);
-                      const double im_mag = im_interp.eval (x_max);
-                      double phase = atan2 (im_mag, re_mag) + 0.5 * M_PI;
-                      // correct for the odd-centered analysis
+                      if (peak_ok)
                         {
-                          phase -= (frame_size - 1) / 2.0 / mix_freq * tracksel.freq * 2 * M_PI;
-                          phase = normalize_phase (phase);
+                          const double mag1 = db_from_factor (mag_values[d / 2 - 1] / max_mag, -100);
+                          const double mag3 = db_from_factor (mag_values[d / 2 + 1] / max_mag, -100);
+                          //double freq = d / 2 * mix_freq / (block_size * zeropad); /* bin frequency */
+
+                          QInterpolator mag_interp (mag1, mag2, mag3);
+                          double x_max = mag_interp.x_max();
+                          double tfreq = (d / 2 + x_max) * mix_freq / (block_size * zeropad);
+
+                          double peak_mag_db = mag_interp.eval (x_max);
+                          double peak_mag = db_to_factor (peak_mag_db) * max_mag;
+
+                          // use the interpolation formula for the complex values to find the phase
+                          QInterpolator re_interp (audio_blocks[n].noise[d-2], audio_blocks[n].noise[d], audio_blocks[n].noise[d+2]);
+                          QInterpolator im_interp (audio_blocks[n].noise[d-1], audio_blocks[n].noise[d+1], audio_blocks[n].noise[d+3]);
+        /*
+                          if (mag2 > -20)
+                            printf ("%f %f %f %f %f\n", phase, last_phase[d], phase_diff, phase_diff * mix_freq / (block_size * zeropad) * overlap, tfreq);
+        */
+                          Tracksel tracksel;
+                          tracksel.frame = n;
+                          tracksel.d = d;
+                          tracksel.freq = tfreq;
+                          tracksel.mag = peak_mag * window_scale;
+                          tracksel.mag2 = mag2;
+                          tracksel.next = 0;
+                          tracksel.prev = 0;
+
+                          const double re_mag = re_interp.eval (x_max);
+                          const double im_mag = im_interp.eval (x_max);
+                          double phase = atan2 (im_mag, re_mag) + 0.5 * M_PI;
+                          // correct for the odd-centered analysis
+                            {
+                              phase -= (frame_size - 1) / 2.0 / mix_freq * tracksel.freq * 2 * M_PI;
+                              phase = normalize_phase (phase);
+                            }
+                          tracksel.phase = phase;
+
+                          // FIXME: need a different criterion here
+                          // mag2 > -30 doesn't track all partials
+                          // mag2 > -60 tracks lots of junk, too
+                          if (mag2 > -90 && tracksel.freq > 10)
+                            frame_tracksels[n].push_back (tracksel);
+
+                          if (peak_type == PEAK_DOUBLE)
+                            d += 2;
                         }
-                      tracksel.phase = phase;
-
-                      // FIXME: need a different criterion here
-                      // mag2 > -30 doesn't track all partials
-                      // mag2 > -60 tracks lots of junk, too
-                      if (mag2 > -90 && tracksel.freq > 10)
-                        frame_tracksels[n].push_back (tracksel);
-
-                      if (peak_type == PEAK_DOUBLE)
-                        d += 2;
                     }
-                }
 #if 0
-              last_phase[d] = phase;
+                  last_phase[d] = phase;
 #endif
+                }
             }
-	}
 
-      if (killed ("_maxima", n & 15))
-        return;
-    }
+          if (killed ("_maxima", n & 15))
+            return;
+        }
+    });
 }
 
 /// @cond
@@ -674,66 +711,69 @@ Encoder::spectral_subtract()
   const size_t zeropad    = enc_params.zeropad;
   const auto&  window     = enc_params.window;
 
-  float *fft_in = FFT::new_array_float (block_size * zeropad);
-  float *fft_out = FFT::new_array_float (block_size * zeropad);
-
-  for (uint64 frame = 0; frame < audio_blocks.size(); frame++)
+  parallel_frames ([&] (size_t start, size_t end)
     {
-      AlignedArray<float,16> signal (frame_size);
-      for (size_t i = 0; i < audio_blocks[frame].freqs.size(); i++)
-	{
-          const double freq = audio_blocks[frame].freqs[i];
-	  const double mag = audio_blocks[frame].mags[i];
-	  const double phase = audio_blocks[frame].phases[i];
-
-          VectorSinParams params;
-          params.mix_freq = enc_params.mix_freq;
-          params.freq = freq;
-          params.phase = phase;
-          params.mag = mag;
-          params.mode = VectorSinParams::ADD;
+      float *fft_in = FFT::new_array_float (block_size * zeropad);
+      float *fft_out = FFT::new_array_float (block_size * zeropad);
 
-          fast_vector_sinf (params, &signal[0], &signal[frame_size]);
-	}
-      vector<double> out (block_size * zeropad + 2);
-      // apply window
-      std::fill (fft_in, fft_in + block_size * zeropad, 0);
-      for (size_t k = 0; k < frame_size; k++)
-        fft_in[k] = window[k] * signal[k];
-      // FFT
-      FFT::fftar_float (block_size * zeropad, fft_in, fft_out);
-      std::copy (fft_out, fft_out + block_size * zeropad, out.begin());
-      out[block_size * zeropad] = out[1];
-      out[block_size * zeropad + 1] = 0;
-      out[1] = 0;
-
-      // subtract spectrum from audio spectrum
-      for (size_t d = 0; d < block_size * zeropad; d += 2)
-	{
-	  double re = out[d], im = out[d + 1];
-	  double sub_mag = sqrt (re * re + im * im);
-	  debug ("subspectrum:%" PRId64 " %g\n", frame, sub_mag);
+      for (uint64 frame = start; frame < end; frame++)
+        {
+          AlignedArray<float,16> signal (frame_size);
+          for (size_t i = 0; i < audio_blocks[frame].freqs.size(); i++)
+            {
+              const double freq = audio_blocks[frame].freqs[i];
+              const double mag = audio_blocks[frame].mags[i];
+              const double phase = audio_blocks[frame].phases[i];
+
+              VectorSinParams params;
+              params.mix_freq = enc_params.mix_freq;
+              params.freq = freq;
+              params.phase = phase;
+              params.mag = mag;
+              params.mode = VectorSinParams::ADD;
+
+              fast_vector_sinf (params, &signal[0], &signal[frame_size]);
+            }
+          vector<double> out (block_size * zeropad + 2);
+          // apply window
+          std::fill (fft_in, fft_in + block_size * zeropad, 0);
+          for (size_t k = 0; k < frame_size; k++)
+            fft_in[k] = window[k] * signal[k];
+          // FFT
+          FFT::fftar_float (block_size * zeropad, fft_in, fft_out);
+          std::copy (fft_out, fft_out + block_size * zeropad, out.begin());
+          out[block_size * zeropad] = out[1];
+          out[block_size * zeropad + 1] = 0;
+          out[1] = 0;
+
+          // subtract spectrum from audio spectrum
+          for (size_t d = 0; d < block_size * zeropad; d += 2)
+            {
+              double re = out[d], im = out[d + 1];
+              double sub_mag = sqrt (re * re + im * im);
+              debug ("subspectrum:%" PRId64 " %g\n", frame, sub_mag);
 
-	  double mag = magnitude (audio_blocks[frame].noise.begin() + d);
-	  debug ("spectrum:%" PRId64 " %g\n", frame, mag);
-	  if (mag > 0)
-	    {
-	      audio_blocks[frame].noise[d] /= mag;
-	      audio_blocks[frame].noise[d + 1] /= mag;
-	      mag -= sub_mag;
-	      if (mag < 0)
-		mag = 0;
-	      audio_blocks[frame].noise[d] *= mag;
-	      audio_blocks[frame].noise[d + 1] *= mag;
-	    }
-	  debug ("finalspectrum:%" PRId64 " %g\n", frame, mag);
-	}
+              double mag = magnitude (audio_blocks[frame].noise.begin() + d);
+              debug ("spectrum:%" PRId64 " %g\n", frame, mag);
+              if (mag > 0)
+                {
+                  audio_blocks[frame].noise[d] /= mag;
+                  audio_blocks[frame].noise[d + 1] /= mag;
+                  mag -= sub_mag;
+                  if (mag < 0)
+                    mag = 0;
+                  audio_blocks[frame].noise[d] *= mag;
+                  audio_blocks[frame].noise[d + 1] *= mag;
+                }
+              debug ("finalspectrum:%" PRId64 " %g\n", frame, mag);
+            }
 
-      if (killed ("_subtract", frame & 7))
-        return;
-    }
-  FFT::free_array_float (fft_in);
-  FFT::free_array_float (fft_out);
+          if (killed ("_subtract", frame & 7))
+            break; // break to avoid leaking fft_in, fft_out
+        }
+      FFT::free_array_float (fft_in);
+      FFT::free_array_float (fft_out);
+    });
 }
 
 template<class AIter, class BIter>
@@ -934,16 +974,19 @@ Encoder::optimize_partials (int optimization_level)
 {
   const double mix_freq = enc_params.mix_freq;
 
-  for (uint64 frame = 0; frame < audio_blocks.size(); frame++)
+  parallel_frames ([&] (size_t start, size_t end)
     {
-      if (optimization_level >= 1) // redo FFT estmates, only better
-        refine_sine_params_fast (audio_blocks[frame], mix_freq, frame, enc_params.window, enc_params.window_weight);
+      for (uint64 frame = start; frame < end; frame++)
+        {
+          if (optimization_level >= 1) // redo FFT estmates, only better
+            refine_sine_params_fast (audio_blocks[frame], mix_freq, frame, enc_params.window, enc_params.window_weight);
 
-      remove_small_partials (audio_blocks[frame]);
+          remove_small_partials (audio_blocks[frame]);
 
-      if (killed ("_optimize"))
-        return;
-    }
+          if (killed ("_optimize"))
+            return;
+        }
+    });
 }
 
 static double
@@ -1090,53 +1133,56 @@ Encoder::approx_noise()
   // sum_w2 is the average influence of the window (w[x]^2), multiplied with frame_size
   const double norm = 0.5 * enc_params.mix_freq * sum_w2;
 
-  for (uint64 frame = 0; frame < audio_blocks.size(); frame++)
+  parallel_frames ([&] (size_t start, size_t end)
     {
-      vector<double> noise_envelope (Audio::N_NOISE_BANDS);
-      vector<double> spectrum (audio_blocks[frame].noise.begin(), audio_blocks[frame].noise.end());
-
-      /* A complex FFT would preserve the energy of the input signal exactly; the difference to
-       * our (real) FFT is that every value in the complex spectrum occurs twice, once as "positive"
-       * frequency, once as "negative" frequency - except for two spectrum values: the value
-       * for frequency 0, and the value for frequency mix_freq / 2.
-       *
-       * To make this FFT energy preserving, we scale those values with a factor of sqrt (2) so
-       * that their energy is twice as big (energy == squared value). Then we scale the whole
-       * thing with a factor of 0.5, and we get an energy preserving transformation.
-       */
-      spectrum[0] /= sqrt (2);
-      spectrum[spectrum.size() - 2] /= sqrt (2);
-
-      approximate_noise_spectrum (frame, enc_params.mix_freq, spectrum, noise_envelope, norm);
-
-      /// DEBUG CODE {
-      const size_t fft_size = block_size * zeropad;
-      const double debug_norm = fft_size * 0.5 * sum_w2;
-
-      vector<double> approx_spectrum (fft_size);
-      xnoise_envelope_to_spectrum (frame, enc_params.mix_freq, noise_envelope, approx_spectrum, norm);
-      for (size_t i = 0; i < approx_spectrum.size(); i += 2)
-        debug ("spect_approx:%" PRId64 " %g\n", frame, approx_spectrum[i]);
-
-      double spect_energy = 0;
-      for (vector<double>::iterator si = approx_spectrum.begin(); si != approx_spectrum.end(); si++)
-        spect_energy += *si * *si / debug_norm;
-
-      double b4_energy = 0;
-      for (vector<double>::iterator si = spectrum.begin(); si != spectrum.end(); si++)
-        b4_energy += *si * *si / debug_norm;
-
-      double r_energy = 0;
-      for (vector<float>::iterator ri = audio_blocks[frame].debug_samples.begin(); ri != audio_blocks[frame].debug_samples.end(); ri++)
-        r_energy += *ri * *ri / audio_blocks[frame].debug_samples.size();
-
-      debug ("noiseenergy:%" PRId64 " %f %f %f\n", frame, spect_energy, b4_energy, r_energy);
-      /// } DEBUG_CODE
-      audio_blocks[frame].noise.assign (noise_envelope.begin(), noise_envelope.end());
-
-      if (killed ("_noise", frame & 7))
-        return;
-    }
+      for (uint64 frame = start; frame < end; frame++)
+        {
+          vector<double> noise_envelope (Audio::N_NOISE_BANDS);
+          vector<double> spectrum (audio_blocks[frame].noise.begin(), audio_blocks[frame].noise.end());
+
+          /* A complex FFT would preserve the energy of the input signal exactly; the difference to
+           * our (real) FFT is that every value in the complex spectrum occurs twice, once as "positive"
+           * frequency, once as "negative" frequency - except for two spectrum values: the value
+           * for frequency 0, and the value for frequency mix_freq / 2.
+           *
+           * To make this FFT energy preserving, we scale those values with a factor of sqrt (2) so
+           * that their energy is twice as big (energy == squared value). Then we scale the whole
+           * thing with a factor of 0.5, and we get an energy preserving transformation.
+           */
+          spectrum[0] /= sqrt (2);
+          spectrum[spectrum.size() - 2] /= sqrt (2);
+
+          approximate_noise_spectrum (frame, enc_params.mix_freq, spectrum, noise_envelope, norm);
+
+          /// DEBUG CODE {
+          const size_t fft_size = block_size * zeropad;
+          const double debug_norm = fft_size * 0.5 * sum_w2;
+
+          vector<double> approx_spectrum (fft_size);
+          xnoise_envelope_to_spectrum (frame, enc_params.mix_freq, noise_envelope, approx_spectrum, norm);
+          for (size_t i = 0; i < approx_spectrum.size(); i += 2)
+            debug ("spect_approx:%" PRId64 " %g\n", frame, approx_spectrum[i]);
+
+          double spect_energy = 0;
+          for (vector<double>::iterator si = approx_spectrum.begin(); si != approx_spectrum.end(); si++)
+            spect_energy += *si * *si / debug_norm;
+
+          double b4_energy = 0;
+          for (vector<double>::iterator si = spectrum.begin(); si != spectrum.end(); si++)
+            b4_energy += *si * *si / debug_norm;
+
+          double r_energy = 0;
+          for (vector<float>::iterator ri = audio_blocks[frame].debug_samples.begin(); ri != audio_blocks[frame].debug_samples.end(); ri++)
+            r_energy += *ri * *ri / audio_blocks[frame].debug_samples.size();
+
+          debug ("noiseenergy:%" PRId64 " %f %f %f\n", frame, spect_energy, b4_energy, r_energy);
+          /// } DEBUG_CODE
+          audio_blocks[frame].noise.assign (noise_envelope.begin(), noise_envelope.end());
+
+          if (killed ("_noise", frame & 7))
+            return;
+        }
+    });
 }
 
 double
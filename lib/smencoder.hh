@@ -117,6 +117,7 @@ class Encoder
   int                                  loop_start;
   int                                  loop_end;
   Audio::LoopType                      loop_type;
+  int                                  n_threads = 1;
 
   std::vector< std::vector<Tracksel> > frame_tracksels; //!< Analog to Canny Algorithms edgels - only used internally
 
@@ -127,6 +128,8 @@ class Encoder
   };
   double attack_error (const std::vector< std::vector<double> >& unscaled_signal, const Attack& attack, std::vector<double>& out_scale);
 
+  void parallel_frames (const std::function<void (size_t start, size_t end)>& func);
+
   // single encoder steps:
   void compute_stft (const WavData& wav_data, int channel);
   void search_local_maxima();
@@ -171,6 +174,12 @@ public:
   void set_loop (Audio::LoopType loop_type, int loop_start, int loop_end);
   void set_loop_seconds (Audio::LoopType loop_type, double loop_start, double loop_end);
 
+  /* per frame encoder steps use n_threads threads (0: one thread per cpu core); link_partials
+   * and the other steps that depend on more than one frame always run in the calling thread;
+   * the result doesn't depend on the number of threads
+   */
+  void set_n_threads (int n_threads);
+
   Error  save (const std::string& filename);
   Audio *save_as_audio();
 };
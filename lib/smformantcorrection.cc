@@ -78,16 +78,42 @@ FormantCorrection::advance (double time_ms)
 }
 
 void
-FormantCorrection::process_block (const AudioBlock& in_block, RTAudioBlock& out_block)
+FormantCorrection::process_block (const Audio& audio, size_t index, RTAudioBlock& out_block)
 {
   if (mode == MODE_REPITCH)
     {
-      out_block.assign (in_block);
+      out_block.assign_view (audio, index);
       return;
     }
+  /* read-only view of the frame, which is either in contents or in a mapped file */
+  RTAudioBlock    in_view (nullptr);
+  const uint16_t *in_env;
+  size_t          in_env_size;
+  float           in_env_f0;
+
+  in_view.assign_view (audio, index);
+  const RTAudioBlock& in_block = in_view; // const access never copies the data
+
+  if (audio.mapped_frames)
+    {
+      const AudioMappedFrames::Frame& frame = audio.mapped_frames->frames[index];
+
+      in_env      = frame.env;
+      in_env_size = frame.n_env;
+      in_env_f0   = frame.env_f0;
+    }
+  else
+    {
+      const AudioBlock& block = audio.contents[index];
+
+      in_env      = block.env.data();
+      in_env_size = block.env.size();
+      in_env_f0   = block.env_f0;
+    }
+
   auto emag = [&] (int i) {
-    if (i > 0 && i < int (in_block.env.size()))
-      return in_block.env_f (i);
+    if (i > 0 && i < int (in_env_size))
+      return sm_idb2factor (in_env[i]);
     return 0.0f;
   };
   auto emag_inter = [&] (float p) {
@@ -122,11 +148,11 @@ FormantCorrection::process_block (const AudioBlock& in_block, RTAudioBlock& out_
     sm_factor2idbs (mags, mags_count, imags);
     out_block.mags.assign (imags, imags + mags_count);
   };
-  out_block.noise.assign (in_block.noise);
+  out_block.noise.assign_view (in_block.noise);
   if (mode == MODE_PRESERVE_SPECTRAL_ENVELOPE)
     {
       out_block.freqs.set_capacity (in_block.freqs.size());
-      const float e_tune_factor = 1 / in_block.env_f0;
+      const float e_tune_factor = 1 / in_env_f0;
       float mags[in_block.freqs.size()];
       size_t count = 0;
 
@@ -156,7 +182,7 @@ FormantCorrection::process_block (const AudioBlock& in_block, RTAudioBlock& out_
       float mags[partials];
       size_t mags_count = 0;
 
-      float ff = in_block.env_f0;
+      float ff = in_env_f0;
       if (fuzzy_frac > 1)
         {
           detune_factors.swap (next_detune_factors);
@@ -45,7 +45,7 @@ public:
 
   void advance (double time_ms);
   void retrigger();
-  void process_block (const AudioBlock& in_block, RTAudioBlock& out_block);
+  void process_block (const Audio& audio, size_t index, RTAudioBlock& out_block);
 };
 
 }
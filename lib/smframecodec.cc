@@ -0,0 +1,620 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smframecodec.hh"
+
+#include <algorithm>
+#include <memory>
+
+#include <assert.h>
+#include <string.h>
+
+using namespace SpectMorph;
+
+using std::vector;
+
+/*
+ * Data layout (all integers little endian):
+ *
+ *   uint8    format version (2)
+ *   uint32   number of frames
+ *   uint32   raw data size
+ *   uint32   rANS data size (both streams)
+ *   uint32   size of the first rANS stream
+ *   tables   for each context: uint16 n, n * (uint8 symbol, uint16 freq)
+ *   raw      escaped residuals (uint16) and env_f0 (float), in decoding order
+ *   rANS     two streams: even symbols, odd symbols, each in decoding order
+ *
+ * Using two rANS coders with separate streams for even and odd symbols, the
+ * decoder works on two independent dependency chains, which is a lot faster
+ * than decoding everything with one state.
+ */
+namespace
+{
+
+constexpr int      FORMAT_VERSION = 2;
+
+constexpr int      SCALE_BITS = 12;
+constexpr uint32_t SCALE      = 1 << SCALE_BITS;
+constexpr uint32_t RANS_L     = 1 << 16;  // lower bound of the normalization interval (renormalization: 16 bits at a time)
+
+constexpr int      ESCAPE     = 255;      // residual doesn't fit into a symbol, stored in raw data
+
+enum Context
+{
+  CTX_SIZE,
+  CTX_NOISE,
+  CTX_FREQS,
+  CTX_MAGS,
+  CTX_PHASES,
+  CTX_ENV,
+  N_CONTEXTS
+};
+
+enum Mode
+{
+  MODE_PREV_FRAME,  // predict value from same index in previous frame
+  MODE_PREV_VALUE,  // predict value from previous value in this frame
+  MODE_NONE
+};
+
+inline uint16_t
+zigzag (uint16_t value, uint16_t prediction)
+{
+  const uint16_t d = value - prediction;
+  return uint16_t (d << 1) ^ ((d & 0x8000) ? 0xffff : 0);
+}
+
+inline uint16_t
+unzigzag (uint16_t z, uint16_t prediction)
+{
+  const uint16_t d = (z >> 1) ^ -(z & 1);
+  return uint16_t (prediction + d);
+}
+
+inline uint16_t
+predict (int mode, const uint16_t *values, size_t i, const vector<uint16_t>& prev)
+{
+  if (mode == MODE_PREV_FRAME && i < prev.size())
+    return prev[i];
+  if (mode != MODE_NONE && i > 0)
+    return values[i - 1];
+  return 0;
+}
+
+class Writer
+{
+  vector<uint8_t> m_symbols;
+  vector<uint8_t> m_contexts;
+public:
+  vector<unsigned char> raw;
+
+  void
+  put_symbol (int ctx, int symbol)
+  {
+    m_symbols.push_back (symbol);
+    m_contexts.push_back (ctx);
+  }
+  void
+  put_value (int ctx, uint16_t z)
+  {
+    if (z < ESCAPE)
+      {
+        put_symbol (ctx, z);
+      }
+    else
+      {
+        put_symbol (ctx, ESCAPE);
+        raw.push_back (z & 0xff);
+        raw.push_back (z >> 8);
+      }
+  }
+  void
+  put_array (int ctx, const vector<uint16_t>& values, const vector<uint16_t>& prev)
+  {
+    put_value (CTX_SIZE, zigzag (values.size(), prev.size()));
+
+    /* choose mode which produces the smallest residuals for this frame */
+    int best_mode = MODE_NONE;
+    size_t best_cost = SIZE_MAX;
+    for (int mode = MODE_PREV_FRAME; mode <= MODE_NONE; mode++)
+      {
+        size_t cost = 0;
+        for (size_t i = 0; i < values.size(); i++)
+          {
+            const uint16_t z = zigzag (values[i], predict (mode, values.data(), i, prev));
+            cost += z < 16 ? 1 : (z < ESCAPE ? 2 : 4);
+          }
+        if (cost < best_cost)
+          {
+            best_cost = cost;
+            best_mode = mode;
+          }
+      }
+    put_symbol (CTX_SIZE, best_mode);
+
+    for (size_t i = 0; i < values.size(); i++)
+      put_value (ctx, zigzag (values[i], predict (best_mode, values.data(), i, prev)));
+  }
+  void finish (vector<unsigned char>& out);
+};
+
+void
+write_u16 (vector<unsigned char>& out, uint16_t u)
+{
+  out.push_back (u & 0xff);
+  out.push_back (u >> 8);
+}
+
+void
+write_u32 (vector<unsigned char>& out, uint32_t u)
+{
+  for (int b = 0; b < 4; b++)
+    out.push_back ((u >> (8 * b)) & 0xff);
+}
+
+/* scale symbol counts so that they sum up to SCALE, keeping each used symbol > 0 */
+void
+normalize_freqs (const vector<uint32_t>& counts, vector<uint32_t>& freqs)
+{
+  uint64_t total = 0;
+  for (auto c : counts)
+    total += c;
+
+  freqs.assign (256, 0);
+  if (!total)
+    return;
+
+  uint32_t sum = 0;
+  int      max_symbol = 0;
+  for (int s = 0; s < 256; s++)
+    {
+      if (counts[s])
+        {
+          freqs[s] = std::max<uint32_t> (1, counts[s] * SCALE / total);
+          sum += freqs[s];
+
+          if (freqs[s] > freqs[max_symbol])
+            max_symbol = s;
+        }
+    }
+  /* fix rounding errors: adjust the most frequent symbol, or if that is not enough,
+   * take away from any symbol that has more than 1
+   */
+  while (sum > SCALE)
+    {
+      for (int s = 0; s < 256 && sum > SCALE; s++)
+        {
+          if (freqs[s] > 1)
+            {
+              uint32_t delta = std::min (freqs[s] - 1, sum - SCALE);
+              freqs[s] -= delta;
+              sum -= delta;
+            }
+        }
+    }
+  freqs[max_symbol] += SCALE - sum;
+}
+
+void
+Writer::finish (vector<unsigned char>& out)
+{
+  /* build frequency tables */
+  vector<vector<uint32_t>> freqs (N_CONTEXTS), starts (N_CONTEXTS);
+  for (int ctx = 0; ctx < N_CONTEXTS; ctx++)
+    {
+      vector<uint32_t> counts (256);
+      for (size_t i = 0; i < m_symbols.size(); i++)
+        if (m_contexts[i] == ctx)
+          counts[m_symbols[i]]++;
+
+      normalize_freqs (counts, freqs[ctx]);
+
+      starts[ctx].resize (256);
+      uint32_t start = 0;
+      for (int s = 0; s < 256; s++)
+        {
+          starts[ctx][s] = start;
+          start += freqs[ctx][s];
+        }
+    }
+
+  /* rANS: encode in reverse order, so that the decoder can decode in forward order;
+   * symbol i is coded with state x[i & 1] into stream rans[i & 1]
+   */
+  vector<unsigned char> rans[2];
+  uint32_t x[2] = { RANS_L, RANS_L };
+  for (size_t i = m_symbols.size(); i-- > 0;)
+    {
+      const uint32_t freq  = freqs[m_contexts[i]][m_symbols[i]];
+      const uint32_t start = starts[m_contexts[i]][m_symbols[i]];
+      const uint64_t x_max = uint64_t ((RANS_L >> SCALE_BITS) << 16) * freq;
+      uint32_t&      xi    = x[i & 1];
+      if (xi >= x_max)
+        {
+          rans[i & 1].push_back (xi & 0xff);
+          rans[i & 1].push_back ((xi >> 8) & 0xff);
+          xi >>= 16;
+        }
+      xi = ((xi / freq) << SCALE_BITS) + (xi % freq) + start;
+    }
+  for (int i = 0; i < 2; i++)
+    {
+      for (int b = 0; b < 4; b++)
+        {
+          rans[i].push_back (x[i] & 0xff);
+          x[i] >>= 8;
+        }
+      std::reverse (rans[i].begin(), rans[i].end());
+    }
+
+  /* write tables, raw data, rANS data */
+  write_u32 (out, raw.size());
+  write_u32 (out, rans[0].size() + rans[1].size());
+  write_u32 (out, rans[0].size());
+  for (int ctx = 0; ctx < N_CONTEXTS; ctx++)
+    {
+      uint16_t n = 0;
+      for (int s = 0; s < 256; s++)
+        if (freqs[ctx][s])
+          n++;
+
+      write_u16 (out, n);
+      for (int s = 0; s < 256; s++)
+        {
+          if (freqs[ctx][s])
+            {
+              out.push_back (s);
+              write_u16 (out, freqs[ctx][s]);
+            }
+        }
+    }
+  out.insert (out.end(), raw.begin(), raw.end());
+  out.insert (out.end(), rans[0].begin(), rans[0].end());
+  out.insert (out.end(), rans[1].begin(), rans[1].end());
+}
+
+}
+
+class FrameCodec::Reader
+{
+  /* rANS decoder state: x0 decodes the next symbol from its stream (ptr0, end0),
+   * then the two coders are swapped (so that even symbols use the first and odd
+   * symbols the second coder)
+   */
+  struct State
+  {
+    uint32_t             x0 = 0;
+    const unsigned char *ptr0 = nullptr;
+    const unsigned char *end0 = nullptr;
+    uint32_t             x1 = 0;
+    const unsigned char *ptr1 = nullptr;
+    const unsigned char *end1 = nullptr;
+  };
+  State                m_state;
+  const unsigned char *m_ptr;  // header
+  const unsigned char *m_end;
+  const unsigned char *m_raw;
+  const unsigned char *m_raw_end;
+  bool                 m_error = false;
+
+  /* everything we need to decode a symbol, in one table lookup */
+  struct Slot
+  {
+    uint16_t freq;
+    uint16_t bias;    // slot - start of the symbol
+    uint8_t  symbol;
+  };
+  struct Table
+  {
+    Slot slots[SCALE];
+  };
+  Table m_tables[N_CONTEXTS];
+
+  bool
+  read_u16 (uint16_t& u)
+  {
+    if (m_end - m_ptr < 2)
+      return false;
+
+    u = m_ptr[0] | (m_ptr[1] << 8);
+    m_ptr += 2;
+    return true;
+  }
+  bool
+  read_u32 (uint32_t& u)
+  {
+    if (m_end - m_ptr < 4)
+      return false;
+
+    u = m_ptr[0] | (m_ptr[1] << 8) | (m_ptr[2] << 16) | (uint32_t (m_ptr[3]) << 24);
+    m_ptr += 4;
+    return true;
+  }
+  /* the hot loops work on a copy of the state (in registers), see get_array() */
+  int
+  get_symbol (const Table& table, State& st)
+  {
+    const Slot& slot = table.slots[st.x0 & (SCALE - 1)];
+    if (!slot.freq)
+      {
+        /* context has no symbols */
+        m_error = true;
+        return 0;
+      }
+
+    /* renormalization needs at most one 16 bit word: read it without branches
+     * (these would often be mispredicted), as long as there is enough data
+     */
+    uint32_t x = slot.freq * (st.x0 >> SCALE_BITS) + slot.bias;
+    if (st.end0 - st.ptr0 >= 2)
+      {
+        const bool     renorm = x < RANS_L;
+        const uint32_t word   = (st.ptr0[0] << 8) | st.ptr0[1];
+
+        x = renorm ? (x << 16) | word : x;
+        st.ptr0 += renorm ? 2 : 0;
+      }
+    else if (x < RANS_L)
+      {
+        m_error = true;
+        return 0;
+      }
+    st.x0 = st.x1;
+    st.x1 = x;
+    std::swap (st.ptr0, st.ptr1);
+    std::swap (st.end0, st.end1);
+    return slot.symbol;
+  }
+  uint16_t
+  get_value (const Table& table, State& st)
+  {
+    const int s = get_symbol (table, st);
+    if (s != ESCAPE)
+      return s;
+
+    uint16_t z = 0;
+    if (get_raw (&z, 2))
+      z = GUINT16_FROM_LE (z);
+    return z;
+  }
+public:
+  Reader (const unsigned char *data, size_t size) :
+    m_ptr (data),
+    m_end (data + size)
+  {
+  }
+  bool init (uint32_t& n_frames);
+  bool error() const { return m_error; }
+
+  bool
+  get_raw (void *dest, size_t n)
+  {
+    if (size_t (m_raw_end - m_raw) < n)
+      {
+        m_error = true;
+        return false;
+      }
+    memcpy (dest, m_raw, n);
+    m_raw += n;
+    return true;
+  }
+  void
+  get_array (int ctx, vector<uint16_t>& values, const vector<uint16_t>& prev)
+  {
+    const Table& size_table = m_tables[CTX_SIZE];
+    const Table& table      = m_tables[ctx];
+    State        st         = m_state;
+
+    values.resize (unzigzag (get_value (size_table, st), prev.size()));
+
+    const int mode = get_symbol (size_table, st);
+    if (mode > MODE_NONE)
+      {
+        m_error = true;
+        return;
+      }
+    /* one loop per mode, without branches for the prediction */
+    uint16_t    *v = values.data();
+    const size_t n = values.size();
+    if (mode == MODE_PREV_FRAME)
+      {
+        const size_t    n_prev = std::min (n, prev.size());
+        const uint16_t *p      = prev.data();
+        for (size_t i = 0; i < n_prev; i++)
+          v[i] = unzigzag (get_value (table, st), p[i]);
+        for (size_t i = n_prev; i < n; i++)
+          v[i] = unzigzag (get_value (table, st), i > 0 ? v[i - 1] : 0);
+      }
+    else if (mode == MODE_PREV_VALUE)
+      {
+        uint16_t last = 0;
+        for (size_t i = 0; i < n; i++)
+          last = v[i] = unzigzag (get_value (table, st), last);
+      }
+    else
+      {
+        for (size_t i = 0; i < n; i++)
+          v[i] = unzigzag (get_value (table, st), 0);
+      }
+    m_state = st;
+  }
+};
+
+bool
+FrameCodec::Reader::init (uint32_t& n_frames)
+{
+  if (m_ptr == m_end || *m_ptr++ != FORMAT_VERSION)
+    return false;
+
+  uint32_t raw_size, rans_size, rans0_size;
+  if (!read_u32 (n_frames) || !read_u32 (raw_size) || !read_u32 (rans_size) || !read_u32 (rans0_size))
+    return false;
+
+  for (int ctx = 0; ctx < N_CONTEXTS; ctx++)
+    {
+      uint16_t freq[256] = { 0, };
+
+      uint16_t n;
+      if (!read_u16 (n) || n > 256)
+        return false;
+
+      for (int i = 0; i < n; i++)
+        {
+          if (m_ptr == m_end)
+            return false;
+
+          const int s = *m_ptr++;
+          if (!read_u16 (freq[s]))
+            return false;
+        }
+
+      /* tables with no symbols are valid (context not used, all slots have freq 0) */
+      Table& t = m_tables[ctx];
+      memset (t.slots, 0, sizeof (t.slots));
+
+      uint32_t start = 0;
+      for (int s = 0; s < 256; s++)
+        {
+          if (start + freq[s] > SCALE)
+            return false;
+
+          for (uint32_t i = 0; i < freq[s]; i++)
+            t.slots[start + i] = Slot { freq[s], uint16_t (i), uint8_t (s) };
+          start += freq[s];
+        }
+      if (start != SCALE && start != 0)
+        return false;
+    }
+  if (size_t (m_end - m_ptr) != size_t (raw_size) + rans_size || rans_size < 8 || rans0_size < 4 || rans0_size > rans_size - 4)
+    return false;
+
+  m_raw     = m_ptr;
+  m_raw_end = m_ptr + raw_size;
+
+  /* each rANS stream starts with the initial state of its coder */
+  auto init_coder = [] (const unsigned char *start, const unsigned char *end, uint32_t& x, const unsigned char *&ptr, const unsigned char *&ptr_end)
+    {
+      x = 0;
+      for (int b = 0; b < 4; b++)
+        x = (x << 8) | start[b];
+      ptr     = start + 4;
+      ptr_end = end;
+    };
+  init_coder (m_raw_end, m_raw_end + rans0_size, m_state.x0, m_state.ptr0, m_state.end0);
+  init_coder (m_raw_end + rans0_size, m_end, m_state.x1, m_state.ptr1, m_state.end1);
+
+  return true;
+}
+
+bool
+FrameCodec::can_encode (const vector<AudioBlock>& contents)
+{
+  for (const auto& block : contents)
+    if (!block.original_fft.empty() || !block.debug_samples.empty())
+      return false;
+
+  return true;
+}
+
+void
+FrameCodec::encode (const vector<AudioBlock>& contents, vector<unsigned char>& out)
+{
+  assert (can_encode (contents));
+
+  Writer writer;
+  AudioBlock empty_block;
+
+  for (size_t f = 0; f < contents.size(); f++)
+    {
+      const AudioBlock& block = contents[f];
+      const AudioBlock& prev  = f > 0 ? contents[f - 1] : empty_block;
+
+      writer.put_array (CTX_NOISE,  block.noise, prev.noise);
+      writer.put_array (CTX_FREQS,  block.freqs, prev.freqs);
+      writer.put_array (CTX_MAGS,   block.mags, prev.mags);
+      writer.put_array (CTX_PHASES, block.phases, prev.phases);
+      writer.put_array (CTX_ENV,    block.env, prev.env);
+
+      uint32_t env_f0;
+      memcpy (&env_f0, &block.env_f0, 4);
+      write_u32 (writer.raw, env_f0);
+    }
+
+  out.clear();
+  out.push_back (FORMAT_VERSION);
+  write_u32 (out, contents.size());
+  writer.finish (out);
+}
+
+FrameCodec::Decoder::Decoder()
+{
+}
+
+FrameCodec::Decoder::~Decoder()
+{
+}
+
+bool
+FrameCodec::Decoder::init (const unsigned char *data, size_t size, size_t n_frames)
+{
+  /* Reader is too large for the stack (frequency tables) */
+  m_reader.reset (new Reader (data, size));
+  m_next_frame = 0;
+
+  uint32_t n;
+  if (!m_reader->init (n) || n != n_frames)
+    {
+      m_reader.reset();
+      return false;
+    }
+  m_n_frames = n_frames;
+  return true;
+}
+
+bool
+FrameCodec::Decoder::decode (vector<AudioBlock>& contents, size_t end_frame)
+{
+  if (!m_reader || contents.size() != m_n_frames || end_frame > m_n_frames)
+    return false;
+
+  AudioBlock empty_block;
+
+  for (size_t f = m_next_frame; f < end_frame; f++)
+    {
+      AudioBlock& block = contents[f];
+      const AudioBlock& prev = f > 0 ? contents[f - 1] : empty_block;
+
+      m_reader->get_array (CTX_NOISE,  block.noise, prev.noise);
+      m_reader->get_array (CTX_FREQS,  block.freqs, prev.freqs);
+      m_reader->get_array (CTX_MAGS,   block.mags, prev.mags);
+      m_reader->get_array (CTX_PHASES, block.phases, prev.phases);
+      m_reader->get_array (CTX_ENV,    block.env, prev.env);
+
+      uint32_t env_f0 = 0;
+      if (m_reader->get_raw (&env_f0, 4))
+        env_f0 = GUINT32_FROM_LE (env_f0);
+      memcpy (&block.env_f0, &env_f0, 4);
+
+      if (m_reader->error())
+        {
+          m_reader.reset(); // can't continue after errors
+          return false;
+        }
+      m_next_frame = f + 1;
+    }
+  return true;
+}
+
+size_t
+FrameCodec::Decoder::next_frame() const
+{
+  return m_next_frame;
+}
+
+bool
+FrameCodec::decode (const unsigned char *data, size_t size, vector<AudioBlock>& contents)
+{
+  Decoder decoder;
+
+  return decoder.init (data, size, contents.size()) && decoder.decode (contents, contents.size());
+}
@@ -0,0 +1,52 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#ifndef SPECTMORPH_FRAME_CODEC_HH
+#define SPECTMORPH_FRAME_CODEC_HH
+
+#include "smaudio.hh"
+
+#include <memory>
+
+namespace SpectMorph
+{
+
+/*
+ * Lossless compression for the frame data (noise, freqs, mags, phases, env, env_f0)
+ * of Audio objects
+ *
+ * Each array is predicted either from the same array in the previous frame or from
+ * the previous value in the same frame (or not at all), whatever works best for the
+ * frame. The prediction residuals are entropy coded using rANS with one frequency
+ * table per array type. Debug data (original_fft, debug_samples) is not supported.
+ */
+namespace FrameCodec
+{
+
+bool can_encode (const std::vector<AudioBlock>& contents);
+void encode (const std::vector<AudioBlock>& contents, std::vector<unsigned char>& out);
+
+/* contents needs to have the right size (frame_count) */
+bool decode (const unsigned char *data, size_t size, std::vector<AudioBlock>& contents);
+
+class Reader;
+
+/* decodes the frames in order, in as many steps as needed (data must stay valid while decoding) */
+class Decoder
+{
+  std::unique_ptr<Reader> m_reader;
+  size_t                  m_n_frames = 0;
+  size_t                  m_next_frame = 0;
+public:
+  Decoder();
+  ~Decoder();
+
+  bool   init (const unsigned char *data, size_t size, size_t n_frames);
+  bool   decode (std::vector<AudioBlock>& contents, size_t end_frame); // decode frames up to (not including) end_frame
+  size_t next_frame() const;
+};
+
+}
+
+}
+
+#endif
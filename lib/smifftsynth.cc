@@ -4,6 +4,7 @@
 #include "smmath.hh"
 #include "smfft.hh"
 #include "smblockutils.hh"
+#include "smmain.hh"
 #include <assert.h>
 #include <stdio.h>
 
@@ -60,6 +61,11 @@ IFFTSynth::IFFTSynth (size_t block_size, double mix_freq, WindowType win_type) :
               table->win_trans.push_back (wspectrum[abs (pos * 2)]);
             }
         }
+      for (auto w : table->win_trans)
+        {
+          table->win_trans_sse.push_back (w);
+          table->win_trans_sse.push_back (w);
+        }
       FFT::free_array_float (win);
       FFT::free_array_float (wspectrum);
 
@@ -87,6 +93,7 @@ IFFTSynth::IFFTSynth (size_t block_size, double mix_freq, WindowType win_type) :
   freq256_factor = 1 / mix_freq * block_size * zero_padding;
   freq256_to_qfreq = mix_freq / 256.0 / block_size;
   mag_norm = 0.5 / block_size;
+  use_sse = sm_sse();
 }
 
 IFFTSynth::~IFFTSynth()
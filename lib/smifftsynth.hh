@@ -21,6 +21,7 @@ class IFFTSynth
   float              freq256_factor;
   float              freq256_to_qfreq;
   float              mag_norm;
+  bool               use_sse;
 
   float             *fft_in;
   float             *fft_out;
@@ -73,6 +74,7 @@ public:
 struct IFFTSynthTable
 {
   std::vector<float> win_trans;
+  std::vector<float> win_trans_sse; // win_trans with each value duplicated (for real and imaginary part)
 
   float             *win_scale;
 };
@@ -110,6 +112,25 @@ IFFTSynth::render_partial (float mf_freq, float mag, uint phase)
   /* compute FFT spectrum modifications */
   if (ibin > range && 2 * (ibin + range) < static_cast<int> (block_size))
     {
+#if defined(__SSE__) || defined(SM_ARM_SSE)
+      if (use_sse)
+        {
+          const float *wmag2_p = &table->win_trans_sse[(freq256 & 0xff) * (range * 2 + 1) * 2];
+          const __m128 phase_rcsmag = _mm_set_ps (phase_rsmag, phase_rcmag, phase_rsmag, phase_rcmag);
+
+          /* bins 0..7: two bins per vector */
+          for (int i = 0; i < 2 * range; i += 2)
+            {
+              const __m128 wmag = _mm_loadu_ps (wmag2_p + 2 * i);
+              _mm_storeu_ps (sp + 2 * i, _mm_add_ps (_mm_loadu_ps (sp + 2 * i), _mm_mul_ps (phase_rcsmag, wmag)));
+            }
+          /* bin 8 */
+          const float wmag = wmag_p[2 * range];
+          sp[4 * range] += phase_rcmag * wmag;
+          sp[4 * range + 1] += phase_rsmag * wmag;
+          return;
+        }
+#endif
       for (int i = 0; i <= 2 * range; i++)
         {
           const float wmag = wmag_p[i];
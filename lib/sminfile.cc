@@ -3,6 +3,7 @@
 #include "sminfile.hh"
 #include "smutils.hh"
 #include <assert.h>
+#include <string.h>
 #include <glib.h>
 
 using std::string;
@@ -34,6 +35,23 @@ InFile::InFile (GenericInP file) :
   read_file_type_and_version();
 }
 
+/**
+ * Create InFile object for reading events from an input stream that has no file
+ * type and version header, like a part of a file that starts at an event (see
+ * GenericIn::open_subfile). The file type and version are provided by the caller.
+ *
+ * \param file the input stream object to read data from
+ * \param file_type file type of the file the input stream is part of
+ * \param file_version file version of the file the input stream is part of
+ */
+InFile::InFile (GenericInP file, const string& file_type, int file_version) :
+  file (file),
+  m_file_type (file_type),
+  m_file_version (file_version)
+{
+  current_event = NONE;
+}
+
 void
 InFile::read_file_type_and_version()
 {
@@ -94,12 +112,190 @@ InFile::read_raw_string (string& str)
   return false;
 }
 
+static bool
+mem_read_int (const unsigned char *& p, const unsigned char *end, int& i)
+{
+  if (end - p < 4)
+    return false;
+
+  int32_t le_i;
+  memcpy (&le_i, p, 4);
+  i = GINT32_FROM_LE (le_i);
+  p += 4;
+  return true;
+}
+
+static bool
+mem_read_float (const unsigned char *& p, const unsigned char *end, float& f)
+{
+  int i;
+  if (!mem_read_int (p, end, i))
+    return false;
+
+  memcpy (&f, &i, 4);
+  return true;
+}
+
+static bool
+mem_read_string (const unsigned char *& p, const unsigned char *end, const char *& str, size_t& len)
+{
+  const unsigned char *zero = static_cast<const unsigned char *> (memchr (p, 0, end - p));
+  if (!zero)
+    return false;
+
+  str = reinterpret_cast<const char *> (p);
+  len = zero - p;
+  p = zero + 1;
+  return true;
+}
+
+static bool
+mem_skip_block (const unsigned char *& p, const unsigned char *end, size_t element_size, size_t& size)
+{
+  int isize;
+  if (!mem_read_int (p, end, isize) || isize < 0 || size_t (end - p) < isize * element_size)
+    return false;
+
+  size = isize;
+  p += size * element_size;
+  return true;
+}
+
+/* same as next_event(), but parses from memory instead of using (virtual) GenericIn functions
+ *
+ * returns the number of bytes consumed
+ */
+size_t
+InFile::next_event_mem (const unsigned char *mem, const unsigned char *end)
+{
+  const unsigned char *p = mem;
+  const char *name;
+  size_t      name_len;
+
+  current_event_mem_block = nullptr;
+
+  for (;;)
+    {
+      current_event = READ_ERROR;
+      if (p == end)
+        return p - mem;
+
+      const int c = *p++;
+      if (c == 'Z')  // eof
+        {
+          if (p == end)   // Z needs to be followed by EOF
+            current_event = END_OF_FILE;
+          return p - mem;
+        }
+      if (c == 'E')
+        {
+          current_event = END_SECTION;
+          return p - mem;
+        }
+      if (!mem_read_string (p, end, name, name_len))
+        return p - mem;
+
+      current_event_id = lookup_id (name, name_len);
+      if (current_event_id == UNKNOWN_ID)
+        current_event_str.assign (name, name_len);
+
+      if (c == 'B')
+        {
+          current_event = BEGIN_SECTION;
+        }
+      else if (c == 'f')
+        {
+          if (mem_read_float (p, end, current_event_float))
+            current_event = FLOAT;
+        }
+      else if (c == 'i')
+        {
+          if (mem_read_int (p, end, current_event_int))
+            current_event = INT;
+        }
+      else if (c == 'b')
+        {
+          if (p < end && *p <= 1)
+            {
+              current_event_bool = *p++;
+              current_event = BOOL;
+            }
+        }
+      else if (c == 's')
+        {
+          const char *data;
+          size_t      data_len;
+          if (mem_read_string (p, end, data, data_len))
+            {
+              current_event_data.assign (data, data_len);
+              current_event = STRING;
+            }
+        }
+      else if (c == 'F' || c == '6')
+        {
+          const size_t element_size = c == 'F' ? 4 : 2;
+          const unsigned char *size_p = p;
+          if (!mem_skip_block (p, end, element_size, current_event_block_size))
+            return p - mem;
+
+          if (current_event_id != UNKNOWN_ID && interned_skip[current_event_id])
+            continue;
+
+          /* block data is only copied if it is needed */
+          current_event_mem_block = size_p + 4;
+          current_event = c == 'F' ? FLOAT_BLOCK : UINT16_BLOCK;
+        }
+      else if (c == 'O')
+        {
+          int blob_size;
+          const char *blob_sum;
+          size_t      blob_sum_len;
+          if (mem_read_int (p, end, blob_size) && mem_read_string (p, end, blob_sum, blob_sum_len))
+            {
+              current_event_blob_sum.assign (blob_sum, blob_sum_len);
+              if (blob_size == -1)
+                {
+                  current_event = BLOB_REF;
+                }
+              else if (blob_size >= 0 && end - p >= blob_size)
+                {
+                  current_event = BLOB;
+                  current_event_blob_size = blob_size;
+                  current_event_blob_pos  = file->get_pos() + (p - mem);
+                  p += blob_size; // skip actual blob data
+                }
+            }
+        }
+      return p - mem;
+    }
+}
+
+bool
+InFile::read_event_name()
+{
+  if (!read_raw_string (current_event_str))
+    return false;
+
+  current_event_id = lookup_id (current_event_str.data(), current_event_str.size());
+  return true;
+}
+
 /**
  * Reads next event from file. Call event() to get event type, and event_*() to get event data.
  */
 void
 InFile::next_event()
 {
+  size_t remaining;
+  const unsigned char *mem = file->mmap_mem (remaining);
+  if (mem)
+    {
+      file->skip (next_event_mem (mem, mem + remaining));
+      return;
+    }
+
+  current_event_mem_block = nullptr;
+
   int c = file->get_byte();
 
   if (c == 'Z')  // eof
@@ -113,7 +309,7 @@ InFile::next_event()
   else if (c == 'B')
     {
       current_event = READ_ERROR;
-      if (read_raw_string (current_event_str))
+      if (read_event_name())
         current_event = BEGIN_SECTION;
     }
   else if (c == 'E')
@@ -123,37 +319,37 @@ InFile::next_event()
   else if (c == 'f')
     {
       current_event = READ_ERROR;
-      if (read_raw_string (current_event_str))
+      if (read_event_name())
         if (read_raw_float (current_event_float))
           current_event = FLOAT;
     }
   else if (c == 'i')
     {
       current_event = READ_ERROR;
-      if (read_raw_string (current_event_str))
+      if (read_event_name())
         if (read_raw_int (current_event_int))
           current_event = INT;
     }
   else if (c == 'b')
     {
       current_event = READ_ERROR;
-      if (read_raw_string (current_event_str))
+      if (read_event_name())
         if (read_raw_bool (current_event_bool))
           current_event = BOOL;
     }
   else if (c == 's')
     {
       current_event = READ_ERROR;
-      if (read_raw_string (current_event_str))
+      if (read_event_name())
         if (read_raw_string (current_event_data))
           current_event = STRING;
     }
   else if (c == 'F')
     {
       current_event = READ_ERROR;
-      if (read_raw_string (current_event_str))
+      if (read_event_name())
         {
-          if (skip_events.find (current_event_str) != skip_events.end())
+          if (current_event_id != UNKNOWN_ID && interned_skip[current_event_id])
             {
               if (skip_raw_float_block())
                 {
@@ -172,9 +368,9 @@ InFile::next_event()
     {
       current_event = READ_ERROR;
 
-      if (read_raw_string (current_event_str))
+      if (read_event_name())
         {
-          if (skip_events.find (current_event_str) != skip_events.end())
+          if (current_event_id != UNKNOWN_ID && interned_skip[current_event_id])
             {
               if (skip_raw_uint16_block())
                 {
@@ -192,7 +388,7 @@ InFile::next_event()
   else if (c == 'O')
     {
       current_event = READ_ERROR;
-      if (read_raw_string (current_event_str))
+      if (read_event_name())
         {
           int blob_size;
           if (read_raw_int (blob_size))
@@ -357,9 +553,56 @@ InFile::open_blob()
 string
 InFile::event_name() const
 {
+  if (current_event_id != UNKNOWN_ID)
+    return interned_names[current_event_id];
+
   return current_event_str;
 }
 
+/**
+ * Get id of the name of the current event.
+ *
+ * \returns the id returned by intern() for the current event name, or UNKNOWN_ID if the name was not interned
+ */
+int
+InFile::event_id() const
+{
+  return current_event_id;
+}
+
+int
+InFile::lookup_id (const char *name, size_t len) const
+{
+  for (size_t id = 0; id < interned_names.size(); id++)
+    {
+      const string& s = interned_names[id];
+      if (s.size() == len && memcmp (s.data(), name, len) == 0)
+        return id;
+    }
+  return UNKNOWN_ID;
+}
+
+/**
+ * Intern an event name: events with this name will have an event_id() that can
+ * be compared to the returned id. Ids are assigned in the order of the intern()
+ * calls, starting at 0.
+ *
+ * \param name event name
+ * \returns id for this event name
+ */
+int
+InFile::intern (const string& name)
+{
+  int id = lookup_id (name.data(), name.size());
+  if (id == UNKNOWN_ID)
+    {
+      id = interned_names.size();
+      interned_names.push_back (name);
+      interned_skip.push_back (false);
+    }
+  return id;
+}
+
 string
 InFile::event_type() const
 {
@@ -434,6 +677,11 @@ InFile::event_data()
 const vector<float>&
 InFile::event_float_block()
 {
+  if (current_event_mem_block && current_event == FLOAT_BLOCK)
+    {
+      read_event_float_block (current_event_float_block);
+      current_event_mem_block = nullptr;
+    }
   return current_event_float_block;
 }
 
@@ -445,9 +693,77 @@ InFile::event_float_block()
 const vector<uint16_t>&
 InFile::event_uint16_block()
 {
+  if (current_event_mem_block && current_event == UINT16_BLOCK)
+    {
+      read_event_uint16_block (current_event_uint16_block);
+      current_event_mem_block = nullptr;
+    }
   return current_event_uint16_block;
 }
 
+/**
+ * Get float block data of the current event (only if the event is FLOAT_BLOCK).
+ *
+ * If the file is memory mapped, the data is copied directly into the destination
+ * vector, which avoids the extra copy of event_float_block().
+ *
+ * \param fb destination vector
+ * \returns true if the current event is a FLOAT_BLOCK
+ */
+bool
+InFile::read_event_float_block (vector<float>& fb)
+{
+  if (current_event != FLOAT_BLOCK)
+    return false;
+
+  if (!current_event_mem_block)
+    {
+      fb = current_event_float_block;
+      return true;
+    }
+  fb.resize (current_event_block_size);
+  if (!fb.empty())
+    memcpy (fb.data(), current_event_mem_block, fb.size() * 4);
+
+#if G_BYTE_ORDER != G_LITTLE_ENDIAN
+  int *buffer = reinterpret_cast <int*> (fb.data());
+  for (size_t x = 0; x < fb.size(); x++)
+    buffer[x] = GINT32_FROM_LE (buffer[x]);
+#endif
+  return true;
+}
+
+/**
+ * Get uint16 block data of the current event (only if the event is UINT16_BLOCK).
+ *
+ * If the file is memory mapped, the data is copied directly into the destination
+ * vector, which avoids the extra copy of event_uint16_block().
+ *
+ * \param ib destination vector
+ * \returns true if the current event is an UINT16_BLOCK
+ */
+bool
+InFile::read_event_uint16_block (vector<uint16_t>& ib)
+{
+  if (current_event != UINT16_BLOCK)
+    return false;
+
+  if (!current_event_mem_block)
+    {
+      ib = current_event_uint16_block;
+      return true;
+    }
+  ib.resize (current_event_block_size);
+  if (!ib.empty())
+    memcpy (ib.data(), current_event_mem_block, ib.size() * 2);
+
+#if G_BYTE_ORDER != G_LITTLE_ENDIAN
+  for (size_t x = 0; x < ib.size(); x++)
+    ib[x] = GUINT16_FROM_LE (ib[x]);
+#endif
+  return true;
+}
+
 /**
  * Get blob's checksum.  This works for both: BLOB objects and BLOB_REF
  * objects.  During writing files, the first occurence of a BLOB is stored
@@ -463,15 +779,15 @@ InFile::event_blob_sum()
 }
 
 /**
- * Add event names to skip (currently only implemented for FLOAT_BLOCK events); this
- * speeds up reading files, while ignoring certain events.
+ * Add event names to skip (only implemented for FLOAT_BLOCK and UINT16_BLOCK events);
+ * this speeds up reading files, while ignoring certain events. The name is interned.
  *
  * \param skip_event name of the event to skip
  */
 void
 InFile::add_skip_event (const string& skip_event)
 {
-  skip_events.insert (skip_event);
+  interned_skip[intern (skip_event)] = true;
 }
 
 /**
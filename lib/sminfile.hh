@@ -22,6 +22,12 @@ namespace SpectMorph
  * from a GenericIn object; the files consist of events, which are read one by
  * one until an error occurs or until EOF. The events are typed, end the event
  * data should be queried according to the current event type.
+ *
+ * For fast parsing, event names can be interned (see intern()): then the
+ * current event can be identified by comparing event_id() to the interned
+ * id instead of comparing the event name string. If the input is memory
+ * mapped, events are parsed directly from memory, and blocks can be copied
+ * directly into their destination (see read_event_uint16_block()).
  */
 class InFile
 {
@@ -42,23 +48,29 @@ public:
     BLOB_REF
   };
 
+  static constexpr int UNKNOWN_ID = -1;
+
 protected:
   GenericInP            file;
   Event                 current_event;
-  std::string           current_event_str;
+  int                   current_event_id = UNKNOWN_ID;
+  std::string           current_event_str; // only set if event name is not interned
   bool                  current_event_bool;
   int                   current_event_int;
   std::string           current_event_data;
   float                 current_event_float;
   std::vector<float>    current_event_float_block;
   std::vector<uint16_t> current_event_uint16_block;
+  const unsigned char  *current_event_mem_block = nullptr; // block data in mapped memory (not yet copied)
+  size_t                current_event_block_size = 0;
   size_t                current_event_blob_pos;
   size_t                current_event_blob_size;
   std::string           current_event_blob_sum;
   std::string           m_file_type;
   int                   m_file_version;
 
-  std::set<std::string> skip_events;
+  std::vector<std::string> interned_names;
+  std::vector<bool>        interned_skip;
 
   bool        read_raw_bool (bool& b);
   bool        read_raw_string (std::string& str);
@@ -70,10 +82,14 @@ protected:
   bool        skip_raw_uint16_block();
 
   void        read_file_type_and_version();
+  size_t      next_event_mem (const unsigned char *mem, const unsigned char *end);
+  bool        read_event_name();
+  int         lookup_id (const char *name, size_t len) const;
 
 public:
   InFile (const std::string& filename);
   InFile (GenericInP file);
+  InFile (GenericInP file, const std::string& file_type, int file_version);
 
   /**
    * Check if file open succeeded.
@@ -87,6 +103,7 @@ public:
   }
   Event        event();
   std::string  event_name() const;
+  int          event_id() const;
   std::string  event_type() const;
   float        event_float();
   int          event_int();
@@ -94,10 +111,13 @@ public:
   std::string  event_data();
   const std::vector<float>&     event_float_block();
   const std::vector<uint16_t>&  event_uint16_block();
+  bool         read_event_float_block (std::vector<float>& fb);
+  bool         read_event_uint16_block (std::vector<uint16_t>& ib);
   std::string  event_blob_sum();
 
   void         next_event();
   void         add_skip_event (const std::string& event);
+  int          intern (const std::string& name);
   std::string  file_type();
   int          file_version();
 
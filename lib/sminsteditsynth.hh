@@ -19,6 +19,7 @@ class InstEditSynth
 public:
   struct Decoders {
     std::unique_ptr<WavSet> wav_set;
+    std::shared_ptr<WavSet> ref_wav_set;
     std::vector<std::unique_ptr<LiveDecoder>> decoders;
   };
 private:
@@ -50,7 +51,7 @@ private:
 public:
   InstEditSynth (float mix_freq);
 
-  Decoders create_decoders (WavSet *take_wav_set, WavSet *ref_wav_set);
+  Decoders create_decoders (WavSet *take_wav_set, const std::shared_ptr<WavSet>& ref_wav_set);
   void swap_decoders (Decoders& decoders);
 
   void set_gain (float gain);
@@ -12,8 +12,11 @@
 
 #include <assert.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
 #include <glib/gstdio.h>
 #include <utime.h>
+#include <time.h>
 
 using namespace SpectMorph;
 
@@ -29,10 +32,20 @@ cache_filename (const string& filename)
   return sm_get_user_dir (USER_DIR_CACHE) + "/" + filename;
 }
 
+/* index of all cache files, shared by all processes that use the cache directory */
+static string
+index_filename()
+{
+  return cache_filename ("inst_enc_index");
+}
+
 InstEncCache::InstEncCache() :
   cache_file_re ("inst_enc_[0-9a-f]{8}_[0-9a-f]{8}_[0-9]+_[0-9a-f]{40}$")
 {
-  delete_old_files();
+  std::lock_guard<std::mutex> lg (cache_mutex);
+
+  disk_index_update_L();
+  delete_old_files_L();
 }
 
 InstEncCache*
@@ -42,78 +55,81 @@ InstEncCache::the()
 }
 
 void
-InstEncCache::cache_save_L (const string& key)
+InstEncCache::cache_save_L (const string& key, const string& version, const vector<unsigned char>& data)
 {
-  const CacheData& cache_data = cache[key];
-
   BinBuffer buffer;
 
   buffer.write_start ("SpectMorphCache");
-  buffer.write_string (cache_data.version.c_str());
-  buffer.write_int (cache_data.data.size());
-  buffer.write_string (sha1_hash (cache_data.data.data(), cache_data.data.size()).c_str());
+  buffer.write_string (version.c_str());
+  buffer.write_int (data.size());
+  buffer.write_string (sha1_hash (data.data(), data.size()).c_str());
   buffer.write_end();
 
-  vector<string> files;
-  Error error = read_dir (sm_get_user_dir (USER_DIR_CACHE), files);
-  for (auto filename : files)
+  /* only one version per key: remove old cache file */
+  auto it = disk_index.find (key);
+  if (it != disk_index.end())
     {
-      if (regex_search (filename, cache_file_re)) /* avoid unlink on something that we shouldn't delete */
-        {
-          if (filename.size() > key.size() && filename.compare (0, key.size(), key) == 0)
-            {
-              unlink (cache_filename (filename).c_str());
-            }
-        }
+      unlink (cache_filename (key + "_" + it->second.version).c_str());
+      disk_index_log_remove_L (key, it->second.version);
+      disk_index_remove_L (key);
     }
 
-  string out_filename = cache_filename (key) + "_" + cache_data.version;
+  string out_filename = cache_filename (key) + "_" + version;
   FILE *outf = fopen (out_filename.c_str(), "wb");
   if (outf)
     {
-      for (auto ch : buffer.to_string())
+      const string header = buffer.to_string();
+      for (auto ch : header)
         fputc (ch, outf);
       fputc (0, outf);
-      const unsigned char *ptr = cache_data.data.data();
-      fwrite (ptr, 1, cache_data.data.size(), outf);
+      fwrite (data.data(), 1, data.size(), outf);
       fclose (outf);
+
+      DiskEntry entry;
+      entry.version = version;
+      entry.size    = header.size() + 1 + data.size();
+      entry.mtime   = time (nullptr);
+      disk_index_add_L (key, entry);
+      disk_index_log_add_L (key, entry);
     }
 }
 
-static bool
-ends_with (const string& value, const string& ending)
+void
+InstEncCache::cache_try_load_L (const string& cache_key, const string& need_version)
 {
-  if (ending.size() > value.size())
-    return false;
+  /* other processes (for instance other plugin instances) may have added files since we read the index */
+  if (!disk_versions.count (need_version))
+    disk_index_update_L();
+
+  auto vit = disk_versions.find (need_version);
+  if (vit == disk_versions.end())  // no cache entry
+    return;
 
-  return std::equal (ending.rbegin(), ending.rend(), value.rbegin());
+  /* the version doesn't depend on the cache key, so any file with the right version can be used
+   * (copy the keys, because entries of files that can't be opened are removed while trying)
+   */
+  const std::set<string> disk_keys = vit->second;
+  for (const auto& disk_key : disk_keys)
+    {
+      if (cache_try_load_file_L (cache_key, disk_key, need_version))
+        return;
+    }
 }
 
-void
-InstEncCache::cache_try_load_L (const string& cache_key, const string& need_version)
+bool
+InstEncCache::cache_try_load_file_L (const string& cache_key, const string& disk_key, const string& need_version)
 {
-  GenericInP in_file;
-  string     abs_filename;
+  const string abs_filename = cache_filename (disk_key + "_" + need_version);
 
-  vector<string> files;
-  Error error = read_dir (sm_get_user_dir (USER_DIR_CACHE), files);
-  for (auto filename : files)
+  GenericInP in_file = GenericIn::open (abs_filename);
+  if (!in_file)
     {
-      if (regex_search (filename, cache_file_re))
-        {
-          if (ends_with (filename, need_version))
-            {
-              abs_filename = cache_filename (filename);
-              in_file = GenericIn::open (abs_filename);
-              if (in_file)
-                break;
-            }
-        }
+      // file was removed (for instance by another process)
+      disk_index_log_remove_L (disk_key, need_version);
+      disk_index_remove_L (disk_key);
+      return false;
     }
 
-  if (!in_file)  // no cache entry
-    return;
-
   // read header (till zero char)
   string header_str;
   int ch;
@@ -136,16 +152,24 @@ InstEncCache::cache_try_load_L (const string& cache_key, const string& need_vers
           string load_data_hash = sha1_hash (data.data(), data.size());
           if (load_data_hash == data_hash)
             {
-              cache[cache_key].version = version;
-              cache[cache_key].data    = std::move (data);
+              /* memory cache stores the parsed audio, so we only parse once */
+              auto audio = std::make_shared<Audio>();
+              Error error = audio->load (MMapIn::open_vector (data));
+              if (error)
+                return false;
+
+              cache_set_L (cache_key, version, audio);
 
               /* bump mtime on successful load; this information is used during
-               * InstEncCache::delete_old_files() to remove the oldest cache files
+               * InstEncCache::delete_old_files_L() to remove the oldest cache files
                */
               g_utime (abs_filename.c_str(), nullptr);
+              disk_index[disk_key].mtime = time (nullptr);
+              return true;
             }
         }
     }
+  return false;
 }
 
 static string
@@ -170,7 +194,7 @@ mk_version (const string& wav_data_hash, int midi_note, int iclipstart, int icli
   return sha1_hash (depends);
 }
 
-Audio *
+std::shared_ptr<const Audio>
 InstEncCache::encode (Group *group, const WavData& wav_data, const string& wav_data_hash, int midi_note, int iclipstart, int iclipend, Instrument::EncoderConfig& cfg,
                       const std::function<bool()>& kill_function)
 {
@@ -186,9 +210,9 @@ InstEncCache::encode (Group *group, const WavData& wav_data, const string& wav_d
   string version   = mk_version (wav_data_hash, midi_note, iclipstart, iclipend, cfg);
 
   // search disk cache and memory cache
-  Audio *audio = cache_lookup (cache_key, version);
-  if (audio)
-    return audio;
+  std::shared_ptr<const Audio> cached_audio = cache_lookup (cache_key, version);
+  if (cached_audio)
+    return cached_audio;
 
   /* clip sample */
   vector<float> clipped_samples = wav_data.samples();
@@ -204,7 +228,7 @@ InstEncCache::encode (Group *group, const WavData& wav_data, const string& wav_d
   WavData wav_data_clipped (clipped_samples, 1, wav_data.mix_freq(), wav_data.bit_depth());
 
   InstEncoder enc;
-  audio = enc.encode (wav_data_clipped, midi_note, cfg, kill_function);
+  std::shared_ptr<const Audio> audio (enc.encode (wav_data_clipped, midi_note, cfg, kill_function));
   if (!audio)
     return nullptr;
 
@@ -213,49 +237,76 @@ InstEncCache::encode (Group *group, const WavData& wav_data, const string& wav_d
   return audio;
 }
 
-Audio *
+std::shared_ptr<const Audio>
 InstEncCache::cache_lookup (const string& cache_key, const string& version)
 {
   std::lock_guard<std::mutex> lg (cache_mutex);
-  if (cache[cache_key].version != version)
+
+  /* the version is a hash of all encoder inputs, so if another group (project,
+   * editor session) encoded the same input, we can use its result
+   */
+  auto vit = cache_versions.find (version);
+  if (vit == cache_versions.end())
     {
       cache_try_load_L (cache_key, version);
+      vit = cache_versions.find (version);
     }
-  if (cache[cache_key].version == version) // cache hit (in memory)
+  if (vit != cache_versions.end()) // cache hit (in memory)
     {
-      vector<unsigned char>& data = cache[cache_key].data;
-      cache[cache_key].read_stamp = cache_read_stamp++;
-
-      Audio     *audio = new Audio;
-      Error      error = audio->load (MMapIn::open_vector (data));
+      CacheData& cache_data = cache[vit->second];
+      cache_data.read_stamp = cache_read_stamp++;
 
-      if (!error)
-        return audio;
-
-      delete audio;
+      /* cached audio objects are immutable, so they can be shared without copying */
+      return cache_data.audio;
     }
   return nullptr;
 }
 
 void
-InstEncCache::cache_add (const string& cache_key, const string& version, const Audio *audio)
+InstEncCache::cache_set_L (const string& cache_key, const string& version, std::shared_ptr<const Audio> audio)
+{
+  cache_erase_L (cache_key);
+
+  CacheData& cache_data = cache[cache_key];
+  cache_data.version    = version;
+  cache_data.audio      = audio;
+  cache_data.mem_size   = audio->mem_usage();
+  cache_data.read_stamp = cache_read_stamp++;
+
+  cache_versions[version] = cache_key;
+}
+
+void
+InstEncCache::cache_erase_L (const string& cache_key)
+{
+  auto it = cache.find (cache_key);
+  if (it == cache.end())
+    return;
+
+  auto vit = cache_versions.find (it->second.version);
+  if (vit != cache_versions.end() && vit->second == cache_key)
+    cache_versions.erase (vit);
+
+  cache.erase (it);
+}
+
+void
+InstEncCache::cache_add (const string& cache_key, const string& version, std::shared_ptr<const Audio> audio)
 {
+  /* serialized data is only needed for the disk cache */
   vector<unsigned char> data;
   audio->save (MemOut::open (&data));
 
   // LOCK cache: store entry
   std::lock_guard<std::mutex> lg (cache_mutex);
 
-  cache[cache_key].version    = version;
-  cache[cache_key].data       = data;
-  cache[cache_key].read_stamp = cache_read_stamp++;
-
-  cache_save_L (cache_key);
+  cache_set_L (cache_key, version, audio);
+  cache_save_L (cache_key, version, data);
 
   /* enforce size limits and expire cache data from time to time */
   if ((cache_read_stamp % 10) == 0)
     {
-      delete_old_files();
+      delete_old_files_L();
       delete_old_memory_L();
     }
 }
@@ -266,6 +317,7 @@ InstEncCache::clear()
   std::lock_guard<std::mutex> lg (cache_mutex);
 
   cache.clear();
+  cache_versions.clear();
 }
 
 InstEncCache::Group *
@@ -278,33 +330,243 @@ InstEncCache::create_group()
 }
 
 void
-InstEncCache::delete_old_files()
+InstEncCache::disk_index_clear_L()
 {
-  struct Status
-  {
-    string abs_filename;
-    uint64 mtime = 0;
-    size_t size = 0;
-  };
-  vector<string> files;
-  vector<Status> file_status;
+  disk_index.clear();
+  disk_versions.clear();
+  disk_total_size = 0;
 
+  disk_index_ino   = 0;
+  disk_index_pos   = 0;
+  disk_index_lines = 0;
+}
+
+void
+InstEncCache::disk_index_scan_L()
+{
+  disk_index_clear_L();
+
+  vector<string> files;
   Error error = read_dir (sm_get_user_dir (USER_DIR_CACHE), files);
   if (error)
     return;
 
   for (auto filename : files)
     {
-      Status status;
-      status.abs_filename = cache_filename (filename);
+      /* using a regexp here avoids deleting unrelated files; even if something is
+       * misconfigured this should make calling unlink() relatively safe */
+      if (!regex_search (filename, cache_file_re))
+        continue;
+
       GStatBuf stbuf;
-      if (g_stat (status.abs_filename.c_str(), &stbuf) == 0)
+      if (g_stat (cache_filename (filename).c_str(), &stbuf) != 0)
+        continue;
+
+      const size_t version_len = 40; // sha1
+      DiskEntry entry;
+      entry.version = filename.substr (filename.size() - version_len);
+      entry.size    = stbuf.st_size;
+      entry.mtime   = stbuf.st_mtime;
+
+      const string key = filename.substr (0, filename.size() - version_len - 1);
+      auto it = disk_index.find (key);
+      if (it != disk_index.end())
+        {
+          /* more than one version per key: keep the newest file */
+          if (it->second.mtime > entry.mtime)
+            {
+              unlink (cache_filename (filename).c_str());
+              continue;
+            }
+          unlink (cache_filename (key + "_" + it->second.version).c_str());
+          disk_index_remove_L (key);
+        }
+      disk_index_add_L (key, entry);
+    }
+}
+
+/*
+ * The index file is a log of added and removed cache files, which all processes
+ * append to; we only need to read the lines that were added since our last read:
+ *
+ *   + <key> <version> <size> <mtime>
+ *   - <key> <version>
+ *
+ * From time to time, the log is replaced by an index that only contains the
+ * current files (see disk_index_rewrite_L), other processes notice this by the
+ * inode change and read the whole new index.
+ */
+void
+InstEncCache::disk_index_update_L()
+{
+  GStatBuf stbuf;
+  if (g_stat (index_filename().c_str(), &stbuf) != 0)
+    {
+      /* only scan the directory if there is no index yet (first start, or index deleted) */
+      disk_index_rewrite_L();
+      return;
+    }
+  if (uint64 (stbuf.st_ino) != disk_index_ino || uint64 (stbuf.st_size) < disk_index_pos)
+    {
+      disk_index_clear_L();
+      disk_index_ino = stbuf.st_ino;
+    }
+  if (uint64 (stbuf.st_size) == disk_index_pos)
+    return;
+
+  FILE *index_file = fopen (index_filename().c_str(), "r");
+  if (!index_file)
+    return;
+
+  fseek (index_file, disk_index_pos, SEEK_SET);
+
+  char line[1024];
+  while (fgets (line, sizeof (line), index_file))
+    {
+      const size_t len = strlen (line);
+      if (len == 0 || line[len - 1] != '\n') // incomplete line (being written), read it next time
+        break;
+
+      disk_index_pos += len;
+      disk_index_lines++;
+
+      char key[256], version[256];
+      uint64 size, mtime;
+      if (sscanf (line, "+ %255s %255s %" SCNu64 " %" SCNu64, key, version, &size, &mtime) == 4)
+        {
+          DiskEntry entry;
+          entry.version = version;
+          entry.size    = size;
+          entry.mtime   = mtime;
+
+          disk_index_remove_L (key);
+          disk_index_add_L (key, entry);
+        }
+      else if (sscanf (line, "- %255s %255s", key, version) == 2)
         {
-          status.mtime = stbuf.st_mtime;
-          status.size  = stbuf.st_size;;
-          file_status.push_back (status);
+          /* don't remove newer files with the same key */
+          auto it = disk_index.find (key);
+          if (it != disk_index.end() && it->second.version == version)
+            disk_index_remove_L (key);
         }
     }
+  fclose (index_file);
+
+  /* keep the log short */
+  if (disk_index_lines > 1000 + 2 * disk_index.size())
+    disk_index_rewrite_L();
+}
+
+void
+InstEncCache::disk_index_rewrite_L()
+{
+  /* files of other processes that are not in the index yet are found by scanning */
+  disk_index_scan_L();
+
+  /* atomically replace the old index; appends of other processes to the old index
+   * which happen during the rewrite are lost, but the files are found by the next scan
+   */
+  string new_index_filename = string_printf ("%s.new.%d", index_filename().c_str(), getpid());
+  FILE *outfile = fopen (new_index_filename.c_str(), "w");
+  if (!outfile)
+    return;
+
+  for (const auto& [key, entry] : disk_index)
+    fprintf (outfile, "+ %s %s %zd %" PRIu64 "\n", key.c_str(), entry.version.c_str(), entry.size, entry.mtime);
+
+  fclose (outfile);
+  g_rename (new_index_filename.c_str(), index_filename().c_str());
+
+  /* we already know all entries of the new index */
+  GStatBuf stbuf;
+  if (g_stat (index_filename().c_str(), &stbuf) == 0)
+    {
+      disk_index_ino = stbuf.st_ino;
+      disk_index_pos = stbuf.st_size;
+      disk_index_lines = disk_index.size();
+    }
+}
+
+void
+InstEncCache::disk_index_log_L (const string& line)
+{
+  /* one write() per line, so lines of different processes don't get mixed */
+  int fd = open (index_filename().c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+  if (fd < 0)
+    return;
+
+  if (write (fd, line.data(), line.size())) { /* ignore errors: the index is only a hint */ }
+  close (fd);
+}
+
+void
+InstEncCache::disk_index_log_add_L (const string& key, const DiskEntry& entry)
+{
+  disk_index_log_L (string_printf ("+ %s %s %zd %" PRIu64 "\n", key.c_str(), entry.version.c_str(), entry.size, entry.mtime));
+}
+
+void
+InstEncCache::disk_index_log_remove_L (const string& key, const string& version)
+{
+  disk_index_log_L (string_printf ("- %s %s\n", key.c_str(), version.c_str()));
+}
+
+void
+InstEncCache::disk_index_add_L (const string& key, const DiskEntry& entry)
+{
+  assert (disk_index.count (key) == 0);
+
+  disk_index[key] = entry;
+  disk_versions[entry.version].insert (key);
+  disk_total_size += entry.size;
+}
+
+void
+InstEncCache::disk_index_remove_L (const string& key)
+{
+  auto it = disk_index.find (key);
+  if (it == disk_index.end())
+    return;
+
+  auto vit = disk_versions.find (it->second.version);
+  if (vit != disk_versions.end())
+    {
+      vit->second.erase (key);
+      if (vit->second.empty())
+        disk_versions.erase (vit);
+    }
+
+  disk_total_size -= it->second.size;
+  disk_index.erase (it);
+}
+
+void
+InstEncCache::delete_old_files_L()
+{
+  const size_t max_total_size = 100 * 1000 * 1000; // 100 MB total cache size
+  if (disk_total_size <= max_total_size)
+    return;
+
+  /* other processes share the cache directory, so the sizes in our index may be outdated */
+  disk_index_update_L();
+  if (disk_total_size <= max_total_size)
+    return;
+
+  /* the index doesn't know when other processes used a file, but the file mtimes do */
+  disk_index_rewrite_L();
+  if (disk_total_size <= max_total_size)
+    return;
+
+  struct Status
+  {
+    string key;
+    uint64 mtime = 0;
+    size_t size = 0;
+  };
+  vector<Status> file_status;
+  for (const auto& [key, entry] : disk_index)
+    file_status.push_back ({ key, entry.mtime, entry.size });
+
   std::sort (file_status.begin(), file_status.end(),
     [](const Status& st1, const Status& st2)
       {
@@ -312,18 +574,19 @@ InstEncCache::delete_old_files()
         return st1.mtime > st2.mtime;
       });
 
-  const size_t max_total_size = 100 * 1000 * 1000; // 100 MB total cache size
+  /* shrink the cache a bit more than necessary, so we don't need to do this again for every new file */
+  const size_t keep_total_size = max_total_size * 8 / 10;
   size_t total_size = 0;
-  for (auto status : file_status)
+  for (const auto& status : file_status)
     {
-      /* using a regexp here avoids deleting unrelated files; even if something is
-       * misconfigured this should make calling unlink() relatively safe */
-      if (regex_search (status.abs_filename, cache_file_re))
+      total_size += status.size;
+      if (total_size > keep_total_size)
         {
-          total_size += status.size;
-          if (total_size > max_total_size)
-            unlink (status.abs_filename.c_str());
-          // printf ("%s %" PRIu64 " %zd %zd\n", status.abs_filename.c_str(), status.mtime, status.size, total_size);
+          const string version = disk_index[status.key].version;
+
+          unlink (cache_filename (status.key + "_" + version).c_str());
+          disk_index_log_remove_L (status.key, version);
+          disk_index_remove_L (status.key);
         }
     }
 }
@@ -346,7 +609,7 @@ InstEncCache::delete_old_memory_L()
 
       Status status;
       status.key        = key;
-      status.size       = cache_data.data.size();
+      status.size       = cache_data.mem_size;
       status.read_stamp = cache_data.read_stamp;
 
       mem_status.push_back (status);
@@ -369,7 +632,7 @@ InstEncCache::delete_old_memory_L()
            * will not affect performance much, as long as it can be reloaded
            * from the files we have stored
            */
-          cache.erase (status.key);
+          cache_erase_L (status.key);
         }
       // printf ("%s %" PRIu64 " %zd %zd\n", status.key.c_str(), status.read_stamp, status.size, total_size);
     }
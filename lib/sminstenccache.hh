@@ -9,6 +9,7 @@
 
 #include <mutex>
 #include <regex>
+#include <set>
 
 namespace SpectMorph
 {
@@ -19,23 +20,53 @@ class InstEncCache
 
   struct CacheData
   {
-    LeakDebugger               leak_debugger { "SpectMorph::InstEncCache::CacheData" };
-    std::string                version;
-    std::vector<unsigned char> data;
-    uint64                     read_stamp = 0;
+    LeakDebugger                 leak_debugger { "SpectMorph::InstEncCache::CacheData" };
+    std::string                  version;
+    std::shared_ptr<const Audio> audio;          // never modified after insertion
+    size_t                       mem_size = 0;
+    uint64                       read_stamp = 0;
   };
 
-  std::map<std::string, CacheData> cache;
-  std::mutex                       cache_mutex;
-  const std::regex                 cache_file_re;
-  uint64                           cache_read_stamp = 0;
+  /* cache files on disk, filename: <cache_key>_<version> */
+  struct DiskEntry
+  {
+    std::string version;
+    size_t      size  = 0;
+    uint64      mtime = 0;
+  };
+
+  std::map<std::string, CacheData>   cache;            // cache_key -> audio
+  std::map<std::string, std::string> cache_versions;   // version -> cache_key
+  std::mutex                         cache_mutex;
+  const std::regex                   cache_file_re;
+  uint64                             cache_read_stamp = 0;
 
-  void        cache_save_L (const std::string& key);
+  std::map<std::string, DiskEntry>             disk_index;            // cache_key -> file
+  std::map<std::string, std::set<std::string>> disk_versions;         // version -> cache_keys (same input, other groups)
+  size_t                                       disk_total_size = 0;
+  uint64                                       disk_index_ino = 0;    // inode of the index file we read
+  uint64                                       disk_index_pos = 0;    // bytes of the index file we read
+  size_t                                       disk_index_lines = 0;  // lines of the index file we read
+
+  void        cache_save_L (const std::string& key, const std::string& version, const std::vector<unsigned char>& data);
   void        cache_try_load_L (const std::string& key, const std::string& need_version);
-  Audio      *cache_lookup (const std::string& cache_key, const std::string& version);
-  void        cache_add (const std::string& cache_key, const std::string& version, const Audio *audio);
+  bool        cache_try_load_file_L (const std::string& cache_key, const std::string& disk_key, const std::string& need_version);
+  std::shared_ptr<const Audio> cache_lookup (const std::string& cache_key, const std::string& version);
+  void        cache_add (const std::string& cache_key, const std::string& version, std::shared_ptr<const Audio> audio);
+  void        cache_set_L (const std::string& cache_key, const std::string& version, std::shared_ptr<const Audio> audio);
+  void        cache_erase_L (const std::string& cache_key);
+
+  void        disk_index_clear_L();
+  void        disk_index_scan_L();
+  void        disk_index_update_L();
+  void        disk_index_rewrite_L();
+  void        disk_index_log_L (const std::string& line);
+  void        disk_index_log_add_L (const std::string& key, const DiskEntry& entry);
+  void        disk_index_log_remove_L (const std::string& key, const std::string& version);
+  void        disk_index_add_L (const std::string& key, const DiskEntry& entry);
+  void        disk_index_remove_L (const std::string& key);
 
-  void        delete_old_files();
+  void        delete_old_files_L();
   void        delete_old_memory_L();
 
 public:
@@ -45,9 +76,10 @@ public:
     std::string id;
   };
 
-  Audio      *encode (Group *group, const WavData& wav_data, const std::string& wav_data_hash,
-                      int midi_note, int iclipstart, int iclipend, Instrument::EncoderConfig& cfg,
-                      const std::function<bool()>& kill_function);
+  /* the result is shared with the cache and must not be modified, use clone() for a modifiable copy */
+  std::shared_ptr<const Audio> encode (Group *group, const WavData& wav_data, const std::string& wav_data_hash,
+                                       int midi_note, int iclipstart, int iclipend, Instrument::EncoderConfig& cfg,
+                                       const std::function<bool()>& kill_function);
   void        clear();
   Group      *create_group();
 
@@ -524,10 +524,9 @@ Instrument::save (ZipWriter& zip_writer) const
   return save ("", &zip_writer);
 }
 
-Error
-Instrument::save (const string& filename, ZipWriter *zip_writer) const
+void
+Instrument::to_xml (xml_document& doc, bool zip) const
 {
-  xml_document doc;
   xml_node inst_node = doc.append_child ("instrument");
   inst_node.append_attribute ("name").set_value (m_name.c_str());
   inst_node.append_attribute ("short_name").set_value (m_short_name.c_str());
@@ -536,7 +535,7 @@ Instrument::save (const string& filename, ZipWriter *zip_writer) const
   for (auto& sample : samples)
     {
       xml_node sample_node = inst_node.append_child ("sample");
-      if (zip_writer)
+      if (zip)
         sample_node.append_attribute ("filename").set_value ((sample->short_name + ".flac").c_str());
       else
         sample_node.append_attribute ("filename").set_value (sample->filename.c_str());
@@ -606,20 +605,35 @@ Instrument::save (const string& filename, ZipWriter *zip_writer) const
           conf_node.append_attribute ("value").set_value (entry.value.c_str());
         }
     }
+}
+
+namespace
+{
+
+class VectorOut : public xml_writer
+{
+public:
+  vector<unsigned char> vec;
+  void
+  write (const void* data, size_t size) override
+  {
+    const unsigned char *d = (const unsigned char *) data;
+
+    vec.insert (vec.end(), d, d + size);
+  }
+};
+
+}
+
+Error
+Instrument::save (const string& filename, ZipWriter *zip_writer) const
+{
+  xml_document doc;
+  to_xml (doc, zip_writer != nullptr);
+
   if (zip_writer)
     {
-      class VectorOut : public xml_writer
-      {
-      public:
-        vector<unsigned char> vec;
-        void
-        write (const void* data, size_t size) override
-        {
-          const unsigned char *d = (const unsigned char *) data;
-
-          vec.insert (vec.end(), d, d + size);
-        }
-      } out;
+      VectorOut out;
       doc.save (out);
 
       zip_writer->add ("instrument.xml", out.vec);
@@ -652,6 +666,31 @@ Instrument::save (const string& filename, ZipWriter *zip_writer) const
   return Error::Code::NONE;
 }
 
+/**
+ * Computes a hash of everything that save (ZipWriter&) writes: if two calls return the
+ * same hash, the zip data written by save() will be equivalent. This is much faster than
+ * save(), because no FLAC encoding and compression is necessary.
+ */
+string
+Instrument::zip_hash() const
+{
+  xml_document doc;
+  to_xml (doc, true);
+
+  VectorOut out;
+  doc.save (out);
+
+  string depends (out.vec.begin(), out.vec.end());
+  for (auto& sample : samples)
+    {
+      const WavData& wav_data = sample->wav_data();
+
+      depends += string_printf ("\n%s %d %.17g %d", sample->wav_data_hash().c_str(), wav_data.n_channels(),
+                                wav_data.mix_freq(), wav_data.bit_depth());
+    }
+  return sha1_hash (depends);
+}
+
 Instrument *
 Instrument::clone() const
 {
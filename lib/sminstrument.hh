@@ -12,6 +12,11 @@
 #include <map>
 #include <memory>
 
+namespace pugi
+{
+class xml_document;
+}
+
 namespace SpectMorph
 {
 
@@ -130,6 +135,7 @@ private:
 
   Error       load (const std::string& filename, ZipReader *zip_reader, LoadOptions load_options = LoadOptions::ALL);
   Error       save (const std::string& filename, ZipWriter *zip_writer) const;
+  void        to_xml (pugi::xml_document& doc, bool zip) const;
 public:
   Instrument();
 
@@ -155,6 +161,7 @@ public:
 
   Error       save (const std::string& filename) const;
   Error       save (ZipWriter& zip_writer) const;
+  std::string zip_hash() const;
 
   Instrument *clone() const;
   void        update_order();
@@ -68,10 +68,6 @@ LiveDecoder::LiveDecoder (float mix_freq) :
   init_aa_filter();
   set_unison_voices (1, 0);
   /* avoid malloc during synthesis */
-  pstate[0].reserve (PARTIAL_STATE_RESERVE);
-  pstate[1].reserve (PARTIAL_STATE_RESERVE);
-  unison_phases[0].reserve (PARTIAL_STATE_RESERVE * MAX_UNISON_VOICES);
-  unison_phases[1].reserve (PARTIAL_STATE_RESERVE * MAX_UNISON_VOICES);
   unison_freq_factor.reserve (MAX_UNISON_VOICES);
 
   pp_inter = PolyPhaseInter::the(); // do not delete
@@ -129,6 +125,8 @@ LiveDecoder::retrigger (int channel, float freq, int midi_velocity)
 
   if (best_audio)
     {
+      best_audio->request_frames (0); // lazy loading: frames that are not loaded yet will be needed soon
+
       frame_step = audio->frame_step_ms * mix_freq / 1000;
       zero_values_at_start_scaled = audio->zero_values_at_start * mix_freq / audio->mix_freq;
       loop_start_scaled = audio->loop_start * mix_freq / audio->mix_freq;
@@ -151,6 +149,7 @@ LiveDecoder::retrigger (int channel, float freq, int midi_velocity)
         }
 
       noise_index = block_size / 2; // need to generate noise immediately
+      noise_in_sines = false;
       pos = block_size / 2; // need to generate sines immediately
       frame_idx = 0;
       env_pos = 0;
@@ -160,15 +159,14 @@ LiveDecoder::retrigger (int channel, float freq, int midi_velocity)
 
       done_state = DoneState::ACTIVE;
 
-      // reset partial state vectors
-      pstate[0].clear();
-      pstate[1].clear();
+      // reset partial state and unison phases
+      for (auto& ps : pstate)
+        {
+          ps.size = 0;
+          ps.unison_size = 0;
+        }
       last_pstate = &pstate[0];
 
-      // reset unison phases
-      unison_phases[0].clear();
-      unison_phases[1].clear();
-
       // setup vibrato state
       vibrato_phase = 0;
       vibrato_env = 0;
@@ -250,6 +248,8 @@ LiveDecoder::gen_sines (float freq_in)
         frame_idx = loop_point;
     }
 
+  noise_in_sines = false;
+
   RTAudioBlock audio_block (rt_memory_area);
   bool         have_audio_block = false;
   if (source)
@@ -257,9 +257,10 @@ LiveDecoder::gen_sines (float freq_in)
       source->set_portamento_freq (freq_in);
       have_audio_block = source->rt_audio_block (frame_idx, audio_block);
     }
-  else if (frame_idx < audio->contents.size())
+  else if (frame_idx < audio->n_frames())
     {
-      audio_block.assign (audio->contents[frame_idx]);
+      audio->request_frames (frame_idx);
+      audio_block.assign_view (*audio, audio->available_frame (frame_idx));
       have_audio_block = true;
     }
   if (have_audio_block)
@@ -267,135 +268,172 @@ LiveDecoder::gen_sines (float freq_in)
       float portamento_stretch = freq_in / current_freq;
       assert (audio_block.freqs.size() == audio_block.mags.size());
 
+      /* the partial state has a fixed size (to avoid malloc during synthesis), so blocks with
+       * more partials (for instance morph output of two dense sources) are reduced to the
+       * loudest partials before synthesis
+       */
+      if (audio_block.freqs.size() > PARTIAL_STATE_RESERVE)
+        audio_block.keep_loudest_partials (PARTIAL_STATE_RESERVE);
+
       // point n_pstate to pstate[0] and pstate[1] alternately (one holds points to last state and the other points to new state)
       bool lps_zero = (last_pstate == &pstate[0]);
-      vector<PartialState>& new_pstate = lps_zero ? pstate[1] : pstate[0];
-      const vector<PartialState>& old_pstate = lps_zero ? pstate[0] : pstate[1];
-      vector<uint>& unison_new_phases = lps_zero ? unison_phases[1] : unison_phases[0];
-      const vector<uint>& unison_old_phases = lps_zero ? unison_phases[0] : unison_phases[1];
+      PartialState& new_pstate = lps_zero ? pstate[1] : pstate[0];
+      const PartialState& old_pstate = lps_zero ? pstate[0] : pstate[1];
 
       if (unison_voices != 1)
         {
           // check unison phases size corresponds to old partial state size
-          assert (unison_voices * old_pstate.size() == unison_old_phases.size());
+          assert (unison_voices * old_pstate.size == old_pstate.unison_size);
         }
-      new_pstate.clear();         // clear old partial state
-      unison_new_phases.clear();  // and old unison phase information
+      new_pstate.size = 0;         // clear old partial state
+      new_pstate.unison_size = 0;  // and old unison phase information
 
       if (sines_enabled)
         {
+          /* if the next noise block starts at exactly the same sample as the next sine block, we can
+           * render the noise spectrum together with the partials and use only one IFFT for both
+           */
+          noise_in_sines = combined_ifft_enabled && noise_enabled && !vibrato_enabled &&
+                           done_state == DoneState::ACTIVE &&
+                           noise_index == block_size / 2 && pos == block_size / 2;
+
           const float phase_factor = block_size * M_PI / mix_freq * ifft_synth.phase_to_uint_factor();
           const float filter_fact = 18000.0 / 44100.0;  // for 44.1 kHz, filter at 18 kHz (higher mix freq => higher filter)
-          const float filter_min_freq = filter_fact * mix_freq;
 
-          size_t old_partial = 0;
-          for (size_t partial = 0; partial < audio_block.freqs.size(); partial++)
-            {
-              const float freq = audio_block.freqs_f (partial) * current_freq;
+          const float *old_freq  = &old_pstate.freq[0];
+          const uint  *old_phase = &old_pstate.phase[0];
+          float       *new_freq  = &new_pstate.freq[0];
+          float       *new_mag   = &new_pstate.mag[0];
+          uint        *new_phase = &new_pstate.phase[0];
+          int         *match     = &partial_match[0];
 
-              // anti alias filter:
-              float mag        = audio_block.mags_f (partial);
-
-              const float portamento_freq = audio_block.freqs_f (partial) * freq_in;
-              if (portamento_freq > filter_min_freq)
+          /* pass 1: frequencies and (anti alias filtered) magnitudes of the new partials */
+          size_t n_partials = 0;
+          for (size_t p = 0; p < audio_block.freqs.size(); p++)
+            {
+              const float norm_freq = audio_block.freqs_f (p) * freq_in / mix_freq;
+              if (norm_freq > 0.5)
                 {
-                  float norm_freq = portamento_freq / mix_freq;
-                  if (norm_freq > 0.5)
-                    {
-                      // above nyquist freq -> since partials are sorted, there is nothing more to do for this frame
-                      break;
-                    }
-                  else
-                    {
-                      // between filter_fact and 0.5 (db linear filter)
-                      int index = sm_round_positive (ANTIALIAS_FILTER_TABLE_SIZE * (norm_freq - filter_fact) / (0.5f - filter_fact));
-                      if (index >= 0)
-                        {
-                          if (index < ANTIALIAS_FILTER_TABLE_SIZE)
-                            mag *= antialias_filter_table[index];
-                          else
-                            mag = 0;
-                        }
-                      else
-                        {
-                          // filter magnitude is supposed to be 1.0
-                        }
-                    }
+                  // above nyquist freq -> since partials are sorted, there is nothing more to do for this frame
+                  break;
                 }
-
-              /*
-               * increment old_partial as long as there is a better candidate (closer to freq)
-               */
-              bool freq_match = false;
-              if (!old_pstate.empty())
+              float mag = audio_block.mags_f (p);
+              if (norm_freq > filter_fact)
                 {
-                  float best_fdiff = std::abs (old_pstate[old_partial].freq - freq);
+                  // anti alias filter: between filter_fact and 0.5 (db linear filter)
+                  const int index = sm_round_positive (ANTIALIAS_FILTER_TABLE_SIZE * (norm_freq - filter_fact) / (0.5f - filter_fact));
+                  mag *= index < ANTIALIAS_FILTER_TABLE_SIZE ? antialias_filter_table[index] : 0;
+                }
+              new_freq[p] = audio_block.freqs_f (p) * current_freq;
+              new_mag[p] = mag;
+              n_partials++;
+            }
+          new_pstate.size = n_partials;
+
+          /* pass 2: match new partials to old partials
+           *
+           * both lists are sorted by frequency, so this is a merge: the best candidate in the
+           * old list (closest to freq) never moves backwards; the result is the index of the
+           * matching old partial, or -1 if there is no old partial with (almost) the same freq
+           */
+          const size_t old_size = old_pstate.size;
+          size_t old_partial = 0;
+          for (size_t p = 0; p < n_partials; p++)
+            {
+              const float freq = new_freq[p];
 
-                  while ((old_partial + 1) < old_pstate.size())
+              match[p] = -1;
+              if (old_size)
+                {
+                  float best_fdiff = std::abs (old_freq[old_partial] - freq);
+                  while (old_partial + 1 < old_size)
                     {
-                      float fdiff = std::abs (old_pstate[old_partial + 1].freq - freq);
-                      if (fdiff < best_fdiff)
-                        {
-                          old_partial++;
-                          best_fdiff = fdiff;
-                        }
-                      else
-                        {
-                          break;
-                        }
+                      const float fdiff = std::abs (old_freq[old_partial + 1] - freq);
+                      if (fdiff >= best_fdiff)
+                        break;
+
+                      old_partial++;
+                      best_fdiff = fdiff;
                     }
-                  const float lfreq = old_pstate[old_partial].freq;
-                  freq_match = fmatch (lfreq, freq);
+                  if (fmatch (old_freq[old_partial], freq))
+                    match[p] = old_partial;
                 }
-              if (DEBUG)
-                printf ("%d:F %.17g %.17g\n", int (env_pos), freq, mag);
+            }
 
-              uint phase = 0;
-              if (unison_voices == 1)
+          /* pass 3: phases of the new partials (continue phase of matching old partial or use start phase)
+           *
+           * the phase advance is computed for all old partials first: these loops have no branches
+           * and no indirect accesses, so the compiler can vectorize them
+           */
+          uint *inc = &phase_inc[0];
+          if (unison_voices == 1)
+            {
+              for (size_t o = 0; o < old_size; o++)
+                inc[o] = int64_t (ifft_synth.quantized_freq (old_freq[o] * old_portamento_stretch) * phase_factor);
+
+              for (size_t p = 0; p < n_partials; p++)
                 {
-                  if (freq_match)
+                  if (DEBUG)
+                    printf ("%d:F %.17g %.17g\n", int (env_pos), new_freq[p], new_mag[p]);
+
+                  const int m = match[p];
+                  if (m >= 0)
                     {
                       // matching freq -> compute new phase
-                      const float lfreq = old_pstate[old_partial].freq;
-                      const uint lphase = old_pstate[old_partial].phase;
-
-                      phase = lphase + int64_t (ifft_synth.quantized_freq (lfreq * old_portamento_stretch) * phase_factor);
+                      new_phase[p] = old_phase[m] + inc[m];
 
                       if (DEBUG)
-                        printf ("%d:L %.17g %.17g %.17g\n", int (env_pos), lfreq, freq, mag);
+                        printf ("%d:L %.17g %.17g %.17g\n", int (env_pos), old_freq[m], new_freq[p], new_mag[p]);
                     }
                   else
                     {
-                      if (start_phase_rand_enabled)
-                        phase = phase_random_gen.random_uint32(); // randomize start phase
+                      // randomize start phase
+                      new_phase[p] = start_phase_rand_enabled ? phase_random_gen.random_uint32() : 0;
                     }
                 }
-              else
+            }
+          else
+            {
+              for (size_t p = 0; p < n_partials; p++)
                 {
-                  mag *= unison_gain;
+                  if (DEBUG)
+                    printf ("%d:F %.17g %.17g\n", int (env_pos), new_freq[p], new_mag[p]);
 
-                  for (int i = 0; i < unison_voices; i++)
+                  new_mag[p] *= unison_gain;
+                }
+
+              /* inc[i * old_size + o]: phase advance of unison voice i of old partial o */
+              for (int i = 0; i < unison_voices; i++)
+                {
+                  const float freq_factor = unison_freq_factor[i];
+                  uint       *voice_inc   = inc + i * old_size;
+
+                  for (size_t o = 0; o < old_size; o++)
+                    voice_inc[o] = int64_t (ifft_synth.quantized_freq (old_freq[o] * old_portamento_stretch * freq_factor) * phase_factor);
+                }
+
+              const uint *unison_old_phase = &old_pstate.unison_phase[0];
+              uint       *unison_new_phase = &new_pstate.unison_phase[0];
+              for (size_t p = 0; p < n_partials; p++)
+                {
+                  const int m = match[p];
+                  if (m >= 0)
+                    {
+                      const uint *lphase = unison_old_phase + m * unison_voices;
+
+                      for (int i = 0; i < unison_voices; i++)
+                        unison_new_phase[i] = lphase[i] + inc[i * old_size + m];
+                    }
+                  else
                     {
-                      if (freq_match)
-                        {
-                          const float lfreq = old_pstate[old_partial].freq;
-                          const uint lphase = unison_old_phases[old_partial * unison_voices + i];
-
-                          phase = lphase + int64_t (ifft_synth.quantized_freq (lfreq * old_portamento_stretch * unison_freq_factor[i]) * phase_factor);
-                        }
-                      else
-                        {
-                          phase = phase_random_gen.random_uint32(); // always randomize start phase for unison
-                        }
-                      unison_new_phases.push_back (phase);
+                      for (int i = 0; i < unison_voices; i++)
+                        unison_new_phase[i] = phase_random_gen.random_uint32(); // always randomize start phase for unison
                     }
+                  /* phase of the last unison voice, used if unison is switched off */
+                  new_phase[p] = unison_new_phase[unison_voices - 1];
+                  unison_new_phase += unison_voices;
                 }
-
-              PartialState ps;
-              ps.freq = freq;
-              ps.mag = mag;
-              ps.phase = phase;
-              new_pstate.push_back (ps);
+              new_pstate.unison_size = n_partials * unison_voices;
             }
 
           /* check if there is a relevant difference between old portamento stretch and new portamento stretch
@@ -421,15 +459,15 @@ LiveDecoder::gen_sines (float freq_in)
                 };
               if (unison_voices == 1)
                 {
-                  for (auto ps : old_pstate)
-                    render_old_partial (ps.freq, ps.mag, ps.phase);
+                  for (size_t p = 0; p < old_pstate.size; p++)
+                    render_old_partial (old_pstate.freq[p], old_pstate.mag[p], old_pstate.phase[p]);
                 }
               else
                 {
-                  for (size_t p = 0; p < old_pstate.size(); p++)
+                  for (size_t p = 0; p < old_pstate.size; p++)
                     {
                       for (int i = 0; i < unison_voices; i++)
-                        render_old_partial (old_pstate[p].freq * unison_freq_factor[i], old_pstate[p].mag, unison_old_phases[p * unison_voices + i]);
+                        render_old_partial (old_pstate.freq[p] * unison_freq_factor[i], old_pstate.mag[p], old_pstate.unison_phase[p * unison_voices + i]);
                     }
                 }
               ifft_synth.get_samples (&sine_samples[0], IFFTSynth::REPLACE);
@@ -446,21 +484,29 @@ LiveDecoder::gen_sines (float freq_in)
 
           if (unison_voices == 1)
             {
-              for (auto ps : new_pstate)
-                ifft_synth.render_partial (ps.freq * portamento_stretch, ps.mag, ps.phase);
+              for (size_t p = 0; p < new_pstate.size; p++)
+                ifft_synth.render_partial (new_freq[p] * portamento_stretch, new_mag[p], new_phase[p]);
             }
           else
             {
-              for (size_t p = 0; p < new_pstate.size(); p++)
+              for (size_t p = 0; p < new_pstate.size; p++)
                 {
                   for (int i = 0; i < unison_voices; i++)
                     {
-                      ifft_synth.render_partial (new_pstate[p].freq * unison_freq_factor[i] * portamento_stretch,
-                                                 new_pstate[p].mag,
-                                                 unison_new_phases[p * unison_voices + i]);
+                      ifft_synth.render_partial (new_freq[p] * unison_freq_factor[i] * portamento_stretch,
+                                                 new_mag[p],
+                                                 new_pstate.unison_phase[p * unison_voices + i]);
                     }
                 }
             }
+          if (noise_in_sines)
+            {
+              /* the noise spectrum is convolved with the BH92 window like the partials; the window
+               * correction of the IFFTSynth (win_scale) converts both to hann windowed output
+               */
+              assert (audio_block.noise.size() == noise_envelope.size());
+              noise_decoder.process (audio_block.noise.data(), ifft_synth.fft_input(), NoiseDecoder::ADD_SPECTRUM_BH92);
+            }
 
           ifft_synth.get_samples (&sine_samples[block_size / 2], IFFTSynth::ADD);
         }
@@ -497,7 +543,14 @@ LiveDecoder::gen_sines (float freq_in)
 void
 LiveDecoder::gen_noise()
 {
-  if (noise_enabled && done_state == DoneState::ACTIVE)
+  if (noise_in_sines)
+    {
+      /* noise for this block is already part of the sine samples, only overlap-add the old noise block */
+      std::copy (&noise_samples[block_size / 2], &noise_samples[block_size], &noise_samples[0]);
+      zero_float_block (block_size / 2, &noise_samples[block_size / 2]);
+      noise_in_sines = false;
+    }
+  else if (noise_enabled && done_state == DoneState::ACTIVE)
     {
       /* generate hann-windowed noise using IFFT */
       noise_decoder.process (noise_envelope.data(), ifft_synth.fft_input(), NoiseDecoder::SET_SPECTRUM_HANN, 1);
@@ -862,6 +915,12 @@ LiveDecoder::enable_sines (bool es)
   sines_enabled = es;
 }
 
+void
+LiveDecoder::enable_combined_ifft (bool eci)
+{
+  combined_ifft_enabled = eci;
+}
+
 void
 LiveDecoder::enable_start_phase_rand (bool sr)
 {
@@ -931,7 +990,7 @@ LiveDecoder::get_loop_type()
 void
 LiveDecoder::set_unison_voices (int voices, float detune)
 {
-  assert (voices > 0);
+  assert (voices > 0 && voices <= int (MAX_UNISON_VOICES));
 
   unison_voices = voices;
 
@@ -956,19 +1015,17 @@ LiveDecoder::set_unison_voices (int voices, float detune)
   unison_gain = 1 / sqrt (voices);
 
   /* resize unison phase array to match pstate */
-  const bool lps_zero = (last_pstate == &pstate[0]);
-  const vector<PartialState>& old_pstate = lps_zero ? pstate[0] : pstate[1];
-  vector<uint>& unison_old_phases = lps_zero ? unison_phases[0] : unison_phases[1];
+  PartialState& old_pstate = *last_pstate;
 
-  if (unison_old_phases.size() != old_pstate.size() * unison_voices)
+  if (old_pstate.unison_size != old_pstate.size * unison_voices)
     {
-      unison_old_phases.resize (old_pstate.size() * unison_voices);
+      old_pstate.unison_size = old_pstate.size * unison_voices;
 
-      for (uint& phase : unison_old_phases)
+      for (size_t i = 0; i < old_pstate.unison_size; i++)
         {
           /* since the position of the partials changed, randomization is really
            * the best we can do here */
-          phase = phase_random_gen.random_uint32();
+          old_pstate.unison_phase[i] = phase_random_gen.random_uint32();
         }
     }
 }
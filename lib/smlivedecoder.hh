@@ -18,19 +18,25 @@ namespace SpectMorph {
 class LiveDecoderFilter;
 class LiveDecoder
 {
-  static constexpr size_t PARTIAL_STATE_RESERVE = 2048; // maximum number of partials to expect
+  static constexpr size_t PARTIAL_STATE_RESERVE = 2048; // maximum number of partials (louder partials are kept)
   static constexpr size_t MAX_N_VALUES = 64;            // maximum number of values to process at once
   static constexpr size_t MAX_UNISON_VOICES = 7;        // maximum number of unison voices
 
   LeakDebugger leak_debugger { "SpectMorph::LiveDecoder" };
 
+  /* partial state, stored as structure of arrays (allocated once to avoid malloc during synthesis) */
   struct PartialState
   {
-    float freq;
-    float mag;
-    uint  phase;
+    AlignedArray<float,16> freq { PARTIAL_STATE_RESERVE };
+    AlignedArray<float,16> mag { PARTIAL_STATE_RESERVE };
+    AlignedArray<uint,16>  phase { PARTIAL_STATE_RESERVE };
+    AlignedArray<uint,16>  unison_phase { PARTIAL_STATE_RESERVE * MAX_UNISON_VOICES };
+    size_t                 size = 0;
+    size_t                 unison_size = 0;
   };
-  std::vector<PartialState> pstate[2], *last_pstate;
+  PartialState        pstate[2], *last_pstate = &pstate[0];
+  AlignedArray<int,16> partial_match { PARTIAL_STATE_RESERVE }; // index of matching old partial (or -1)
+  AlignedArray<uint,16> phase_inc { PARTIAL_STATE_RESERVE * MAX_UNISON_VOICES }; // phase advance of old partials
 
   WavSet             *smset;
   Audio              *audio;
@@ -51,6 +57,7 @@ class LiveDecoder
   bool                original_samples_enabled;
   bool                loop_enabled;
   bool                start_skip_enabled;
+  bool                combined_ifft_enabled = true;
 
   double              frame_step;
   size_t              zero_values_at_start_scaled;
@@ -75,10 +82,10 @@ class LiveDecoder
   AlignedArray<float,16> noise_samples;
 
   std::array<uint16_t, Audio::N_NOISE_BANDS> noise_envelope;
+  bool                noise_in_sines = false; // noise for the current block was rendered by gen_sines
 
   // unison
   int                 unison_voices;
-  std::vector<uint>   unison_phases[2];
   std::vector<float>  unison_freq_factor;
   float               unison_gain;
 
@@ -133,6 +140,7 @@ public:
   void enable_original_samples (bool eos);
   void enable_loop (bool eloop);
   void enable_start_skip (bool ess);
+  void enable_combined_ifft (bool eci);
   void set_random_seed (int seed);
   void set_unison_voices (int voices, float detune);
   void set_vibrato (bool enable_vibrato, float depth, float frequency, float attack);
@@ -7,6 +7,8 @@
 #include "smconfig.hh"
 #include "sminstenccache.hh"
 #include "smwavsetrepo.hh"
+#include "smwavsetstore.hh"
+#include "smaudiostream.hh"
 #include "config.h"
 #include <stdio.h>
 #include <assert.h>
@@ -28,7 +30,9 @@ struct GlobalData
 
   LeakDebuggerList  leak_debugger_list; /* needs to be the first member to track leaks for the other members */
   InstEncCache      inst_enc_cache;
+  WavSetStore       wav_set_store;
   WavSetRepo        wav_set_repo;
+  AudioStreamer     audio_streamer;
 
   std::thread::id   ui_thread;
   std::thread::id   dsp_thread;
@@ -163,6 +167,13 @@ Global::inst_enc_cache()
   return &global_data->inst_enc_cache;
 }
 
+WavSetStore *
+Global::wav_set_store()
+{
+  g_return_val_if_fail (global_data, nullptr);
+  return &global_data->wav_set_store;
+}
+
 WavSetRepo *
 Global::wav_set_repo()
 {
@@ -170,6 +181,13 @@ Global::wav_set_repo()
   return &global_data->wav_set_repo;
 }
 
+AudioStreamer *
+Global::audio_streamer()
+{
+  g_return_val_if_fail (global_data, nullptr);
+  return &global_data->audio_streamer;
+}
+
 void
 sm_set_ui_thread()
 {
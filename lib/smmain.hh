@@ -21,11 +21,15 @@ void sm_global_free_func (std::function<void()> func);
 
 class InstEncCache;
 class WavSetRepo;
+class WavSetStore;
+class AudioStreamer;
 
 namespace Global
 {
   InstEncCache      *inst_enc_cache();
+  WavSetStore       *wav_set_store();
   WavSetRepo        *wav_set_repo();
+  AudioStreamer     *audio_streamer();
 }
 
 class Main
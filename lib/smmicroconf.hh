@@ -61,6 +61,10 @@ public:
   std::string line();
   void die_if_unknown();
 
+  bool command (const std::string& cmd)
+  {
+    return !tokenizer_error && tokens.size() == 1 && cmd == tokens[0];
+  }
   template<class T1>
   bool command (const std::string& cmd, T1& arg1)
   {
@@ -3,6 +3,7 @@
 #include "smmidisynth.hh"
 #include "smmorphoutputmodule.hh"
 #include "smdebug.hh"
+#include "smblockutils.hh"
 
 #include <mutex>
 #include <cinttypes>
@@ -105,6 +106,12 @@ MidiSynth::active_voice_count() const
   return active_voices.size();
 }
 
+MorphOperatorModule::ModulationCacheStats
+MidiSynth::modulation_cache_stats() const
+{
+  return morph_plan_synth.modulation_cache_stats();
+}
+
 float
 MidiSynth::freq_from_note (float note)
 {
@@ -503,15 +510,84 @@ MidiSynth::add_midi_event (size_t offset, const unsigned char *midi_data)
     }
 }
 
+bool
+MidiSynth::render_voice (Voice *voice, RTMemoryArea& rt_memory_area, float *output, float *samples, size_t n_values)
+{
+  float *values[1] = { samples };
+
+  for (int c = 0; c < MorphPlan::N_CONTROL_INPUTS; c++)
+    voice->mp_voice->set_control_input (c, voice_control (voice, c));
+
+  const float gain = voice->gain * m_gain;
+  const float *freq_in = nullptr;
+  float frequencies[n_values];
+  if (fabs (voice->pitch_bend_freq - voice->freq) > 1e-3 || voice->pitch_bend_steps > 0)
+    {
+      for (unsigned int i = 0; i < n_values; i++)
+        {
+          frequencies[i] = voice->pitch_bend_freq;
+          if (voice->pitch_bend_steps > 0)
+            {
+              voice->pitch_bend_freq *= voice->pitch_bend_factor;
+              voice->pitch_bend_steps--;
+            }
+        }
+      freq_in = frequencies;
+      voice->mp_voice->set_current_freq (frequencies[0]);
+    }
+  else
+    {
+      voice->mp_voice->set_current_freq (voice->freq);
+    }
+  if (voice->mono_type == Voice::MonoType::SHADOW)
+    {
+      /* skip: shadow voices are not rendered */
+    }
+  else if (voice->state == Voice::STATE_ON || voice->state == Voice::STATE_RELEASE)
+    {
+      MorphOutputModule *output_module = voice->mp_voice->output();
+
+      /* need to check done because in some cases voices jump to done state
+       * (i.e. full updates, adsr envelope toggled...) and we don't want
+       * to process these
+       */
+      if (!output_module->done())
+        {
+          output_module->process (m_time_info_gen, rt_memory_area, n_values, values, 1, freq_in);
+          for (size_t i = 0; i < n_values; i++)
+            output[i] += samples[i] * gain;
+        }
+
+      if (output_module->done())
+        {
+          /* envelope reached zero -> voice can be reused later */
+          voice->state = Voice::STATE_IDLE;
+          voice->pedal = false;
+
+          return true; // need to recompute active_voices and idle_voices vectors
+        }
+    }
+  else
+    {
+      g_assert_not_reached();
+    }
+  return false;
+}
+
 void
 MidiSynth::process_audio (float *output, size_t n_values)
 {
   if (!n_values)    /* this can happen if multiple midi events occur at the same time */
     return;
 
+  if (m_render_pool && active_voices.size() > 1)
+    {
+      process_audio_parallel (output, n_values);
+      return;
+    }
+
   bool  need_free = false;
   float samples[n_values];
-  float *values[1] = { samples };
 
   zero_float_block (n_values, output);
 
@@ -521,62 +597,67 @@ MidiSynth::process_audio (float *output, size_t n_values)
 
   for (Voice *voice : active_voices)
     {
-      for (int c = 0; c < MorphPlan::N_CONTROL_INPUTS; c++)
-        voice->mp_voice->set_control_input (c, voice_control (voice, c));
+      if (render_voice (voice, m_rt_memory_area, output, samples, n_values))
+        need_free = true;
+    }
+  if (need_free)
+    free_unused_voices();
 
-      const float gain = voice->gain * m_gain;
-      const float *freq_in = nullptr;
-      float frequencies[n_values];
-      if (fabs (voice->pitch_bend_freq - voice->freq) > 1e-3 || voice->pitch_bend_steps > 0)
-        {
-          for (unsigned int i = 0; i < n_values; i++)
-            {
-              frequencies[i] = voice->pitch_bend_freq;
-              if (voice->pitch_bend_steps > 0)
-                {
-                  voice->pitch_bend_freq *= voice->pitch_bend_factor;
-                  voice->pitch_bend_steps--;
-                }
-            }
-          freq_in = frequencies;
-          voice->mp_voice->set_current_freq (frequencies[0]);
-        }
-      else
-        {
-          voice->mp_voice->set_current_freq (voice->freq);
-        }
-      if (voice->mono_type == Voice::MonoType::SHADOW)
-        {
-          /* skip: shadow voices are not rendered */
-        }
-      else if (voice->state == Voice::STATE_ON || voice->state == Voice::STATE_RELEASE)
-        {
-          MorphOutputModule *output_module = voice->mp_voice->output();
+  audio_time_stamp += n_values;
+  m_time_info_gen.update_time_stamp (audio_time_stamp);
+}
 
-          /* need to check done because in some cases voices jump to done state
-           * (i.e. full updates, adsr envelope toggled...) and we don't want
-           * to process these
-           */
-          if (!output_module->done())
-            {
-              output_module->process (m_time_info_gen, m_rt_memory_area, n_values, values, 1, freq_in);
-              for (size_t i = 0; i < n_values; i++)
-                output[i] += samples[i] * gain;
-            }
+void
+MidiSynth::render_worker_item (int worker, size_t item)
+{
+  RenderWorker& rw = *m_render_workers[worker];
+  if (!rw.have_output)
+    {
+      zero_float_block (m_render_n_values, rw.output.data());
+      rw.have_output = true;
+    }
+  m_render_voice_done[item] = render_voice (m_render_voices[item], rw.rt_memory_area, rw.output.data(), rw.samples.data(), m_render_n_values);
+}
 
-          if (output_module->done())
-            {
-              /* envelope reached zero -> voice can be reused later */
-              voice->state = Voice::STATE_IDLE;
-              voice->pedal = false;
+void
+MidiSynth::process_audio_parallel (float *output, size_t n_values)
+{
+  /* worker buffers have a fixed size (to avoid malloc), so split large blocks */
+  while (n_values > RENDER_BLOCK_SIZE)
+    {
+      process_audio (output, RENDER_BLOCK_SIZE);
 
-              need_free = true; // need to recompute active_voices and idle_voices vectors
-            }
-        }
-      else
-        {
-          g_assert_not_reached();
-        }
+      output += RENDER_BLOCK_SIZE;
+      n_values -= RENDER_BLOCK_SIZE;
+    }
+
+  zero_float_block (n_values, output);
+
+  // prevent crash without output: just return zeros and don't do anything else
+  if (!morph_plan_synth.have_output())
+    return;
+
+  /* each voice is rendered by exactly one worker, which adds the voice output
+   * to its own output buffer; afterwards we sum up the worker output buffers
+   */
+  m_render_voices.assign (active_voices.begin(), active_voices.end());
+  m_render_n_values = n_values;
+  for (auto& rw : m_render_workers)
+    rw->have_output = false;
+
+  m_render_pool->run (m_render_voices.size());
+
+  for (auto& rw : m_render_workers)
+    {
+      if (rw->have_output)
+        Block::add (n_values, output, rw->output.data());
+    }
+
+  bool need_free = false;
+  for (size_t i = 0; i < m_render_voices.size(); i++)
+    {
+      if (m_render_voice_done[i])
+        need_free = true;
     }
   if (need_free)
     free_unused_voices();
@@ -764,7 +845,8 @@ MidiSynth::kill_all_active_voices()
 MorphPlanSynth::UpdateP
 MidiSynth::prepare_update (const MorphPlan& plan)
 {
-  return morph_plan_synth.prepare_update (plan);
+  /* with control by cc, each midi channel (MPE: each voice) has its own control values */
+  return morph_plan_synth.prepare_update (plan, m_control_by_cc);
 }
 
 void
@@ -809,6 +891,35 @@ MidiSynth::set_control_by_cc (bool control_by_cc)
   m_control_by_cc = control_by_cc;
 }
 
+void
+MidiSynth::set_render_threads (int n_threads)
+{
+  /* not rt safe: needs to be called when synthesis thread is not running */
+  if (n_threads > 1)
+    {
+      m_render_pool.reset (new RTWorkerPool (n_threads, [this] (int worker, size_t item) { render_worker_item (worker, item); }));
+
+      m_render_workers.clear();
+      for (int t = 0; t < n_threads; t++)
+        m_render_workers.emplace_back (new RenderWorker());
+
+      m_render_voices.reserve (voices.size());
+      m_render_voice_done.resize (voices.size());
+    }
+  else
+    {
+      m_render_pool.reset();
+      m_render_workers.clear();
+    }
+  morph_plan_synth.set_parallel_voices (m_render_pool != nullptr);
+}
+
+int
+MidiSynth::render_threads() const
+{
+  return m_render_pool ? m_render_pool->n_threads() : 1;
+}
+
 void
 MidiSynth::set_random_seed (int seed)
 {
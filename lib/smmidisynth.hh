@@ -7,6 +7,7 @@
 #include "smnotifybuffer.hh"
 #include "sminsteditsynth.hh"
 #include "smrtmemory.hh"
+#include "smrtworkerpool.hh"
 
 #include <array>
 
@@ -170,6 +171,21 @@ private:
 
   std::vector<float>    control = std::vector<float> (MorphPlan::N_CONTROL_INPUTS);
 
+  /* parallel voice rendering (optional) */
+  static constexpr size_t RENDER_BLOCK_SIZE = 4096;
+  struct RenderWorker
+  {
+    RTMemoryArea       rt_memory_area;
+    std::vector<float> output = std::vector<float> (RENDER_BLOCK_SIZE);
+    std::vector<float> samples = std::vector<float> (RENDER_BLOCK_SIZE);
+    bool               have_output = false;
+  };
+  std::unique_ptr<RTWorkerPool>              m_render_pool;
+  std::vector<std::unique_ptr<RenderWorker>> m_render_workers;
+  std::vector<Voice *>                       m_render_voices;
+  std::vector<char>                          m_render_voice_done;
+  size_t                                     m_render_n_values = 0;
+
   Voice  *alloc_voice();
   void    free_unused_voices();
   bool    update_mono_voice();
@@ -179,6 +195,9 @@ private:
 
   void set_mono_enabled (bool new_value);
   void process_audio (float *output, size_t n_values);
+  void process_audio_parallel (float *output, size_t n_values);
+  bool render_voice (Voice *voice, RTMemoryArea& rt_memory_area, float *output, float *samples, size_t n_values);
+  void render_worker_item (int worker, size_t item);
   void process_note_on (const NoteEvent& note);
   void process_note_off (int channel, int midi_note);
   void process_midi_controller (int channel, int controller, int value);
@@ -208,11 +227,14 @@ public:
   double mix_freq() const;
 
   size_t active_voice_count() const;
+  MorphOperatorModule::ModulationCacheStats modulation_cache_stats() const;
 
   void set_inst_edit (bool inst_edit);
   void set_gain (double gain);
   void set_random_seed (int seed);
   void set_control_by_cc (bool control_by_cc);
+  void set_render_threads (int n_threads);
+  int  render_threads() const;
   InstEditSynth *inst_edit_synth();
   NotifyBuffer *notify_buffer();
 };
@@ -42,6 +42,12 @@ MMapIn::open_vector (const vector<unsigned char>& vec)
   return GenericInP (new MMapIn (vec.data(), vec.data() + vec.size(), nullptr));
 }
 
+GenericInP
+MMapIn::open_mem (const unsigned char *begin, const unsigned char *end)
+{
+  return GenericInP (new MMapIn (begin, end, nullptr));
+}
+
 MMapIn::MMapIn (const unsigned char *mapfile, const unsigned char *mapend, GMappedFile *gmf) :
   mapfile (mapfile),
   mapend (mapend),
@@ -108,5 +114,9 @@ MMapIn::get_pos()
 GenericInP
 MMapIn::open_subfile (size_t pos, size_t len)
 {
-  return GenericInP (new MMapIn (mapfile + pos, mapfile + pos + len, nullptr /* no mapped file */));
+  /* the subfile keeps the mapping alive, so it can still be used if this object is deleted */
+  if (g_mapped_file)
+    g_mapped_file_ref (g_mapped_file);
+
+  return GenericInP (new MMapIn (mapfile + pos, mapfile + pos + len, g_mapped_file));
 }
@@ -27,6 +27,7 @@ public:
 
   static GenericInP open (const std::string& filename);
   static GenericInP open_vector (const std::vector<unsigned char>& vec);
+  static GenericInP open_mem (const unsigned char *begin, const unsigned char *end);
 
   int get_byte() override;     // like fgetc
   int read (void *ptr, size_t size) override;
@@ -332,7 +332,7 @@ MorphGrid::input_node_label (int x, int y)
       string smset_dir = m_morph_plan->index()->smset_dir();
       string path = smset_dir + "/" + node.smset;
 
-      WavSet *wav_set = WavSetRepo::the()->get (path);
+      std::shared_ptr<WavSet> wav_set = WavSetRepo::the()->get (path);
       if (wav_set)
         return wav_set->short_name;
     }
@@ -16,7 +16,7 @@ struct MorphGridNode
 {
   MorphOperatorPtr  op;                     // a node has either an operator (op) as input,
   std::string       smset;                  // or an instrument (smset)
-  WavSet           *wav_set = nullptr;
+  std::shared_ptr<WavSet> wav_set;        // pinned while the config is in use
   double            delta_db;
 
   MorphGridNode();
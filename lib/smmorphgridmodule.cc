@@ -46,7 +46,7 @@ MorphGridModule::set_config (const MorphOperatorConfig *op_cfg)
 
           if (node.wav_set)
             {
-              input_nodes (x, y).source.set_wav_set (node.wav_set);
+              input_nodes (x, y).source.set_wav_set (node.wav_set.get());
               input_nodes (x, y).has_source = true;
             }
           else
@@ -185,108 +185,123 @@ MorphGridModule::MySource::rt_audio_block (size_t index, RTAudioBlock& out_block
   const LocalMorphParams x_morph_params = global_to_local_params (x_morphing, module->cfg->width);
   const LocalMorphParams y_morph_params = global_to_local_params (y_morphing, module->cfg->height);
 
+  RTAudioBlock audio_block_a (module->rt_memory_area());
+  RTAudioBlock audio_block_b (module->rt_memory_area());
+  RTAudioBlock audio_block_c (module->rt_memory_area());
+  RTAudioBlock audio_block_d (module->rt_memory_area());
+
+  bool have_a = false, have_b = false, have_c = false, have_d = false;
+
+  InputNode *node_a, *node_b, *node_c = nullptr, *node_d = nullptr;
   if (module->cfg->height == 1)
     {
-      RTAudioBlock audio_block_a (module->rt_memory_area());
-      RTAudioBlock audio_block_b (module->rt_memory_area());
-
       /*
        *  A ---- B
        */
-
-      InputNode& node_a = module->input_nodes (x_morph_params.start, 0);
-      InputNode& node_b = module->input_nodes (x_morph_params.end,   0);
-
-      bool have_a = get_normalized_block (node_a, index, audio_block_a);
-      bool have_b = get_normalized_block (node_b, index, audio_block_b);
-
-      bool have_ab = MorphUtils::morph (out_block, have_a, audio_block_a, have_b, audio_block_b, x_morph_params.morphing, morph_mode);
-      if (have_ab)
-        {
-          double delta_db = morph_delta_db (node_a.delta_db, node_b.delta_db, x_morph_params.morphing);
-
-          apply_delta_db (out_block, delta_db);
-          return true;
-        }
-      else
-        {
-          return false;
-        }
+      node_a = &module->input_nodes (x_morph_params.start, 0);
+      node_b = &module->input_nodes (x_morph_params.end,   0);
     }
   else if (module->cfg->width == 1)
     {
-      RTAudioBlock audio_block_a (module->rt_memory_area());
-      RTAudioBlock audio_block_b (module->rt_memory_area());
-
       /*
        *  A
        *  |
        *  |
        *  B
        */
-
-      InputNode& node_a = module->input_nodes (0, y_morph_params.start);
-      InputNode& node_b = module->input_nodes (0, y_morph_params.end);
-
-      bool have_a = get_normalized_block (node_a, index, audio_block_a);
-      bool have_b = get_normalized_block (node_b, index, audio_block_b);
-
-      bool have_ab = MorphUtils::morph (out_block, have_a, audio_block_a, have_b, audio_block_b, y_morph_params.morphing, morph_mode);
-      if (have_ab)
-        {
-          double delta_db = morph_delta_db (node_a.delta_db, node_b.delta_db, y_morph_params.morphing);
-
-          apply_delta_db (out_block, delta_db);
-          return true;
-        }
-      else
-        {
-          return false;
-        }
+      node_a = &module->input_nodes (0, y_morph_params.start);
+      node_b = &module->input_nodes (0, y_morph_params.end);
     }
   else
     {
-      RTAudioBlock audio_block_a (module->rt_memory_area());
-      RTAudioBlock audio_block_b (module->rt_memory_area());
-      RTAudioBlock audio_block_c (module->rt_memory_area());
-      RTAudioBlock audio_block_d (module->rt_memory_area());
-      RTAudioBlock audio_block_ab (module->rt_memory_area());
-      RTAudioBlock audio_block_cd (module->rt_memory_area());
-
       /*
        *  A ---- B
        *  |      |
        *  |      |
        *  C ---- D
        */
-      InputNode& node_a = module->input_nodes (x_morph_params.start, y_morph_params.start);
-      InputNode& node_b = module->input_nodes (x_morph_params.end,   y_morph_params.start);
-      InputNode& node_c = module->input_nodes (x_morph_params.start, y_morph_params.end);
-      InputNode& node_d = module->input_nodes (x_morph_params.end,   y_morph_params.end);
+      node_a = &module->input_nodes (x_morph_params.start, y_morph_params.start);
+      node_b = &module->input_nodes (x_morph_params.end,   y_morph_params.start);
+      node_c = &module->input_nodes (x_morph_params.start, y_morph_params.end);
+      node_d = &module->input_nodes (x_morph_params.end,   y_morph_params.end);
+    }
+  have_a = get_normalized_block (*node_a, index, audio_block_a);
+  have_b = get_normalized_block (*node_b, index, audio_block_b);
+  if (node_c && node_d)
+    {
+      have_c = get_normalized_block (*node_c, index, audio_block_c);
+      have_d = get_normalized_block (*node_d, index, audio_block_d);
+    }
 
-      bool have_a = get_normalized_block (node_a, index, audio_block_a);
-      bool have_b = get_normalized_block (node_b, index, audio_block_b);
-      bool have_c = get_normalized_block (node_c, index, audio_block_c);
-      bool have_d = get_normalized_block (node_d, index, audio_block_d);
+  /* voice-invariant: check if another voice already computed the result */
+  MorphBlockCache::Key key;
+  const bool use_cache = module->block_cache && module->voice_invariant();
+  if (use_cache)
+    {
+      key.add_param (x_morphing);
+      key.add_param (y_morphing);
+      key.add_input (have_a, audio_block_a);
+      key.add_input (have_b, audio_block_b);
+      key.add_input (have_c, audio_block_c);
+      key.add_input (have_d, audio_block_d);
+
+      bool have_block;
+      if (module->block_cache->lookup (key, out_block, have_block))
+        return have_block;
+    }
+
+  bool   have_out;
+  double delta_db = 0;
+  if (module->cfg->height == 1)
+    {
+      have_out = MorphUtils::morph (out_block, have_a, audio_block_a, have_b, audio_block_b, x_morph_params.morphing, morph_mode);
+      delta_db = morph_delta_db (node_a->delta_db, node_b->delta_db, x_morph_params.morphing);
+    }
+  else if (module->cfg->width == 1)
+    {
+      have_out = MorphUtils::morph (out_block, have_a, audio_block_a, have_b, audio_block_b, y_morph_params.morphing, morph_mode);
+      delta_db = morph_delta_db (node_a->delta_db, node_b->delta_db, y_morph_params.morphing);
+    }
+  else
+    {
+      RTAudioBlock audio_block_ab (module->rt_memory_area());
+      RTAudioBlock audio_block_cd (module->rt_memory_area());
 
       bool have_ab = MorphUtils::morph (audio_block_ab, have_a, audio_block_a, have_b, audio_block_b, x_morph_params.morphing, morph_mode);
       bool have_cd = MorphUtils::morph (audio_block_cd, have_c, audio_block_c, have_d, audio_block_d, x_morph_params.morphing, morph_mode);
-      bool have_abcd = MorphUtils::morph (out_block, have_ab, audio_block_ab, have_cd, audio_block_cd, y_morph_params.morphing, morph_mode);
+      have_out = MorphUtils::morph (out_block, have_ab, audio_block_ab, have_cd, audio_block_cd, y_morph_params.morphing, morph_mode);
 
-      if (have_abcd)
-        {
-          double delta_db_ab = morph_delta_db (node_a.delta_db, node_b.delta_db, x_morph_params.morphing);
-          double delta_db_cd = morph_delta_db (node_c.delta_db, node_d.delta_db, x_morph_params.morphing);
-          double delta_db_abcd = morph_delta_db (delta_db_ab, delta_db_cd, y_morph_params.morphing);
-
-          apply_delta_db (out_block, delta_db_abcd);
-          return true;
-        }
-      else
-        {
-          return false;
-        }
+      double delta_db_ab = morph_delta_db (node_a->delta_db, node_b->delta_db, x_morph_params.morphing);
+      double delta_db_cd = morph_delta_db (node_c->delta_db, node_d->delta_db, x_morph_params.morphing);
+      delta_db = morph_delta_db (delta_db_ab, delta_db_cd, y_morph_params.morphing);
     }
+  if (have_out)
+    apply_delta_db (out_block, delta_db);
+
+  if (use_cache)
+    module->block_cache->store (key, out_block, have_out);
+
+  return have_out;
+}
+
+MorphModuleSharedState *
+MorphGridModule::create_shared_state()
+{
+  return new MorphBlockCache();
+}
+
+void
+MorphGridModule::set_shared_state (MorphModuleSharedState *new_shared_state)
+{
+  block_cache = dynamic_cast<MorphBlockCache *> (new_shared_state);
+  assert (block_cache);
+}
+
+void
+MorphGridModule::update_shared_state (const TimeInfo& time_info)
+{
+  /* new block: results from last block are no longer needed */
+  block_cache->clear();
 }
 
 LiveDecoderSource *
@@ -27,3 +27,10 @@ MorphKeyTrackModule::value()
   set_notify_value (1, note);
   return v;
 }
+
+bool
+MorphKeyTrackModule::pure_value() const
+{
+  /* only depends on the current frequency */
+  return true;
+}
@@ -18,6 +18,7 @@ public:
 
   void  set_config (const MorphOperatorConfig *cfg) override;
   float value() override;
+  bool  pure_value() const override;
 };
 
 }
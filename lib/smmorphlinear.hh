@@ -20,8 +20,8 @@ public:
   {
     MorphOperatorPtr left_op;
     MorphOperatorPtr right_op;
-    WavSet          *left_wav_set = nullptr;
-    WavSet          *right_wav_set = nullptr;
+    std::shared_ptr<WavSet> left_wav_set;
+    std::shared_ptr<WavSet> right_wav_set;
 
     ModulationData   morphing_mod;
     bool             db_linear;
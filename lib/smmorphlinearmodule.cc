@@ -46,11 +46,11 @@ MorphLinearModule::set_config (const MorphOperatorConfig *op_cfg)
 
   have_left_source = cfg->left_wav_set != nullptr;
   if (have_left_source)
-    left_source.set_wav_set (cfg->left_wav_set);
+    left_source.set_wav_set (cfg->left_wav_set.get());
 
   have_right_source = cfg->right_wav_set != nullptr;
   if (have_right_source)
-    right_source.set_wav_set (cfg->right_wav_set);
+    right_source.set_wav_set (cfg->right_wav_set.get());
 }
 
 void
@@ -130,8 +130,26 @@ MorphLinearModule::MySource::rt_audio_block (size_t index, RTAudioBlock& out_aud
       have_right = MorphUtils::get_normalized_block (&module->right_source, time_ms, right_block);
     }
 
-  return MorphUtils::morph (out_audio_block, have_left, left_block, have_right, right_block, morphing, morph_mode);
+  /* voice-invariant: check if another voice already computed the result */
+  MorphBlockCache::Key key;
+  const bool use_cache = module->block_cache && module->voice_invariant();
+  if (use_cache)
+    {
+      key.add_param (morphing);
+      key.add_input (have_left, left_block);
+      key.add_input (have_right, right_block);
+
+      bool have_block;
+      if (module->block_cache->lookup (key, out_audio_block, have_block))
+        return have_block;
+    }
+
+  bool have_out = MorphUtils::morph (out_audio_block, have_left, left_block, have_right, right_block, morphing, morph_mode);
 
+  if (use_cache)
+    module->block_cache->store (key, out_audio_block, have_out);
+
+  return have_out;
 }
 
 LiveDecoderSource *
@@ -139,3 +157,23 @@ MorphLinearModule::source()
 {
   return &my_source;
 }
+
+MorphModuleSharedState *
+MorphLinearModule::create_shared_state()
+{
+  return new MorphBlockCache();
+}
+
+void
+MorphLinearModule::set_shared_state (MorphModuleSharedState *new_shared_state)
+{
+  block_cache = dynamic_cast<MorphBlockCache *> (new_shared_state);
+  assert (block_cache);
+}
+
+void
+MorphLinearModule::update_shared_state (const TimeInfo& time_info)
+{
+  /* new block: results from last block are no longer needed */
+  block_cache->clear();
+}
@@ -27,6 +27,8 @@ class MorphLinearModule : public MorphOperatorModule
 
   Audio                audio;
 
+  MorphBlockCache     *block_cache = nullptr;
+
   struct MySource : public LiveDecoderSource
   {
     MorphLinearModule    *module;
@@ -42,6 +44,10 @@ public:
 
   void set_config (const MorphOperatorConfig *cfg);
   LiveDecoderSource *source();
+
+  MorphModuleSharedState *create_shared_state() override;
+  void set_shared_state (MorphModuleSharedState *new_shared_state) override;
+  void update_shared_state (const TimeInfo& time_info) override;
 };
 
 }
@@ -21,6 +21,184 @@ MorphModuleSharedState::~MorphModuleSharedState()
 {
 }
 
+void
+MorphModuleSharedState::config_changed()
+{
+}
+
+void
+MorphBlockCache::Key::add_input (bool have_block, const RTAudioBlock& block)
+{
+  if (n_inputs == MAX_INPUTS)
+    {
+      m_valid = false;
+      return;
+    }
+  Input& input = inputs[n_inputs++];
+  if (!have_block)
+    return;
+
+  /* blocks which are not read-only views (private results of one voice) can't be identified */
+  if (!block.freqs.borrowed() || !block.mags.borrowed() || !block.noise.borrowed())
+    {
+      m_valid = false;
+      return;
+    }
+  input.freqs   = block.freqs.data();
+  input.mags    = block.mags.data();
+  input.noise   = block.noise.data();
+  input.n_freqs = block.freqs.size();
+  input.n_noise = block.noise.size();
+}
+
+void
+MorphBlockCache::Key::add_param (double value)
+{
+  if (n_params == MAX_PARAMS)
+    {
+      m_valid = false;
+      return;
+    }
+  params[n_params++] = value;
+}
+
+bool
+MorphBlockCache::Key::operator== (const Key& other) const
+{
+  if (n_inputs != other.n_inputs || n_params != other.n_params)
+    return false;
+
+  for (size_t i = 0; i < n_inputs; i++)
+    {
+      const Input& a = inputs[i];
+      const Input& b = other.inputs[i];
+
+      if (a.freqs != b.freqs || a.mags != b.mags || a.noise != b.noise || a.n_freqs != b.n_freqs || a.n_noise != b.n_noise)
+        return false;
+    }
+  for (size_t i = 0; i < n_params; i++)
+    {
+      if (params[i] != other.params[i])
+        return false;
+    }
+  return true;
+}
+
+MorphBlockCache::MorphBlockCache() :
+  m_storage (MAX_STORAGE)
+{
+}
+
+bool
+MorphBlockCache::try_lock()
+{
+  /* voices can be rendered in parallel, but we never wait for another voice:
+   * a busy cache is treated like a cache miss
+   */
+  return !m_lock.test_and_set (std::memory_order_acquire);
+}
+
+void
+MorphBlockCache::unlock()
+{
+  m_lock.clear (std::memory_order_release);
+}
+
+bool
+MorphBlockCache::lookup (const Key& key, RTAudioBlock& out_block, bool& have_block)
+{
+  if (!key.valid() || !try_lock())
+    return false;
+
+  for (size_t i = 0; i < m_n_entries; i++)
+    {
+      const Entry& entry = m_entries[i];
+      if (entry.key == key)
+        {
+          have_block = entry.have_block;
+          if (have_block)
+            out_block.assign_view (*entry.block);
+
+          unlock();
+          return true;
+        }
+    }
+  unlock();
+  return false;
+}
+
+const uint16_t *
+MorphBlockCache::copy_to_storage (const RTVector<uint16_t>& vec)
+{
+  uint16_t *start = m_storage.data() + m_storage_used;
+
+  std::copy (vec.data(), vec.data() + vec.size(), start);
+  m_storage_used += vec.size();
+  return start;
+}
+
+void
+MorphBlockCache::store (const Key& key, const RTAudioBlock& block, bool have_block)
+{
+  if (!key.valid() || !try_lock())
+    return;
+
+  /* another voice could have stored the same result while we were computing it */
+  for (size_t i = 0; i < m_n_entries; i++)
+    {
+      if (m_entries[i].key == key)
+        {
+          unlock();
+          return;
+        }
+    }
+  const bool   is_view      = block.freqs.borrowed() && block.mags.borrowed() && block.noise.borrowed();
+  const size_t storage_size = (have_block && !is_view) ? block.freqs.size() + block.mags.size() + block.noise.size() : 0;
+
+  if (m_n_entries < MAX_ENTRIES && m_storage_used + storage_size <= m_storage.size())
+    {
+      Entry& entry = m_entries[m_n_entries++];
+
+      entry.key = key;
+      entry.have_block = have_block;
+      entry.block.emplace (nullptr); // only used for views, never allocates
+      if (have_block && is_view)
+        {
+          /* read-only data (for instance instrument frames) doesn't need to be copied */
+          entry.block->assign_view (block);
+        }
+      else if (have_block)
+        {
+          entry.block->freqs.assign_view (copy_to_storage (block.freqs), block.freqs.size());
+          entry.block->mags.assign_view (copy_to_storage (block.mags), block.mags.size());
+          entry.block->noise.assign_view (copy_to_storage (block.noise), block.noise.size());
+        }
+    }
+  unlock();
+}
+
+void
+MorphBlockCache::clear()
+{
+  /* only called while no voice is rendered, so the lock is always available */
+  const bool locked = try_lock();
+  assert (locked);
+
+  for (size_t i = 0; i < m_n_entries; i++)
+    m_entries[i].block.reset();
+
+  m_n_entries = 0;
+  m_storage_used = 0;
+  unlock();
+}
+
+void
+MorphBlockCache::config_changed()
+{
+  /* cached results were computed using the old config */
+  clear();
+}
+
 MorphOperatorModule::MorphOperatorModule (MorphPlanVoice *voice) :
   morph_plan_voice (voice)
 {
@@ -43,6 +221,16 @@ MorphOperatorModule::value()
   return 0;
 }
 
+/* true if value() only depends on time and the voice state covered by
+ * MorphPlanVoice::modulation_generation(), so it can be cached; operators that
+ * integrate time steps (envelopes, lfos) or draw random numbers must return false
+ */
+bool
+MorphOperatorModule::pure_value() const
+{
+  return false;
+}
+
 void
 MorphOperatorModule::note_on (const TimeInfo& time_info)
 {
@@ -87,7 +275,7 @@ MorphOperatorModule::set_shared_state (MorphModuleSharedState *new_shared_state)
 Random *
 MorphOperatorModule::random_gen() const
 {
-  return morph_plan_voice->morph_plan_synth()->random_gen();
+  return morph_plan_voice->random_gen();
 }
 
 RTMemoryArea *
@@ -115,8 +303,84 @@ MorphOperatorModule::set_ptr_id (MorphOperator::PtrID ptr_id)
   m_ptr_id = ptr_id;
 }
 
+void
+MorphOperatorModule::set_voice_invariant (bool voice_invariant)
+{
+  m_voice_invariant = voice_invariant;
+}
+
+bool
+MorphOperatorModule::voice_invariant() const
+{
+  return m_voice_invariant;
+}
+
 float
 MorphOperatorModule::apply_modulation (const ModulationData& mod_data) const
+{
+  /* values set in the gui don't need to be cached */
+  if (mod_data.main_control_type == MorphOperator::CONTROL_GUI && mod_data.entries.empty())
+    return std::clamp<float> (mod_data.value, mod_data.min_value, mod_data.max_value);
+
+  /* modulation values only change if time or voice state (control inputs, notes, ...) change,
+   * unless one of the inputs is a stateful operator (see pure_value)
+   */
+  const TimeInfo time = time_info();
+  const uint64   generation = morph_plan_voice->modulation_generation();
+  if (generation != m_mod_cache.generation || time.time_ms != m_mod_cache.time_ms || time.ppq_pos != m_mod_cache.ppq_pos)
+    {
+      m_mod_cache.generation = generation;
+      m_mod_cache.time_ms = time.time_ms;
+      m_mod_cache.ppq_pos = time.ppq_pos;
+      m_mod_cache.n_entries = 0;
+    }
+  for (uint i = 0; i < m_mod_cache.n_entries; i++)
+    {
+      if (m_mod_cache.mod_data[i] == &mod_data)
+        {
+          if (!m_mod_cache.cacheable[i])
+            break;
+
+          m_mod_cache.stats.hits++;
+          return m_mod_cache.value[i];
+        }
+    }
+  const float value = compute_modulation (mod_data);
+  m_mod_cache.stats.misses++;
+
+  if (m_mod_cache.n_entries < ModulationCache::MAX_ENTRIES)
+    {
+      /* entries for stateful inputs are kept, too, so we only check once per time/generation */
+      m_mod_cache.mod_data[m_mod_cache.n_entries] = &mod_data;
+      m_mod_cache.value[m_mod_cache.n_entries] = value;
+      m_mod_cache.cacheable[m_mod_cache.n_entries] = modulation_cacheable (mod_data);
+      m_mod_cache.n_entries++;
+    }
+  return value;
+}
+
+bool
+MorphOperatorModule::modulation_cacheable (const ModulationData& mod_data) const
+{
+  if (mod_data.main_control_type == MorphOperator::CONTROL_OP && !morph_plan_voice->module (mod_data.main_control_op)->pure_value())
+    return false;
+
+  for (const auto& entry : mod_data.entries)
+    {
+      if (entry.control_type == MorphOperator::CONTROL_OP && !morph_plan_voice->module (entry.control_op)->pure_value())
+        return false;
+    }
+  return true;
+}
+
+MorphOperatorModule::ModulationCacheStats
+MorphOperatorModule::modulation_cache_stats() const
+{
+  return m_mod_cache.stats;
+}
+
+float
+MorphOperatorModule::compute_modulation (const ModulationData& mod_data) const
 {
   double base;
   double value = 0;
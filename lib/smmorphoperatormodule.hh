@@ -9,6 +9,8 @@
 #include "smrtmemory.hh"
 
 #include <array>
+#include <atomic>
+#include <optional>
 #include <string>
 
 namespace SpectMorph
@@ -21,17 +23,115 @@ class MorphModuleSharedState
   LeakDebugger leak_debugger { "SpectMorph::MorphModuleSharedState" };
 public:
   virtual ~MorphModuleSharedState();
+
+  /* called once per (cheap) plan update, after all voices got the new config */
+  virtual void config_changed();
+};
+
+/*
+ * Shared state for voice-invariant modules: results computed by one voice are
+ * stored and reused by all other voices that need the same result during the
+ * same block.
+ *
+ * The key for a result consists of the module parameters (morphing values) and
+ * the identity of the input blocks. Only inputs that are read-only views can
+ * be used for the key (data pointers identify the content); these are frames
+ * of the instruments or results from other block caches.
+ *
+ * The cache never blocks and never allocates memory: if another voice holds the
+ * lock, lookup() reports a miss and store() drops the result, and results are
+ * only stored while the preallocated storage has enough space left.
+ */
+class MorphBlockCache : public MorphModuleSharedState
+{
+public:
+  static constexpr size_t MAX_INPUTS  = 4;
+  static constexpr size_t MAX_PARAMS  = 2;
+  static constexpr size_t MAX_ENTRIES = 64;
+  static constexpr size_t MAX_STORAGE = 64 * 1024; // uint16_t values for entries that are not views
+
+  class Key
+  {
+    struct Input
+    {
+      const uint16_t *freqs = nullptr;
+      const uint16_t *mags  = nullptr;
+      const uint16_t *noise = nullptr;
+      size_t          n_freqs = 0;
+      size_t          n_noise = 0;
+    };
+    std::array<Input, MAX_INPUTS>  inputs {};
+    std::array<double, MAX_PARAMS> params {};
+    size_t                         n_inputs = 0;
+    size_t                         n_params = 0;
+    bool                           m_valid = true;
+  public:
+    void add_input (bool have_block, const RTAudioBlock& block);
+    void add_param (double value);
+
+    bool valid() const { return m_valid; }
+    bool operator== (const Key& other) const;
+  };
+private:
+  struct Entry
+  {
+    Key                         key;
+    bool                        have_block = false;
+    std::optional<RTAudioBlock> block;
+  };
+  std::array<Entry, MAX_ENTRIES>    m_entries;
+  size_t                            m_n_entries = 0;
+  std::vector<uint16_t>             m_storage;
+  size_t                            m_storage_used = 0;
+  std::atomic_flag                  m_lock = ATOMIC_FLAG_INIT;
+
+  bool try_lock();
+  void unlock();
+  const uint16_t *copy_to_storage (const RTVector<uint16_t>& vec);
+public:
+  MorphBlockCache();
+
+  bool lookup (const Key& key, RTAudioBlock& out_block, bool& have_block);
+  void store (const Key& key, const RTAudioBlock& block, bool have_block);
+  void clear();
+  void config_changed() override;
 };
 
 class MorphOperatorModule
 {
 public:
   static constexpr uint               MAX_NOTIFY_VALUES = 2;
+
+  struct ModulationCacheStats
+  {
+    uint64 hits   = 0;
+    uint64 misses = 0;
+  };
+private:
+  /* evaluated modulation values, valid as long as time and voice state don't change */
+  struct ModulationCache
+  {
+    static constexpr uint MAX_ENTRIES = 4;
+
+    uint64                                          generation = 0;
+    double                                          time_ms = -1;
+    double                                          ppq_pos = -1;
+    std::array<const ModulationData *, MAX_ENTRIES> mod_data {};
+    std::array<float, MAX_ENTRIES>                  value {};
+    std::array<bool, MAX_ENTRIES>                   cacheable {};
+    uint                                            n_entries = 0;
+    ModulationCacheStats                            stats;
+  };
+  mutable ModulationCache             m_mod_cache;
+
+  float compute_modulation (const ModulationData& mod_data) const;
+  bool  modulation_cacheable (const ModulationData& mod_data) const;
 protected:
   MorphPlanVoice                     *morph_plan_voice;
   MorphOperator::PtrID                m_ptr_id;
   std::array<float,MAX_NOTIFY_VALUES> m_notify_values {};
   uint                                m_have_notify_values = 0;
+  bool                                m_voice_invariant = false;
 
   Random *random_gen() const;
   RTMemoryArea *rt_memory_area() const;
@@ -45,6 +145,7 @@ public:
   virtual void set_config (const MorphOperatorConfig *op_cfg) = 0;
   virtual LiveDecoderSource *source();
   virtual float value();
+  virtual bool pure_value() const;
   virtual void note_on (const TimeInfo& time_info);
   virtual void note_off();
   virtual void update_shared_state (const TimeInfo& time_info);
@@ -52,8 +153,11 @@ public:
   virtual void set_shared_state (MorphModuleSharedState *new_shared_state);
 
   void set_ptr_id (MorphOperator::PtrID ptr_id);
+  void set_voice_invariant (bool voice_invariant);
+  bool voice_invariant() const;
 
   const std::array<float, MAX_NOTIFY_VALUES>& get_notify_values (uint& count) const;
+  ModulationCacheStats modulation_cache_stats() const;
 
   static MorphOperatorModule *create (const std::string& type, MorphPlanVoice *voice);
 };
@@ -232,9 +232,19 @@ MorphPlan::load_internal (GenericInP in, ExtraParameters *params)
 
                   GenericInP blob_in = ifile.open_blob();
                   vector<unsigned char>& blob_data = blob_data_map[ifile.event_blob_sum()];
-                  int ch;
-                  while ((ch = blob_in->get_byte()) >= 0)
-                    blob_data.push_back (ch);
+
+                  size_t blob_size;
+                  const unsigned char *blob_mem = blob_in->mmap_mem (blob_size);
+                  if (blob_mem) /* fast variant for the mmap case */
+                    {
+                      blob_data.assign (blob_mem, blob_mem + blob_size);
+                    }
+                  else
+                    {
+                      int ch;
+                      while ((ch = blob_in->get_byte()) >= 0)
+                        blob_data.push_back (ch);
+                    }
 
                   InFile blob_infile (MMapIn::open_vector (blob_data));
                   bool read_ok = load_op->load (blob_infile);
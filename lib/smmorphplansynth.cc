@@ -3,6 +3,11 @@
 #include "smmorphplansynth.hh"
 #include "smmorphplanvoice.hh"
 #include "smmorphoutputmodule.hh"
+#include "smmorphlinear.hh"
+#include "smmorphgrid.hh"
+#include "smmorphwavsource.hh"
+#include "smmorphlfo.hh"
+#include "smmodulationlist.hh"
 
 using namespace SpectMorph;
 
@@ -63,8 +68,164 @@ recursive_cycle_check (MorphOperator *start_op, int depth)
   return false;
 }
 
+namespace
+{
+
+/*
+ * Classify operators as voice-invariant or voice-dependent.
+ *
+ * The output of a voice-invariant operator only depends on the selected frames of
+ * its inputs and on values that are the same for all voices (gui settings,
+ * control signals, synchronized lfos). So voices which play the same frames can
+ * share the result (see MorphBlockCache), instead of evaluating the operator
+ * once per voice.
+ *
+ * If the control signals are set per voice (MidiSynth in control by cc / MPE mode),
+ * operators that use them are voice-dependent: the values would differ between
+ * voices, so sharing results would rarely work.
+ */
+class VoiceInvariantClassifier
+{
+  enum class State { UNKNOWN, IN_PROGRESS, INVARIANT, DEPENDENT };
+
+  const vector<MorphPlanSynth::Update::Op>& ops;
+  vector<State>                             states;
+  bool                                      per_voice_control_signals;
+
+  const MorphPlanSynth::Update::Op *
+  find_op (MorphOperator::PtrID ptr_id)
+  {
+    auto it = lower_bound (ops.begin(), ops.end(), ptr_id,
+                           [](const MorphPlanSynth::Update::Op& op, MorphOperator::PtrID ptr_id) { return op.ptr_id < ptr_id; });
+    if (it != ops.end() && it->ptr_id == ptr_id)
+      return &*it;
+    return nullptr;
+  }
+  bool
+  op_invariant (MorphOperator::PtrID ptr_id)
+  {
+    auto op = find_op (ptr_id);
+    if (!op)
+      return false;
+
+    return classify (op - ops.data());
+  }
+  bool
+  op_invariant (const MorphOperatorPtr& ptr)
+  {
+    if (!ptr) /* no input */
+      return true;
+
+    return op_invariant (ptr.ptr_id());
+  }
+  bool
+  control_invariant (MorphOperator::ControlType control_type, const MorphOperatorPtr& control_op)
+  {
+    switch (control_type)
+      {
+        case MorphOperator::CONTROL_GUI:
+          return true;
+        case MorphOperator::CONTROL_SIGNAL_1:
+        case MorphOperator::CONTROL_SIGNAL_2:
+        case MorphOperator::CONTROL_SIGNAL_3:
+        case MorphOperator::CONTROL_SIGNAL_4:
+          return !per_voice_control_signals;
+        case MorphOperator::CONTROL_OP:
+          return op_invariant (control_op);
+        default:
+          return false;
+      }
+  }
+  bool
+  mod_invariant (const ModulationData& mod_data)
+  {
+    if (!control_invariant (mod_data.main_control_type, mod_data.main_control_op))
+      return false;
+
+    for (const auto& entry : mod_data.entries)
+      if (!control_invariant (entry.control_type, entry.control_op))
+        return false;
+
+    return true;
+  }
+  bool
+  compute_invariant (const MorphPlanSynth::Update::Op& op)
+  {
+    /* whatever the type, an operator can't be invariant if one of its inputs isn't */
+    for (auto dep : op.dependencies)
+      if (!op_invariant (dep))
+        return false;
+
+    if (op.type == "SpectMorph::MorphSource")
+      {
+        return true;
+      }
+    else if (op.type == "SpectMorph::MorphWavSource")
+      {
+        auto cfg = dynamic_cast<const MorphWavSource::Config *> (op.config);
+
+        /* formant correction has per voice state */
+        if (cfg->formant_correct != FormantCorrection::MODE_REPITCH)
+          return false;
+
+        return cfg->play_mode != MorphWavSource::PLAY_MODE_CUSTOM_POSITION || mod_invariant (cfg->position_mod);
+      }
+    else if (op.type == "SpectMorph::MorphLinear")
+      {
+        auto cfg = dynamic_cast<const MorphLinear::Config *> (op.config);
+
+        return op_invariant (cfg->left_op) && op_invariant (cfg->right_op) && mod_invariant (cfg->morphing_mod);
+      }
+    else if (op.type == "SpectMorph::MorphGrid")
+      {
+        auto cfg = dynamic_cast<const MorphGrid::Config *> (op.config);
+
+        for (int x = 0; x < cfg->width; x++)
+          for (int y = 0; y < cfg->height; y++)
+            if (!op_invariant (cfg->input_node[x][y].op))
+              return false;
+
+        return mod_invariant (cfg->x_morphing_mod) && mod_invariant (cfg->y_morphing_mod);
+      }
+    else if (op.type == "SpectMorph::MorphLFO")
+      {
+        auto cfg = dynamic_cast<const MorphLFO::Config *> (op.config);
+
+        /* synchronized lfos have the same phase in every voice, but the random waves
+         * take their values from the random generator of the voice
+         */
+        if (cfg->wave_type == MorphLFO::WAVE_RANDOM_SH || cfg->wave_type == MorphLFO::WAVE_RANDOM_LINEAR)
+          return false;
+
+        return cfg->sync_voices;
+      }
+    /* output, envelope, key track, ... */
+    return false;
+  }
+public:
+  VoiceInvariantClassifier (const vector<MorphPlanSynth::Update::Op>& ops, bool per_voice_control_signals) :
+    ops (ops),
+    states (ops.size(), State::UNKNOWN),
+    per_voice_control_signals (per_voice_control_signals)
+  {
+  }
+  bool
+  classify (size_t index)
+  {
+    if (states[index] == State::UNKNOWN)
+      {
+        states[index] = State::IN_PROGRESS;
+        states[index] = compute_invariant (ops[index]) ? State::INVARIANT : State::DEPENDENT;
+      }
+    /* IN_PROGRESS: cycle, treat as voice-dependent */
+    return states[index] == State::INVARIANT;
+  }
+};
+
+}
+
 MorphPlanSynth::UpdateP
-MorphPlanSynth::prepare_update (const MorphPlan& plan) /* main thread */
+MorphPlanSynth::prepare_update (const MorphPlan& plan, bool per_voice_control_signals) /* main thread */
 {
   UpdateP update = std::make_shared<Update>();
 
@@ -84,12 +245,23 @@ MorphPlanSynth::prepare_update (const MorphPlan& plan) /* main thread */
         .type   = o->type(),
         .config = config
       };
+      for (auto dep : o->dependencies())
+        if (dep)
+          op.dependencies.push_back (dep->ptr_id());
       update->ops.push_back (op);
       update->new_configs.emplace_back (config); // take ownership (unique_ptr)
     }
   sort (update->ops.begin(), update->ops.end(),
         [](const Update::Op& a, const Update::Op& b) { return a.ptr_id < b.ptr_id; });
 
+  if (!update->have_cycle)
+    {
+      VoiceInvariantClassifier classifier (update->ops, per_voice_control_signals);
+
+      for (size_t i = 0; i < update->ops.size(); i++)
+        update->ops[i].voice_invariant = classifier.classify (i);
+    }
+
   vector<string> update_ids = sorted_id_list (plan);
 
   update->cheap = (update_ids == m_last_update_ids) && (plan.id() == m_last_plan_id);
@@ -111,6 +283,7 @@ MorphPlanSynth::prepare_update (const MorphPlan& plan) /* main thread */
               op_module.module.reset (MorphOperatorModule::create (op.type, voices[voice]));
               op_module.ptr_id = op.ptr_id;
               op_module.config = op.config;
+              op_module.voice_invariant = op.voice_invariant;
 
               if (op_module.module)
                 {
@@ -150,6 +323,11 @@ MorphPlanSynth::apply_update (MorphPlanSynth::UpdateP update) /* audio thread */
     {
       for (size_t i = 0; i < voices.size(); i++)
         voices[i]->cheap_update (update);
+
+      /* full updates create new shared states, cheap updates reuse the old ones */
+      for (auto& shared_state : voices_shared_states)
+        if (shared_state)
+          shared_state->config_changed();
     }
   else
     {
@@ -186,6 +364,9 @@ MorphPlanSynth::set_random_seed (int seed)
   m_random_seed = seed;
   if (seed != -1)
     m_random_gen.set_seed (seed);
+
+  for (size_t i = 0; i < voices.size(); i++)
+    voices[i]->set_random_seed (seed == -1 ? -1 : seed + 1 + i);
 }
 
 int
@@ -194,6 +375,33 @@ MorphPlanSynth::random_seed() const
   return m_random_seed;
 }
 
+void
+MorphPlanSynth::set_parallel_voices (bool parallel)
+{
+  m_parallel_voices = parallel;
+}
+
+bool
+MorphPlanSynth::parallel_voices() const
+{
+  return m_parallel_voices;
+}
+
+MorphOperatorModule::ModulationCacheStats
+MorphPlanSynth::modulation_cache_stats() const
+{
+  MorphOperatorModule::ModulationCacheStats stats;
+
+  for (auto voice : voices)
+    {
+      auto voice_stats = voice->modulation_cache_stats();
+
+      stats.hits   += voice_stats.hits;
+      stats.misses += voice_stats.misses;
+    }
+  return stats;
+}
+
 bool
 MorphPlanSynth::have_output() const
 {
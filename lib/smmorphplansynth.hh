@@ -5,6 +5,7 @@
 
 #include "smmorphplan.hh"
 #include "smmorphoperator.hh"
+#include "smmorphoperatormodule.hh"
 #include "smrandom.hh"
 #include "smtimeinfo.hh"
 #include <map>
@@ -32,12 +33,14 @@ protected:
   Random          m_random_gen;
   int             m_random_seed = -1;
   bool            m_have_cycle = false;
+  bool            m_parallel_voices = false;
 
 public:
   struct OpModule {
     std::unique_ptr<MorphOperatorModule> module;
     MorphOperator::PtrID ptr_id;
     MorphOperatorConfig *config = nullptr;
+    bool voice_invariant = false;
   };
   struct FullUpdateVoice
   {
@@ -51,6 +54,8 @@ public:
       MorphOperator::PtrID ptr_id;
       std::string          type;
       MorphOperatorConfig *config = nullptr;
+      bool                 voice_invariant = false; // output doesn't depend on note/velocity/per voice state
+      std::vector<MorphOperator::PtrID> dependencies;  // inputs (see MorphOperator::dependencies())
     };
     bool            cheap = false; // cheap update: same set of operators
     bool            have_cycle = false; // plan contains cycles?
@@ -64,7 +69,7 @@ public:
   MorphPlanSynth (float mix_freq, size_t n_voices);
   ~MorphPlanSynth();
 
-  UpdateP prepare_update (const MorphPlan& new_plan);
+  UpdateP prepare_update (const MorphPlan& new_plan, bool per_voice_control_signals = false);
   void apply_update (UpdateP update);
 
   void update_shared_state (const TimeInfo& time_info);
@@ -77,6 +82,10 @@ public:
   bool    have_cycle() const;
   void    set_random_seed (int seed);
   int     random_seed() const;
+  void    set_parallel_voices (bool parallel);
+  bool    parallel_voices() const;
+
+  MorphOperatorModule::ModulationCacheStats modulation_cache_stats() const;
 };
 
 }
@@ -23,8 +23,13 @@ MorphPlanVoice::MorphPlanVoice (float mix_freq, MorphPlanSynth *synth) :
 void
 MorphPlanVoice::configure_modules()
 {
+  m_modulation_generation++;
+
   for (size_t i = 0; i < modules.size(); i++)
-    modules[i].module->set_config (modules[i].config);
+    {
+      modules[i].module->set_voice_invariant (modules[i].voice_invariant);
+      modules[i].module->set_config (modules[i].config);
+    }
 }
 
 MorphOutputModule *
@@ -73,6 +78,7 @@ MorphPlanVoice::cheap_update (MorphPlanSynth::UpdateP update)
     {
       assert (modules[i].ptr_id == update->ops[i].ptr_id);
       modules[i].config = update->ops[i].config;
+      modules[i].voice_invariant = update->ops[i].voice_invariant;
       assert (modules[i].config);
     }
 
@@ -101,13 +107,18 @@ MorphPlanVoice::set_control_input (int i, double value)
 {
   assert (i >= 0 && i < MorphPlan::N_CONTROL_INPUTS);
 
-  m_control_input[i] = value;
+  if (m_control_input[i] != value)
+    {
+      m_control_input[i] = value;
+      m_modulation_generation++;
+    }
 }
 
 void
 MorphPlanVoice::set_velocity (float velocity)
 {
   m_velocity = velocity;
+  m_modulation_generation++;
 }
 
 float
@@ -119,7 +130,11 @@ MorphPlanVoice::velocity() const
 void
 MorphPlanVoice::set_current_freq (float current_freq)
 {
-  m_current_freq = current_freq;
+  if (m_current_freq != current_freq)
+    {
+      m_current_freq = current_freq;
+      m_modulation_generation++;
+    }
 }
 
 float
@@ -140,6 +155,47 @@ MorphPlanVoice::morph_plan_synth() const
   return m_morph_plan_synth;
 }
 
+Random *
+MorphPlanVoice::random_gen()
+{
+  /* with parallel voice rendering, voices must not share the random generator
+   * of the synth, since they are processed by different threads
+   */
+  if (m_morph_plan_synth->parallel_voices())
+    return &m_random_gen;
+
+  return m_morph_plan_synth->random_gen();
+}
+
+void
+MorphPlanVoice::set_random_seed (int seed)
+{
+  if (seed != -1)
+    m_random_gen.set_seed (seed);
+}
+
+uint64
+MorphPlanVoice::modulation_generation() const
+{
+  /* changes whenever modulation values could change for reasons other than time */
+  return m_modulation_generation;
+}
+
+MorphOperatorModule::ModulationCacheStats
+MorphPlanVoice::modulation_cache_stats() const
+{
+  MorphOperatorModule::ModulationCacheStats stats;
+
+  for (const auto& m : modules)
+    {
+      auto module_stats = m.module->modulation_cache_stats();
+
+      stats.hits   += module_stats.hits;
+      stats.misses += module_stats.misses;
+    }
+  return stats;
+}
+
 void
 MorphPlanVoice::update_shared_state (const TimeInfo& time_info)
 {
@@ -150,6 +206,8 @@ MorphPlanVoice::update_shared_state (const TimeInfo& time_info)
 void
 MorphPlanVoice::note_on (const TimeInfo& time_info)
 {
+  m_modulation_generation++;
+
   for (size_t i = 0; i < modules.size(); i++)
     modules[i].module->note_on (time_info);
 }
@@ -157,6 +215,8 @@ MorphPlanVoice::note_on (const TimeInfo& time_info)
 void
 MorphPlanVoice::note_off()
 {
+  m_modulation_generation++;
+
   for (size_t i = 0; i < modules.size(); i++)
     modules[i].module->note_off();
 }
@@ -25,6 +25,8 @@ protected:
   float                         m_current_freq = 0;
   float                         m_velocity = 0;
   MorphPlanSynth               *m_morph_plan_synth = nullptr;
+  Random                        m_random_gen;
+  uint64                        m_modulation_generation = 0;
 
   void configure_modules();
 
@@ -48,6 +50,11 @@ public:
 
   MorphOutputModule *output();
   MorphPlanSynth *morph_plan_synth() const;
+  Random *random_gen();
+  void    set_random_seed (int seed);
+
+  uint64 modulation_generation() const;
+  MorphOperatorModule::ModulationCacheStats modulation_cache_stats() const;
 
   void update_shared_state (const TimeInfo& time_info);
   void note_on (const TimeInfo& time_info);
@@ -17,7 +17,7 @@ class MorphSource : public MorphOperator
 public:
   struct Config : public MorphOperatorConfig
   {
-    WavSet *wav_set = nullptr;
+    std::shared_ptr<WavSet> wav_set;
   };
   Config      m_config;
 protected:
@@ -18,6 +18,22 @@ SimpleWavSetSource::SimpleWavSetSource() :
 {
 }
 
+SimpleWavSetSource::~SimpleWavSetSource()
+{
+  release_stream_reader();
+}
+
+void
+SimpleWavSetSource::release_stream_reader()
+{
+  /* the wav set keeps a reference to the reader, so this doesn't free memory (rt safe) */
+  if (stream_reader)
+    {
+      stream_reader->release();
+      stream_reader.reset();
+    }
+}
+
 void
 SimpleWavSetSource::set_wav_set (WavSet *new_wav_set)
 {
@@ -25,14 +41,17 @@ SimpleWavSetSource::set_wav_set (WavSet *new_wav_set)
     {
       wav_set = new_wav_set;
       active_audio = nullptr;
+      stream_pool = nullptr;
+      release_stream_reader();
     }
 }
 
 void
 SimpleWavSetSource::retrigger (int channel, float freq, int midi_velocity)
 {
-  Audio *best_audio = NULL;
-  float  best_diff  = 1e10;
+  WavSetWave *best_wave = NULL;
+  Audio      *best_audio = NULL;
+  float       best_diff  = 1e10;
 
   if (wav_set)
     {
@@ -49,11 +68,24 @@ SimpleWavSetSource::retrigger (int channel, float freq, int midi_velocity)
                 {
                   best_diff = fabs (audio_note - note);
                   best_audio = audio;
+                  best_wave = &*wi;
                 }
             }
         }
     }
   active_audio = best_audio;
+  if (active_audio)
+    active_audio->request_frames (0); // lazy loading
+
+  /* streamed audio: if all readers are used by other voices, we try again in rt_audio_block() */
+  release_stream_reader();
+  stream_pool = best_wave ? best_wave->stream_readers.get() : nullptr;
+  if (stream_pool)
+    {
+      stream_reader = stream_pool->try_acquire();
+      if (stream_reader)
+        stream_reader->restart();
+    }
 }
 
 Audio*
@@ -65,9 +97,30 @@ SimpleWavSetSource::audio()
 bool
 SimpleWavSetSource::rt_audio_block (size_t index, RTAudioBlock& out_block)
 {
-  if (active_audio && index < active_audio->contents.size())
+  if (active_audio && stream_pool && !stream_reader && index >= active_audio->contents.size())
+    {
+      /* no reader was available so far: the pool grows in the background, so
+       * we may get one now, and start streaming at the current position
+       */
+      stream_reader = stream_pool->try_acquire();
+      if (stream_reader)
+        {
+          stream_reader->restart (index);
+        }
+      else if (index < stream_pool->n_frames() && !active_audio->contents.empty())
+        {
+          /* until then, hold the last head frame instead of ending the note */
+          out_block.assign_view (*active_audio, active_audio->contents.size() - 1);
+          return true;
+        }
+    }
+  if (active_audio && stream_reader)
+    return stream_reader->rt_audio_block (index, out_block);
+
+  if (active_audio && index < active_audio->n_frames())
     {
-      out_block.assign (active_audio->contents[index]);
+      active_audio->request_frames (index);
+      out_block.assign_view (*active_audio, active_audio->available_frame (index));
       return true;
     }
   else
@@ -98,5 +151,5 @@ MorphSourceModule::set_config (const MorphOperatorConfig *op_cfg)
 {
   auto cfg = dynamic_cast<const MorphSource::Config *> (op_cfg);
 
-  my_source.set_wav_set (cfg->wav_set);
+  my_source.set_wav_set (cfg->wav_set.get());
 }
@@ -5,6 +5,7 @@
 
 #include "smmorphoperatormodule.hh"
 #include "smwavset.hh"
+#include "smaudiostream.hh"
 
 namespace SpectMorph
 {
@@ -15,8 +16,13 @@ private:
   WavSet *wav_set;
   Audio  *active_audio;
 
+  AudioStreamReaderPool             *stream_pool = nullptr; // readers of the wav set, if active audio is streamed
+  std::shared_ptr<AudioStreamReader> stream_reader;
+
+  void release_stream_reader();
 public:
   SimpleWavSetSource();
+  ~SimpleWavSetSource();
 
   void        set_wav_set (WavSet *wav_set);
 
@@ -78,8 +78,68 @@ find_match (float freq, const FreqState *freq_state, size_t freq_state_size, siz
   return false;
 }
 
+/* start and end index of partials in the other block within +/- 0.5 of the frequency */
+struct MatchWindow
+{
+  uint32_t start;
+  uint32_t end;
+};
+
+/*
+ * merge pass over two blocks with sorted frequencies: computes the same search range
+ * find_match() would determine using lower_bound for each partial
+ */
+static void
+init_match_windows (const FreqState *freq_state, size_t freq_state_size,
+                    const FreqState *other_state, size_t other_state_size, MatchWindow *windows)
+{
+  size_t start = 0, end = 0;
+  for (size_t i = 0; i < freq_state_size; i++)
+    {
+      const float freq       = freq_state[i].freq_f;
+      const float freq_start = freq - 0.5;
+      const float freq_end   = freq + 0.5;
+
+      while (start < other_state_size && other_state[start].freq_f < freq_start)
+        start++;
+
+      end = max (end, start);
+      while (end < other_state_size && other_state[end].freq_f < freq_end)
+        end++;
+
+      windows[i].start = start;
+      windows[i].end = end;
+    }
+}
+
+static bool
+find_match_window (float freq, const FreqState *freq_state, const MatchWindow& window, size_t *index)
+{
+  float min_diff = 1e20;
+  size_t best_index = 0; // initialized to avoid compiler warning
+
+  for (size_t i = window.start; i < window.end; i++)
+    {
+      if (!freq_state[i].used)
+        {
+          float diff = std::abs (freq - freq_state[i].freq_f);
+          if (diff < min_diff)
+            {
+              best_index = i;
+              min_diff = diff;
+            }
+        }
+    }
+  if (min_diff < 0.5)
+    {
+      *index = best_index;
+      return true;
+    }
+  return false;
+}
+
 static size_t
-init_mag_data (MagData *mds, const RTAudioBlock& left_block, const RTAudioBlock& right_block)
+init_mag_data (MagData *mds, const RTAudioBlock& left_block, const RTAudioBlock& right_block, MatchEngine match_engine)
 {
   size_t mds_size = 0;
   for (size_t i = 0; i < left_block.freqs.size(); i++)
@@ -100,17 +160,44 @@ init_mag_data (MagData *mds, const RTAudioBlock& left_block, const RTAudioBlock&
       md.mag   = right_block.mags[i];
       mds_size++;
     }
-  sort (mds, mds + mds_size, md_cmp);
+  if (match_engine == MatchEngine::SORT_SEARCH)
+    {
+      sort (mds, mds + mds_size, md_cmp);
+    }
+  else
+    {
+      /* stable radix sort (two passes with 8 bits each), biggest magnitude first */
+      MagData tmp[mds_size + AVOID_ARRAY_UB];
+
+      auto radix_pass = [mds_size] (const MagData *in, MagData *out, int shift)
+        {
+          size_t count[257] = { 0, };
+          for (size_t m = 0; m < mds_size; m++)
+            count[((65535 - in[m].mag) >> shift) & 0xff]++;
+
+          size_t pos = 0;
+          for (size_t b = 0; b < 256; b++)
+            {
+              const size_t n = count[b];
+              count[b] = pos;
+              pos += n;
+            }
+          for (size_t m = 0; m < mds_size; m++)
+            out[count[((65535 - in[m].mag) >> shift) & 0xff]++] = in[m];
+        };
+      radix_pass (mds, tmp, 0);
+      radix_pass (tmp, mds, 8);
+    }
   return mds_size;
 }
 
 
 static void
-init_freq_state (const RTVector<uint16_t>& fint, FreqState *freq_state)
+init_freq_state (const RTAudioBlock& block, FreqState *freq_state)
 {
-  for (size_t i = 0; i < fint.size(); i++)
+  for (size_t i = 0; i < block.freqs.size(); i++)
     {
-      freq_state[i].freq_f = sm_ifreq2freq (fint[i]);
+      freq_state[i].freq_f = block.freqs_f (i);
       freq_state[i].used   = 0;
     }
 }
@@ -194,7 +281,7 @@ bool
 morph (RTAudioBlock& out_block,
        bool have_left, const RTAudioBlock& left_block,
        bool have_right, const RTAudioBlock& right_block,
-       double morphing, MorphUtils::MorphMode morph_mode)
+       double morphing, MorphUtils::MorphMode morph_mode, MorphUtils::MatchEngine match_engine)
 {
   const float interp = (morphing + 1) / 2; /* examples => 0: only left; 0.5 both equally; 1: only right */
 
@@ -219,15 +306,25 @@ morph (RTAudioBlock& out_block,
 
   MagData mds[max_partials + AVOID_ARRAY_UB];
 
-  size_t mds_size = MorphUtils::init_mag_data (mds, left_block, right_block);
+  size_t mds_size = MorphUtils::init_mag_data (mds, left_block, right_block, match_engine);
   size_t left_freqs_size = left_block.freqs.size();
   size_t right_freqs_size = right_block.freqs.size();
 
   MorphUtils::FreqState   left_freqs[left_freqs_size + AVOID_ARRAY_UB];
   MorphUtils::FreqState   right_freqs[right_freqs_size + AVOID_ARRAY_UB];
 
-  init_freq_state (left_block.freqs, left_freqs);
-  init_freq_state (right_block.freqs, right_freqs);
+  init_freq_state (left_block, left_freqs);
+  init_freq_state (right_block, right_freqs);
+
+  const bool linear = (match_engine == MatchEngine::LINEAR);
+
+  MorphUtils::MatchWindow left_windows[(linear ? left_freqs_size : 0) + AVOID_ARRAY_UB];
+  MorphUtils::MatchWindow right_windows[(linear ? right_freqs_size : 0) + AVOID_ARRAY_UB];
+  if (linear)
+    {
+      init_match_windows (left_freqs, left_freqs_size, right_freqs, right_freqs_size, left_windows);
+      init_match_windows (right_freqs, right_freqs_size, left_freqs, left_freqs_size, right_windows);
+    }
 
   for (size_t m = 0; m < mds_size; m++)
     {
@@ -238,13 +335,23 @@ morph (RTAudioBlock& out_block,
           i = mds[m].index;
 
           if (!left_freqs[i].used)
-            match = MorphUtils::find_match (left_freqs[i].freq_f, right_freqs, right_freqs_size, &j);
+            {
+              if (linear)
+                match = MorphUtils::find_match_window (left_freqs[i].freq_f, right_freqs, left_windows[i], &j);
+              else
+                match = MorphUtils::find_match (left_freqs[i].freq_f, right_freqs, right_freqs_size, &j);
+            }
         }
       else // (mds[m].block == MagData::BLOCK_RIGHT)
         {
           j = mds[m].index;
           if (!right_freqs[j].used)
-            match = MorphUtils::find_match (right_freqs[j].freq_f, left_freqs, left_freqs_size, &i);
+            {
+              if (linear)
+                match = MorphUtils::find_match_window (right_freqs[j].freq_f, left_freqs, right_windows[j], &i);
+              else
+                match = MorphUtils::find_match (right_freqs[j].freq_f, left_freqs, left_freqs_size, &i);
+            }
         }
       if (match)
         {
@@ -22,10 +22,21 @@ enum class MorphMode {
   DB_LINEAR
 };
 
+/* algorithm used to find matching partials of left and right block (both need sorted freqs)
+ *
+ * both engines produce the same result unless partials have exactly the same magnitude, then
+ * the order in which they are matched (and thus the output) can differ
+ */
+enum class MatchEngine {
+  SORT_SEARCH,  // std::sort by magnitude + binary search per partial
+  LINEAR        // radix sort by magnitude + precomputed match candidates (merge pass)
+};
+
 bool morph (RTAudioBlock& out_block,
             bool have_left, const RTAudioBlock& left_block,
             bool have_right, const RTAudioBlock& right_block,
-            double morphing, MorphUtils::MorphMode morph_mode);
+            double morphing, MorphUtils::MorphMode morph_mode,
+            MorphUtils::MatchEngine match_engine = MorphUtils::MatchEngine::SORT_SEARCH);
 
 bool get_normalized_block (LiveDecoderSource *source, double time_ms, RTAudioBlock& out_audio_block);
 
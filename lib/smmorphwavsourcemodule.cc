@@ -75,7 +75,7 @@ MorphWavSourceModule::InstrumentSource::rt_audio_block (size_t index, RTAudioBlo
         {
           // play everything
           start = 0;
-          end = active_audio->contents.size() - 1;
+          end = active_audio->n_frames() - 1;
         }
       else
         {
@@ -85,11 +85,11 @@ MorphWavSourceModule::InstrumentSource::rt_audio_block (size_t index, RTAudioBlo
         }
       index = std::clamp (sm_round_positive ((1 - position) * start + position * end), start, end);
     }
-  if (active_audio && index < active_audio->contents.size())
+  if (active_audio && index < active_audio->n_frames())
     {
       formant_correction.advance (module->time_info().time_ms - last_time_ms);
       last_time_ms = module->time_info().time_ms;
-      formant_correction.process_block (active_audio->contents[index], out_block);
+      formant_correction.process_block (*active_audio, index, out_block);
       return true;
     }
   else
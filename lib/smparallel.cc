@@ -0,0 +1,52 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smparallel.hh"
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+namespace SpectMorph
+{
+
+int
+sm_cpu_count()
+{
+  return std::max<int> (std::thread::hardware_concurrency(), 1);
+}
+
+void
+sm_parallel_for (size_t n_items, const std::function<void (size_t item)>& func, int n_threads)
+{
+  if (n_threads <= 0)
+    n_threads = sm_cpu_count();
+  n_threads = std::min<size_t> (n_threads, n_items);
+
+  if (n_threads <= 1)
+    {
+      for (size_t i = 0; i < n_items; i++)
+        func (i);
+      return;
+    }
+
+  std::atomic<size_t> next_item { 0 };
+  auto worker = [&]()
+    {
+      size_t i;
+      while ((i = next_item.fetch_add (1)) < n_items)
+        func (i);
+    };
+
+  /* the calling thread does its share of the work, too */
+  std::vector<std::thread> threads;
+  for (int t = 1; t < n_threads; t++)
+    threads.emplace_back (worker);
+
+  worker();
+
+  for (auto& thread : threads)
+    thread.join();
+}
+
+}
@@ -0,0 +1,25 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#ifndef SPECTMORPH_PARALLEL_HH
+#define SPECTMORPH_PARALLEL_HH
+
+#include <functional>
+
+namespace SpectMorph
+{
+
+/*
+ * Calls func (i) for all i in [0, n_items) using up to n_threads threads (0: one thread
+ * per cpu core); returns when all items are done. Items are claimed dynamically, so
+ * items don't need to take the same amount of time.
+ *
+ * Threads are started for each call, so this is meant for coarse grained, non-rt work
+ * like loading or encoding samples (see RTWorkerPool for rt safe processing).
+ */
+void sm_parallel_for (size_t n_items, const std::function<void (size_t item)>& func, int n_threads = 0);
+
+int  sm_cpu_count();
+
+}
+
+#endif
@@ -10,6 +10,8 @@
 #include "smuserinstrumentindex.hh"
 #include "smproject.hh"
 #include "smhexstring.hh"
+#include "smconfig.hh"
+#include "smwavsetstore.hh"
 
 #include <unistd.h>
 
@@ -112,17 +114,33 @@ Project::rebuild (MorphWavSource *wav_source)
   if (!instrument)
     return;
 
+  Config cfg;
+
   WavSetBuilder *builder = new WavSetBuilder (instrument, /* keep_samples */ false);
+  builder->set_float_cache (cfg.float_frame_cache());
+  // encode samples with as many threads as the user allows for rendering (0 would mean one per core)
+  builder->set_n_threads (std::max (cfg.render_threads(), 1));
   m_builder_thread.kill_jobs_by_id (object_id);
   synth_interface()->emit_add_rebuild_result (object_id, nullptr);
   // trigger configuration update, this will ensure that the modules pick up
   // the nullptr from the project, so that they will stop playing and not
   // access the old WavSet anymore
   m_morph_plan.emit_plan_changed();
+
+  // if another project (plugin instance) already uses an identical instrument,
+  // we can share its WavSet instead of building our own copy
+  const string content_hash = builder->content_hash();
+  std::shared_ptr<WavSet> shared_wav_set = WavSetStore::the()->lookup (content_hash);
+  if (shared_wav_set)
+    {
+      delete builder;
+      synth_interface()->emit_add_rebuild_result (object_id, shared_wav_set);
+      return;
+    }
   m_builder_thread.add_job (builder, object_id,
-    [this, object_id] (WavSet *wav_set)
+    [this, object_id, content_hash] (WavSet *wav_set)
       {
-        synth_interface()->emit_add_rebuild_result (object_id, wav_set);
+        synth_interface()->emit_add_rebuild_result (object_id, WavSetStore::the()->insert (content_hash, wav_set));
       });
 }
 
@@ -135,7 +153,7 @@ Project::rebuild_active (int object_id)
 }
 
 void
-Project::add_rebuild_result (int object_id, std::unique_ptr<WavSet>& wav_set)
+Project::add_rebuild_result (int object_id, std::shared_ptr<WavSet>& wav_set)
 {
   // this function runs in audio thread
   size_t s = object_id + 1;
@@ -146,7 +164,7 @@ Project::add_rebuild_result (int object_id, std::unique_ptr<WavSet>& wav_set)
 }
 
 void
-Project::clear_wav_sets (vector<std::unique_ptr<WavSet>>& new_wav_sets)
+Project::clear_wav_sets (vector<std::shared_ptr<WavSet>>& new_wav_sets)
 {
   // this function runs in audio thread
   wav_sets.swap (new_wav_sets);
@@ -238,6 +256,7 @@ Project::set_mix_freq (double mix_freq)
   m_midi_synth.reset (new MidiSynth (mix_freq, 64));
   m_mix_freq = mix_freq;
   m_midi_synth->set_random_seed (m_random_seed);
+  m_midi_synth->set_render_threads (Config().render_threads());
 
   // not rt safe either
   LiveDecoder::precompute_tables (mix_freq);
@@ -483,6 +502,11 @@ Project::load_internal (ZipReader& zip_reader, MorphPlan::ExtraParameters *param
           error = inst->load (inst_zip);
           if (error)
             return error;
+
+          /* unchanged instruments can be saved without encoding them again */
+          auto& map_entry = m_instrument_map[object_id];
+          map_entry.zip_hash = inst->zip_hash();
+          map_entry.zip_data = std::make_shared<vector<uint8_t>> (std::move (inst_data));
         }
       else
         {
@@ -523,7 +547,14 @@ Project::load_plan_lv2 (std::function<string(string)> absolute_path, const strin
   if (!HexString::decode (plan_str, data))
     return;
 
-  Error error = m_morph_plan.load (MMapIn::open_vector (data), nullptr);
+  load_plan_lv2_binary (absolute_path, data.data(), data.size());
+}
+
+void
+Project::load_plan_lv2_binary (std::function<string(string)> absolute_path, const unsigned char *data, size_t size)
+{
+  // parse host memory directly, without copying the plan
+  Error error = m_morph_plan.load (MMapIn::open_mem (data, data + size), nullptr);
   if (error)
     return;
 
@@ -580,6 +611,11 @@ Project::save (ZipWriter& zip_writer, MorphPlan::ExtraParameters *params)
   m_morph_plan.save (MemOut::open (&data), params);
 
   zip_writer.add ("plan.smplan", data);
+
+  /* instruments that didn't change since the last load/save (same zip_hash) are not encoded again,
+   * and identical instruments used by more than one wav source are only encoded once
+   */
+  std::map<string, std::shared_ptr<const vector<uint8_t>>> zip_data_map;
   for (auto wav_source : list_wav_sources())
     {
       // must do this before using object_id (lazy creation)
@@ -588,9 +624,27 @@ Project::save (ZipWriter& zip_writer, MorphPlan::ExtraParameters *params)
       int    object_id = wav_source->object_id();
       string inst_file = string_printf ("instrument%d.sminst", object_id);
 
-      ZipWriter   mem_zip;
-      map_entry.instrument->save (mem_zip);
-      zip_writer.add (inst_file, mem_zip.data(), ZipWriter::Compress::STORE);
+      const string zip_hash = map_entry.instrument->zip_hash();
+      if (zip_hash != map_entry.zip_hash || !map_entry.zip_data)
+        {
+          auto& zip_data = zip_data_map[zip_hash];
+          if (!zip_data)
+            {
+              ZipWriter mem_zip;
+              Error error = map_entry.instrument->save (mem_zip);
+              if (error)
+                return error;
+
+              zip_data = std::make_shared<vector<uint8_t>> (mem_zip.data());
+            }
+          map_entry.zip_hash = zip_hash;
+          map_entry.zip_data = zip_data;
+        }
+      else
+        {
+          zip_data_map[zip_hash] = map_entry.zip_data;
+        }
+      zip_writer.add (inst_file, *map_entry.zip_data, ZipWriter::Compress::STORE);
     }
 
   zip_writer.close();
@@ -602,6 +656,12 @@ Project::save (ZipWriter& zip_writer, MorphPlan::ExtraParameters *params)
 
 string
 Project::save_plan_lv2 (std::function<string(string)> abstract_path)
+{
+  return HexString::encode (save_plan_lv2_binary (abstract_path));
+}
+
+vector<unsigned char>
+Project::save_plan_lv2_binary (std::function<string(string)> abstract_path)
 {
   for (auto wav_source : list_wav_sources())
     {
@@ -622,8 +682,7 @@ Project::save_plan_lv2 (std::function<string(string)> abstract_path)
 
   clear_lv2_filenames();
 
-  string plan_str = HexString::encode (data);
-  return plan_str;
+  return data;
 }
 
 void
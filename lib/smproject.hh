@@ -83,7 +83,7 @@ public:
 
   static constexpr size_t WAV_SETS_RESERVE = 256;
 private:
-  std::vector<std::unique_ptr<WavSet>> wav_sets;
+  std::vector<std::shared_ptr<WavSet>> wav_sets; // shared with other projects via WavSetStore
 
   std::unique_ptr<MidiSynth>  m_midi_synth;
   double                      m_mix_freq = 0;
@@ -106,6 +106,10 @@ private:
   struct InstrumentMapEntry {
     std::unique_ptr<Instrument> instrument;
     std::string                 lv2_absolute_path;
+
+    /* instrument in zip format from the last load/save (avoids FLAC encoding for unchanged instruments) */
+    std::string                                  zip_hash;
+    std::shared_ptr<const std::vector<uint8_t>>  zip_data;
   };
   typedef std::map<int, InstrumentMapEntry> InstrumentMap;
   InstrumentMap               m_instrument_map;
@@ -126,8 +130,8 @@ public:
   void set_lv2_absolute_path (MorphWavSource *wav_source, const std::string& path);
 
   void rebuild (MorphWavSource *wav_source);
-  void add_rebuild_result (int object_id, std::unique_ptr<WavSet>& wav_set);
-  void clear_wav_sets (std::vector<std::unique_ptr<WavSet>>& wav_sets);
+  void add_rebuild_result (int object_id, std::shared_ptr<WavSet>& wav_set);
+  void clear_wav_sets (std::vector<std::shared_ptr<WavSet>>& wav_sets);
   bool rebuild_active (int object_id);
 
   WavSet *get_wav_set (int object_id);
@@ -159,6 +163,11 @@ public:
 
   std::string save_plan_lv2 (std::function<std::string(std::string)> abstract_path);
   void        load_plan_lv2 (std::function<std::string(std::string)> absolute_path, const std::string& plan);
+
+  /* binary state (without hex encoding) for hosts that can store binary data */
+  std::vector<unsigned char> save_plan_lv2_binary (std::function<std::string(std::string)> abstract_path);
+  void                       load_plan_lv2_binary (std::function<std::string(std::string)> absolute_path,
+                                                   const unsigned char *data, size_t size);
   void        clear_lv2_filenames();
 
   Signal<double> signal_volume_changed;
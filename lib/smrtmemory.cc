@@ -30,11 +30,22 @@ RTAudioBlock::sort_freqs()
   const size_t N = freqs.size();
   PartialData pvec[N + AVOID_ARRAY_UB];
 
+  /* read via const references: non-const access would copy borrowed (view) data */
+  const RTVector<uint16_t>& cfreqs = freqs;
+  const RTVector<uint16_t>& cmags = mags;
+
+  bool sorted = true;
   for (size_t p = 0; p < N; p++)
     {
-      pvec[p].freq = freqs[p];
-      pvec[p].mag = mags[p];
+      pvec[p].freq = cfreqs[p];
+      pvec[p].mag = cmags[p];
+
+      if (p > 0 && pvec[p - 1].freq > pvec[p].freq)
+        sorted = false;
     }
+  if (sorted) // nothing to do, keep data (and views) unchanged
+    return;
+
   std::sort (pvec, pvec + N, pd_cmp);
 
   // replace partial data with sorted partial data
@@ -44,3 +55,54 @@ RTAudioBlock::sort_freqs()
       mags[p] = pvec[p].mag;
     }
 }
+
+/* reduce the number of partials to n_partials, keeping the loudest partials (in their original order) */
+void
+RTAudioBlock::keep_loudest_partials (size_t n_partials)
+{
+  const size_t N = freqs.size();
+  if (N <= n_partials)
+    return;
+
+  const RTVector<uint16_t>& cfreqs = freqs;
+  const RTVector<uint16_t>& cmags = mags;
+
+  // find the magnitude of the quietest partial we keep
+  uint16_t sorted_mags[N + AVOID_ARRAY_UB];
+  for (size_t p = 0; p < N; p++)
+    sorted_mags[p] = cmags[p];
+
+  std::nth_element (sorted_mags, sorted_mags + N - n_partials, sorted_mags + N);
+  const uint16_t min_mag = sorted_mags[N - n_partials];
+
+  // partials louder than min_mag are always kept, partials with exactly min_mag as long as there is room
+  size_t n_min_mag = n_partials;
+  for (size_t p = 0; p < N; p++)
+    if (cmags[p] > min_mag)
+      n_min_mag--;
+
+  // move the partials we keep to the start (in place)
+  size_t n = 0;
+  for (size_t p = 0; p < N; p++)
+    {
+      const uint16_t mag = cmags[p];
+
+      bool keep = mag > min_mag;
+      if (mag == min_mag && n_min_mag > 0)
+        {
+          n_min_mag--;
+          keep = true;
+        }
+      if (keep)
+        {
+          if (n != p)
+            {
+              freqs[n] = cfreqs[p];
+              mags[n] = mag;
+            }
+          n++;
+        }
+    }
+  freqs.shrink (n);
+  mags.shrink (n);
+}
@@ -67,6 +67,13 @@ public:
   }
 };
 
+/*
+ * Vector that allocates its data from a RTMemoryArea.
+ *
+ * Using assign_view(), the vector can also be a read-only view of data that is owned
+ * by someone else (which must not change while the view is used). Such a view is
+ * copied to the memory area as soon as non-const access happens (copy-on-write).
+ */
 template<class T>
 class RTVector
 {
@@ -76,6 +83,18 @@ class RTVector
   T            *m_start = nullptr;
   size_t        m_size = 0;
   size_t        m_capacity = 0;
+  bool          m_borrowed = false;
+
+  void
+  make_writable()
+  {
+    const T *borrowed_start = m_start;
+
+    m_start = (T *) m_memory_area->alloc (sizeof (T) * m_size);
+    m_capacity = m_size;
+    m_borrowed = false;
+    std::copy (borrowed_start, borrowed_start + m_size, m_start);
+  }
 public:
   RTVector (RTMemoryArea *memory_area) :
     m_memory_area (memory_area)
@@ -89,25 +108,67 @@ public:
   void
   assign (const RTVector<T>& vec)
   {
-    assign (vec.m_start, vec.m_start + vec.m_size);
+    if (vec.m_borrowed)
+      {
+        /* no need to copy read-only data */
+        assert (m_size == 0 && m_capacity == 0 && !m_borrowed);
+
+        m_start = vec.m_start;
+        m_size = vec.m_size;
+        m_borrowed = true;
+      }
+    else
+      {
+        assign (vec.m_start, vec.m_start + vec.m_size);
+      }
   }
   template<class It>
   void
   assign (It start_it, It end_it)
   {
-    assert (m_size == 0 && m_capacity == 0);
+    assert (m_size == 0 && m_capacity == 0 && !m_borrowed);
 
     size_t size = end_it - start_it;
     set_capacity (size);
     std::copy (start_it, end_it, m_start);
     m_size = size;
   }
+  void
+  assign_view (const std::vector<T>& vec)
+  {
+    assert (m_size == 0 && m_capacity == 0 && !m_borrowed);
+
+    m_start = const_cast<T *> (vec.data());
+    m_size = vec.size();
+    m_borrowed = true;
+  }
+  /* read-only view of another vector (which must not change while the view is used) */
+  void
+  assign_view (const RTVector<T>& vec)
+  {
+    assign_view (vec.m_start, vec.m_size);
+  }
+  /* read-only view of size elements starting at start */
+  void
+  assign_view (const T *start, size_t size)
+  {
+    assert (m_size == 0 && m_capacity == 0 && !m_borrowed);
+
+    m_start = const_cast<T *> (start);
+    m_size = size;
+    m_borrowed = true;
+  }
   size_t
   size() const
   {
     return m_size;
   }
-  T *
+  bool
+  borrowed() const
+  {
+    return m_borrowed;
+  }
+  const T *
   data() const
   {
     return m_start;
@@ -115,11 +176,18 @@ public:
   void
   set_capacity (size_t capacity)
   {
-    assert (m_size == 0 && m_capacity == 0);
+    assert (m_size == 0 && m_capacity == 0 && !m_borrowed);
 
     m_start = (T *) m_memory_area->alloc (sizeof (T) * capacity);
     m_capacity = capacity;
   }
+  /* keep only the first size elements */
+  void
+  shrink (size_t size)
+  {
+    assert (size <= m_size);
+    m_size = size;
+  }
   void
   push_back (const T& t)
   {
@@ -129,11 +197,15 @@ public:
   T&
   back()
   {
+    if (m_borrowed)
+      make_writable();
     return m_start[m_size - 1];
   }
   T&
   operator[] (size_t idx)
   {
+    if (m_borrowed)
+      make_writable();
     return m_start[idx];
   }
   const T&
@@ -145,6 +217,8 @@ public:
 
 class RTAudioBlock
 {
+  const float *m_freqs_f = nullptr; // optional float version of freqs (see AudioFloatCache)
+  const float *m_mags_f = nullptr;  // optional float version of mags
 public:
   RTAudioBlock (RTMemoryArea *memory_area) :
     freqs (memory_area),
@@ -158,6 +232,9 @@ public:
     freqs.assign (audio_block.freqs);
     mags.assign (audio_block.mags);
     noise.assign (audio_block.noise);
+
+    m_freqs_f = audio_block.m_freqs_f;
+    m_mags_f = audio_block.m_mags_f;
   }
   void
   assign (const AudioBlock& audio_block)
@@ -166,6 +243,49 @@ public:
     mags.assign (audio_block.mags);
     noise.assign (audio_block.noise);
   }
+  /* read-only view: audio_block must not change or be deleted while the view is used */
+  void
+  assign_view (const AudioBlock& audio_block)
+  {
+    freqs.assign_view (audio_block.freqs);
+    mags.assign_view (audio_block.mags);
+    noise.assign_view (audio_block.noise);
+  }
+  /* read-only view: audio_block must not change while the view is used */
+  void
+  assign_view (const RTAudioBlock& audio_block)
+  {
+    freqs.assign_view (audio_block.freqs);
+    mags.assign_view (audio_block.mags);
+    noise.assign_view (audio_block.noise);
+
+    /* float versions are only valid if audio_block was not modified */
+    m_freqs_f = audio_block.freqs.borrowed() ? audio_block.m_freqs_f : nullptr;
+    m_mags_f = audio_block.mags.borrowed() ? audio_block.m_mags_f : nullptr;
+  }
+  /* read-only view of one frame, using the float cache of the audio (if available) */
+  void
+  assign_view (const Audio& audio, size_t frame)
+  {
+    if (audio.mapped_frames)
+      {
+        /* points into the mapped file (see AudioMappedFrames) */
+        const AudioMappedFrames::Frame& mapped_frame = audio.mapped_frames->frames[frame];
+
+        freqs.assign_view (mapped_frame.freqs, mapped_frame.n_freqs);
+        mags.assign_view (mapped_frame.mags, mapped_frame.n_freqs);
+        noise.assign_view (mapped_frame.noise, mapped_frame.n_noise);
+      }
+    else
+      {
+        assign_view (audio.contents[frame]);
+      }
+    if (audio.float_cache)
+      {
+        m_freqs_f = audio.float_cache->freqs (frame);
+        m_mags_f = audio.float_cache->mags (frame);
+      }
+  }
   RTVector<uint16_t> freqs;
   RTVector<uint16_t> mags;
   RTVector<uint16_t> noise;
@@ -173,12 +293,19 @@ public:
   float
   freqs_f (size_t i) const
   {
+    /* decoded values can only be used as long as the data was not modified */
+    if (m_freqs_f && freqs.borrowed())
+      return m_freqs_f[i];
+
     return sm_ifreq2freq (freqs[i]);
   }
 
   float
   mags_f (size_t i) const
   {
+    if (m_mags_f && mags.borrowed())
+      return m_mags_f[i];
+
     return sm_idb2factor (mags[i]);
   }
 
@@ -189,6 +316,7 @@ public:
   }
 
   void sort_freqs();
+  void keep_loudest_partials (size_t n_partials);
 };
 
 }
@@ -0,0 +1,169 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smrtworkerpool.hh"
+
+#include <chrono>
+
+#include <assert.h>
+
+#ifndef SM_OS_WINDOWS
+#include <pthread.h>
+#endif
+
+#if defined (__i386__) || defined (__x86_64__)
+#include <immintrin.h>
+#endif
+
+using namespace SpectMorph;
+
+/* workers that didn't get any work for this long go to sleep
+ *
+ * this needs to be a small fraction of the block period, otherwise workers
+ * would never sleep while notes are playing and burn one core each
+ */
+static constexpr auto IDLE_SPIN_TIME = std::chrono::microseconds (100);
+
+/* after this many busy waiting iterations we also give up the time slice */
+static constexpr int  SPIN_YIELD_ITERATIONS = 64;
+
+static inline void
+cpu_relax()
+{
+#if defined (__i386__) || defined (__x86_64__)
+  _mm_pause();
+#elif defined (__aarch64__) || defined (__arm__)
+  __asm__ __volatile__ ("yield");
+#endif
+}
+
+RTWorkerPool::RTWorkerPool (int n_threads, const WorkFunc& work_func) :
+  m_work_func (work_func)
+{
+  assert (n_threads >= 1);
+
+  /* the thread calling run() is worker 0, so we need one thread less */
+  for (int worker = 1; worker < n_threads; worker++)
+    m_threads.emplace_back (&RTWorkerPool::thread_main, this, worker);
+}
+
+RTWorkerPool::~RTWorkerPool()
+{
+  {
+    std::lock_guard lg (m_mutex);
+    m_quit.store (true);
+    m_cond.notify_all();
+  }
+  for (auto& thread : m_threads)
+    thread.join();
+}
+
+int
+RTWorkerPool::n_threads() const
+{
+  return m_threads.size() + 1;
+}
+
+void
+RTWorkerPool::process_items (int worker, uint64_t generation)
+{
+  const size_t n_items = m_n_items.load();
+
+  uint64_t work = m_work.load();
+  while ((work >> 32) == generation && (work & 0xffffffff) < n_items)
+    {
+      /* claim item: fails (and reloads work) if another thread was faster */
+      if (m_work.compare_exchange_weak (work, work + 1))
+        {
+          m_work_func (worker, work & 0xffffffff);
+          m_items_done.fetch_add (1);
+
+          work = m_work.load();
+        }
+    }
+}
+
+void
+RTWorkerPool::thread_main (int worker)
+{
+  uint64_t generation = 0;
+  auto     last_work_time = std::chrono::steady_clock::now();
+  int      spin_count = 0;
+
+  while (!m_quit.load())
+    {
+      const uint64_t new_generation = m_work.load() >> 32;
+      if (new_generation != generation)
+        {
+          generation = new_generation;
+          process_items (worker, generation);
+
+          last_work_time = std::chrono::steady_clock::now();
+          spin_count = 0;
+        }
+      else if (std::chrono::steady_clock::now() - last_work_time < IDLE_SPIN_TIME)
+        {
+          if (++spin_count % SPIN_YIELD_ITERATIONS == 0)
+            std::this_thread::yield();
+          else
+            cpu_relax();
+        }
+      else
+        {
+          std::unique_lock lock (m_mutex);
+
+          m_sleeping.fetch_add (1);
+          m_cond.wait (lock, [&] { return m_quit.load() || (m_work.load() >> 32) != generation; });
+          m_sleeping.fetch_sub (1);
+        }
+    }
+}
+
+void
+RTWorkerPool::set_sched_params()
+{
+#ifndef SM_OS_WINDOWS
+  /* workers should run with the same priority as the audio thread */
+  int         policy;
+  sched_param param;
+
+  if (pthread_getschedparam (pthread_self(), &policy, &param) == 0)
+    {
+      for (auto& thread : m_threads)
+        pthread_setschedparam (thread.native_handle(), policy, &param);
+    }
+#endif
+}
+
+void
+RTWorkerPool::run (size_t n_items)
+{
+  if (!m_sched_params_set)
+    {
+      set_sched_params();
+      m_sched_params_set = true;
+    }
+
+  const uint64_t generation = (m_work.load() >> 32) + 1;
+
+  m_n_items.store (n_items);
+  m_items_done.store (0);
+  m_work.store (generation << 32);
+
+  if (m_sleeping.load() > 0)
+    {
+      /* workers sleep between blocks unless blocks are very short; the mutex
+       * is only held by workers for a very short time, so this is cheap */
+      std::lock_guard lg (m_mutex);
+      m_cond.notify_all();
+    }
+  process_items (0, generation);
+
+  /* wait for items that are still being processed by other threads */
+  for (int spin_count = 1; m_items_done.load() < n_items; spin_count++)
+    {
+      if (spin_count % SPIN_YIELD_ITERATIONS == 0)
+        std::this_thread::yield();
+      else
+        cpu_relax();
+    }
+}
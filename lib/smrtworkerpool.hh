@@ -0,0 +1,62 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+#include "smutils.hh"
+
+namespace SpectMorph
+{
+
+/*
+ * Fixed set of worker threads that help the audio thread to process a number
+ * of independent items (for instance voices).
+ *
+ *  - threads are started by the constructor and stopped by the destructor (not rt safe)
+ *  - run() is rt safe: it doesn't allocate memory and the only time it takes
+ *    a lock is to wake up workers that went to sleep after being idle for a while
+ *  - the thread calling run() participates in processing (as worker 0)
+ *  - items are distributed dynamically: each thread claims the next unprocessed
+ *    item, so threads that finish early take over work from slower threads
+ */
+class RTWorkerPool
+{
+public:
+  typedef std::function<void (int worker, size_t item)> WorkFunc;
+
+private:
+  SPECTMORPH_CLASS_NON_COPYABLE (RTWorkerPool);
+
+  WorkFunc                 m_work_func;
+  std::vector<std::thread> m_threads;
+
+  /* upper 32 bits: generation (incremented for each run), lower 32 bits: next item */
+  std::atomic<uint64_t>    m_work { 0 };
+  std::atomic<size_t>      m_n_items { 0 };
+  std::atomic<size_t>      m_items_done { 0 };
+  std::atomic<int>         m_sleeping { 0 };
+  std::atomic<bool>        m_quit { false };
+  bool                     m_sched_params_set = false;
+
+  std::mutex               m_mutex;
+  std::condition_variable  m_cond;
+
+  void thread_main (int worker);
+  void process_items (int worker, uint64_t generation);
+  void set_sched_params();
+
+public:
+  RTWorkerPool (int n_threads, const WorkFunc& work_func);
+  ~RTWorkerPool();
+
+  int  n_threads() const;
+  void run (size_t n_items);
+};
+
+}
@@ -13,13 +13,15 @@ StdioSubIn::open (const std::string& filename, size_t pos, size_t len)
   FILE *file = fopen (filename.c_str(), "rb");
 
   if (file)
-    return GenericInP (new StdioSubIn (file, pos, len));
+    return GenericInP (new StdioSubIn (file, filename, pos, len));
   else
     return NULL;
 }
 
-StdioSubIn::StdioSubIn (FILE *file, size_t pos, size_t len) :
-  file (file)
+StdioSubIn::StdioSubIn (FILE *file, const std::string& filename, size_t pos, size_t len) :
+  file (file),
+  filename (filename),
+  file_start (pos)
 {
   fseek (file, pos, SEEK_SET);
   file_pos = 0;
@@ -91,6 +93,6 @@ StdioSubIn::get_pos()
 GenericInP
 StdioSubIn::open_subfile (size_t pos, size_t len)
 {
-  assert (false); // implement me
-  return nullptr;
+  /* for instance compressed frames of an audio object in a wav set */
+  return open (filename, file_start + pos, len);
 }
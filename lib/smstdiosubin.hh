@@ -15,10 +15,12 @@ class StdioSubIn final : public GenericIn
   LeakDebugger leak_debugger { "SpectMorph::StdioSubIn" };
 
   FILE *file;
+  std::string filename;
+  size_t file_start;
   size_t file_pos;
   size_t file_len;
 
-  StdioSubIn (FILE *file, size_t pos, size_t len);
+  StdioSubIn (FILE *file, const std::string& filename, size_t pos, size_t len);
 public:
   ~StdioSubIn();
 
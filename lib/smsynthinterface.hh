@@ -35,11 +35,11 @@ public:
     m_project->synth_take_control_event (new InstFunc (func, []() {}));
   }
   void
-  synth_inst_edit_update (bool active, WavSet *take_wav_set, WavSet *ref_wav_set)
+  synth_inst_edit_update (bool active, WavSet *take_wav_set, const std::shared_ptr<WavSet>& ref_wav_set)
   {
     /* ownership:
      *  - take_wav_set is owned by the event
-     *  - ref_wav_set is _not_ owned and will not be freed
+     *  - ref_wav_set is shared with the WavSetRepo (which will not evict it while it is in use)
      */
     struct EventData
     {
@@ -115,21 +115,20 @@ public:
         });
   }
   void
-  emit_add_rebuild_result (int object_id, WavSet *take_wav_set)
+  emit_add_rebuild_result (int object_id, const std::shared_ptr<WavSet>& wav_set)
   {
-    /* ownership of take_wav_set is transferred to the event */
     struct EventData
     {
-      std::unique_ptr<WavSet> wav_set;
+      std::shared_ptr<WavSet> wav_set;
     } *event_data = new EventData;
 
-    event_data->wav_set.reset (take_wav_set);
+    event_data->wav_set = wav_set;
 
     send_control_event (
       [=] (Project *project)
         {
-          // uses swap to assign the new unique ptr and ensure the old one gets freed
-          // outside the audio thread
+          // uses swap to assign the new shared ptr and ensure that the old reference
+          // gets dropped (and the WavSet possibly freed) outside the audio thread
           project->add_rebuild_result (object_id, event_data->wav_set);
         },
         event_data);
@@ -139,7 +138,7 @@ public:
   {
     struct EventData
     {
-      std::vector<std::unique_ptr<WavSet>> wav_sets;
+      std::vector<std::shared_ptr<WavSet>> wav_sets;
     } *event_data = new EventData;
 
     /* avoid malloc in audio threads if wav sets are added */
@@ -1,14 +1,19 @@
 // Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
 
 #include "smwavset.hh"
+#include "smparallel.hh"
 #include "smoutfile.hh"
 #include "sminfile.hh"
 #include "smmemout.hh"
+#include "smstdioout.hh"
+#include "smaudiostream.hh"
 
 #include <map>
 #include <set>
+#include <algorithm>
 
 #include <assert.h>
+#include <string.h>
 
 using std::vector;
 using std::string;
@@ -20,7 +25,23 @@ using namespace SpectMorph;
 Error
 WavSet::save (const string& filename, bool embed_models)
 {
-  OutFile of (filename.c_str(), "SpectMorph::WavSet", SPECTMORPH_BINARY_FILE_VERSION);
+  /* older versions of SpectMorph ignore errors while loading audio objects, so the wav set
+   * file version must change, too, if any audio object contains compressed frames
+   */
+  int file_version = SPECTMORPH_BINARY_FILE_VERSION;
+  for (const auto& wave : waves)
+    {
+      int audio_version = 0;
+      if (wave.audio)
+        audio_version = wave.audio->save_file_version();
+      else if (embed_models)
+        audio_version = InFile (wave.path).file_version();
+
+      if (audio_version == SPECTMORPH_COMPRESSED_FILE_VERSION)
+        file_version = SPECTMORPH_COMPRESSED_FILE_VERSION;
+    }
+
+  OutFile of (filename.c_str(), "SpectMorph::WavSet", file_version);
   if (!of.open_ok())
     {
       fprintf (stderr, "error: can't open output file '%s'.\n", filename.c_str());
@@ -82,17 +103,94 @@ WavSet::save (const string& filename, bool embed_models)
   return Error::Code::NONE;
 }
 
+namespace
+{
+
+/* event names used in SpectMorph::WavSet files, interned in this order (see InFile::intern) */
+enum WavSetEventID
+{
+  EV_WAVE,
+  EV_MIDI_NOTE,
+  EV_CHANNEL,
+  EV_VELOCITY_RANGE_MIN,
+  EV_VELOCITY_RANGE_MAX,
+  EV_PATH,
+  EV_NAME,
+  EV_SHORT_NAME,
+  EV_AUDIO
+};
+
+const char *const wav_set_event_names[] =
+{
+  "wave", "midi_note", "channel", "velocity_range_min", "velocity_range_max", "path", "name", "short_name", "audio"
+};
+
+constexpr int NO_SECTION = -2;
+
+}
+
+/**
+ * Loads a wav set file.
+ *
+ * \param load_options AUDIO_MAP_FRAMES: the audio objects of a mapped wav set point
+ * into the file data instead of copying it (see AudioMappedFrames)
+ * \param lazy_load_frames if non-zero, only load the first lazy_load_frames frames of
+ * each audio object and load the rest on demand (see load_requested_frames())
+ * \param n_threads number of threads used to decode the audio objects (0: one per cpu core)
+ */
 Error
-WavSet::load (const string& filename, AudioLoadOptions load_options)
+WavSet::load (const string& filename, AudioLoadOptions load_options, size_t lazy_load_frames, int n_threads)
 {
   clear();        // delete old contents (if any)
 
+  if (is_mapped_file (filename))
+    {
+      GenericInP file = GenericIn::open (filename);
+      if (!file)
+        return Error::Code::FILE_NOT_FOUND;
+
+      return load_mapped (file, load_options == AUDIO_MAP_FRAMES);
+    }
+
   map<string, Audio *> blob_map;
 
+  /* audio objects are decoded in parallel, in batches: without mmap, each pending
+   * job has its own open FILE, so we don't keep more than MAX_AUDIO_JOBS of them
+   */
+  struct AudioJob
+  {
+    Audio     *audio;
+    GenericInP blob_in;
+  };
+  vector<AudioJob> audio_jobs;
+  const size_t     MAX_AUDIO_JOBS = 64;
+
+  auto run_audio_jobs = [&]()
+    {
+      sm_parallel_for (audio_jobs.size(),
+        [&] (size_t i)
+          {
+            Audio *audio = audio_jobs[i].audio;
+            GenericInP& blob_in = audio_jobs[i].blob_in;
+
+            /* lazy loading needs mapped data, otherwise each Audio would keep its FILE open */
+            size_t remaining;
+            const bool lazy = lazy_load_frames && blob_in->mmap_mem (remaining);
+
+            /* lazy loading: Audio keeps what it needs to load the remaining frames later */
+            audio->load (blob_in, load_options, lazy ? lazy_load_frames : SIZE_MAX);
+            if (audio->lazy_frames)
+              audio->lazy_frames->filename = filename;
+
+            blob_in.reset(); // close subfile (unless needed for lazy loading)
+          }, n_threads);
+      audio_jobs.clear();
+    };
+
   WavSetWave *wave = NULL;
 
   InFile  ifile (filename);
-  string section;
+  int     section = NO_SECTION;
 
   if (!ifile.open_ok())
     return Error::Code::FILE_NOT_FOUND;
@@ -100,17 +198,24 @@ WavSet::load (const string& filename, AudioLoadOptions load_options)
   if (ifile.file_type() != "SpectMorph::WavSet")
     return Error::Code::FORMAT_INVALID;
 
-  if (ifile.file_version() != SPECTMORPH_BINARY_FILE_VERSION)
+  if (ifile.file_version() != SPECTMORPH_BINARY_FILE_VERSION &&
+      ifile.file_version() != SPECTMORPH_COMPRESSED_FILE_VERSION)
     return Error::Code::FORMAT_INVALID;
 
+  for (size_t id = 0; id < std::size (wav_set_event_names); id++)
+    {
+      const int interned_id = ifile.intern (wav_set_event_names[id]);
+      assert (interned_id == int (id));
+    }
+
   while (ifile.event() != InFile::END_OF_FILE)
     {
       if (ifile.event() == InFile::BEGIN_SECTION)
         {
-          assert (section == "");
-          section = ifile.event_name();
+          assert (section == NO_SECTION);
+          section = ifile.event_id();
 
-          if (section == "wave")
+          if (section == EV_WAVE)
             {
               assert (wave == NULL);
               wave = new WavSetWave();
@@ -118,7 +223,7 @@ WavSet::load (const string& filename, AudioLoadOptions load_options)
         }
       else if (ifile.event() == InFile::END_SECTION)
         {
-          if (section == "wave")
+          if (section == EV_WAVE)
             {
               assert (wave);
 
@@ -127,58 +232,58 @@ WavSet::load (const string& filename, AudioLoadOptions load_options)
               wave = NULL;
             }
 
-          assert (section != "");
-          section = "";
+          assert (section != NO_SECTION);
+          section = NO_SECTION;
         }
       else if (ifile.event() == InFile::INT)
         {
-          if (section == "wave")
+          if (section == EV_WAVE)
             {
-              if (ifile.event_name() == "midi_note")
+              if (ifile.event_id() == EV_MIDI_NOTE)
                 {
                   assert (wave);
                   wave->midi_note = ifile.event_int();
                 }
-              else if (ifile.event_name() == "channel")
+              else if (ifile.event_id() == EV_CHANNEL)
                 {
                   assert (wave);
                   wave->channel = ifile.event_int();
                 }
-              else if (ifile.event_name() == "velocity_range_min")
+              else if (ifile.event_id() == EV_VELOCITY_RANGE_MIN)
                 {
                   assert (wave);
                   wave->velocity_range_min = ifile.event_int();
                 }
-              else if (ifile.event_name() == "velocity_range_max")
+              else if (ifile.event_id() == EV_VELOCITY_RANGE_MAX)
                 {
                   assert (wave);
                   wave->velocity_range_max = ifile.event_int();
                 }
               else
-                printf ("unhandled int %s %s\n", section.c_str(), ifile.event_name().c_str());
+                printf ("unhandled int wave %s\n", ifile.event_name().c_str());
             }
           else
             assert (false);
         }
       else if (ifile.event() == InFile::STRING)
         {
-          if (section == "wave")
+          if (section == EV_WAVE)
             {
-              if (ifile.event_name() == "path")
+              if (ifile.event_id() == EV_PATH)
                 {
                   assert (wave);
                   wave->path = ifile.event_data();
                 }
               else
-                printf ("unhandled string %s %s\n", section.c_str(), ifile.event_name().c_str());
+                printf ("unhandled string wave %s\n", ifile.event_name().c_str());
             }
-          else if (section == "")
+          else if (section == NO_SECTION)
             {
-              if (ifile.event_name() == "name")
+              if (ifile.event_id() == EV_NAME)
                 {
                   name = ifile.event_data();
                 }
-              else if (ifile.event_name() == "short_name")
+              else if (ifile.event_id() == EV_SHORT_NAME)
                 {
                   short_name = ifile.event_data();
                 }
@@ -190,31 +295,33 @@ WavSet::load (const string& filename, AudioLoadOptions load_options)
         }
       else if (ifile.event() == InFile::BLOB)
         {
-          if (section == "wave")
+          if (section == EV_WAVE)
             {
-              if (ifile.event_name() == "audio")
+              if (ifile.event_id() == EV_AUDIO)
                 {
                   assert (wave);
                   assert (!wave->audio);
 
-                  GenericInP blob_in = ifile.open_blob();
-
                   wave->audio = new Audio();
-                  wave->audio->load (blob_in, load_options);
+                  audio_jobs.push_back ({ wave->audio, ifile.open_blob() });
+                  if (!audio_jobs.back().blob_in)
+                    return Error::Code::PARSE_ERROR;
+                  if (audio_jobs.size() == MAX_AUDIO_JOBS)
+                    run_audio_jobs();
 
                   blob_map[ifile.event_blob_sum()] = wave->audio;
                 }
               else
-                printf ("unhandled string %s %s\n", section.c_str(), ifile.event_name().c_str());
+                printf ("unhandled string wave %s\n", ifile.event_name().c_str());
             }
           else
             assert (false);
         }
       else if (ifile.event() == InFile::BLOB_REF)
         {
-          if (section == "wave")
+          if (section == EV_WAVE)
             {
-              if (ifile.event_name() == "audio")
+              if (ifile.event_id() == EV_AUDIO)
                 {
                   assert (wave);
                   assert (!wave->audio);
@@ -224,7 +331,7 @@ WavSet::load (const string& filename, AudioLoadOptions load_options)
                   assert (wave->audio);
                 }
               else
-                printf ("unhandled string %s %s\n", section.c_str(), ifile.event_name().c_str());
+                printf ("unhandled string wave %s\n", ifile.event_name().c_str());
             }
           else
             assert (false);
@@ -239,6 +346,462 @@ WavSet::load (const string& filename, AudioLoadOptions load_options)
         }
       ifile.next_event();
     }
+
+  /* each blob has its own GenericIn, so audio objects can be decoded independently */
+  run_audio_jobs();
+
+  return Error::Code::NONE;
+}
+
+/*
+ * Mapped file format (SPECTMORPH_MAPPED_FILE_VERSION)
+ *
+ * Unlike the tagged format written by OutFile, this layout can be used without
+ * parsing: a fixed size header, tables of fixed size entries for waves, audios
+ * and frames and 16 byte aligned uint16 arrays for the frame data.
+ * All offsets are relative to the start of the file, the byte order is little
+ * endian. Debug information (original_fft, debug_samples) is not stored.
+ */
+namespace
+{
+
+constexpr char     MAPPED_MAGIC[16] = "SpectMorphModel";
+constexpr uint32_t MAPPED_NO_AUDIO  = 0xffffffff;
+constexpr size_t   MAPPED_ALIGN     = 16;
+
+struct MappedHeader
+{
+  char     magic[16];
+  uint32_t version;
+  uint32_t n_waves;
+  uint32_t n_audios;
+  uint32_t name_len;
+  uint64_t name_offset;
+  uint32_t short_name_len;
+  uint32_t reserved;
+  uint64_t short_name_offset;
+  uint64_t waves_offset;
+  uint64_t audios_offset;
+};
+
+struct MappedWave
+{
+  int32_t  midi_note;
+  int32_t  channel;
+  int32_t  velocity_range_min;
+  int32_t  velocity_range_max;
+  uint32_t audio_index;
+  uint32_t path_len;
+  uint64_t path_offset;
+};
+
+struct MappedAudio
+{
+  float    mix_freq;
+  float    frame_size_ms;
+  float    frame_step_ms;
+  float    attack_start_ms;
+  float    attack_end_ms;
+  float    fundamental_freq;
+  float    original_samples_norm_db;
+  int32_t  zeropad;
+  int32_t  loop_type;
+  int32_t  loop_start;
+  int32_t  loop_end;
+  int32_t  zero_values_at_start;
+  int32_t  sample_count;
+  uint32_t n_frames;
+  uint64_t frames_offset;
+  uint64_t original_samples_offset;
+  uint64_t n_original_samples;
+};
+
+struct MappedFrame
+{
+  uint64_t data_offset; // arrays: noise, freqs, mags (n_freqs each), phases, env; each array is MAPPED_ALIGN aligned
+  uint32_t n_noise;
+  uint32_t n_freqs;
+  uint32_t n_phases;
+  uint32_t n_env;
+  float    env_f0;
+  uint32_t reserved;
+};
+
+static_assert (sizeof (MappedHeader) == 72 && sizeof (MappedWave) == 32 &&
+               sizeof (MappedAudio) == 80 && sizeof (MappedFrame) == 32, "mapped file layout must not depend on compiler");
+
+class MappedWriter
+{
+  vector<unsigned char> m_data;
+public:
+  uint64_t
+  append (const void *ptr, size_t size)
+  {
+    m_data.resize ((m_data.size() + MAPPED_ALIGN - 1) / MAPPED_ALIGN * MAPPED_ALIGN);
+
+    uint64_t offset = m_data.size();
+    m_data.resize (offset + size);
+    if (size)
+      memcpy (&m_data[offset], ptr, size);
+    return offset;
+  }
+  template<class T> uint64_t
+  append_vector (const vector<T>& vec)
+  {
+    return append (vec.data(), vec.size() * sizeof (T));
+  }
+  void
+  patch (uint64_t offset, const void *ptr, size_t size)
+  {
+    memcpy (&m_data[offset], ptr, size);
+  }
+  const vector<unsigned char>&
+  data() const
+  {
+    return m_data;
+  }
+};
+
+class MappedReader
+{
+  const unsigned char *m_mem;
+  size_t               m_size;
+public:
+  MappedReader (const unsigned char *mem, size_t size) :
+    m_mem (mem),
+    m_size (size)
+  {
+  }
+  /* returns nullptr if the file is too short */
+  const unsigned char *
+  get (uint64_t offset, uint64_t count, size_t elem_size)
+  {
+    if (offset > m_size || count > (m_size - offset) / elem_size)
+      return nullptr;
+    return m_mem + offset;
+  }
+  template<class T> bool
+  read (uint64_t offset, T& t)
+  {
+    auto ptr = get (offset, 1, sizeof (T));
+    if (!ptr)
+      return false;
+    memcpy (&t, ptr, sizeof (T));
+    return true;
+  }
+  template<class T> bool
+  read_vector (uint64_t offset, uint64_t count, vector<T>& vec)
+  {
+    auto ptr = get (offset, count, sizeof (T));
+    if (!ptr)
+      return false;
+    vec.resize (count);
+    if (count)
+      memcpy (vec.data(), ptr, count * sizeof (T));
+    return true;
+  }
+  bool
+  read_string (uint64_t offset, uint64_t len, string& str)
+  {
+    auto ptr = get (offset, len, 1);
+    if (!ptr)
+      return false;
+    str.assign (reinterpret_cast<const char *> (ptr), len);
+    return true;
+  }
+};
+
+}
+
+bool
+WavSet::is_mapped_file (const string& filename)
+{
+  char magic[sizeof (MAPPED_MAGIC)];
+
+  FILE *file = fopen (filename.c_str(), "rb");
+  if (!file)
+    return false;
+
+  bool result = fread (magic, sizeof (magic), 1, file) == 1 && memcmp (magic, MAPPED_MAGIC, sizeof (magic)) == 0;
+  fclose (file);
+  return result;
+}
+
+/**
+ * Saves the wav set in the mapped file format, which can be loaded much faster than
+ * the tagged format written by save(), because no parsing is required. Debug
+ * information is not saved.
+ */
+Error
+WavSet::save_mapped (const string& filename) const
+{
+  if (G_BYTE_ORDER != G_LITTLE_ENDIAN)
+    return Error::Code::FORMAT_INVALID;
+
+  MappedWriter writer;
+  MappedHeader header {};
+
+  writer.append (&header, sizeof (header)); // written again after all offsets are known
+
+  /* the same Audio object can be used by more than one wave */
+  map<const Audio *, uint32_t> audio_index;
+  vector<MappedAudio>          mapped_audios;
+  for (const auto& wave : waves)
+    {
+      const Audio *audio = wave.audio;
+      if (!audio || audio_index.count (audio))
+        continue;
+
+      /* audio objects loaded with AUDIO_MAP_FRAMES have no contents */
+      std::unique_ptr<Audio> audio_copy;
+      if (audio->mapped_frames)
+        audio_copy.reset (audio->clone());
+
+      vector<MappedFrame> mapped_frames;
+      for (const auto& block : (audio_copy ? audio_copy.get() : audio)->contents)
+        {
+          MappedFrame frame {};
+
+          if (block.mags.size() != block.freqs.size())
+            return Error::Code::FORMAT_INVALID;
+
+          frame.data_offset = writer.append_vector (block.noise);
+          writer.append_vector (block.freqs);
+          writer.append_vector (block.mags);
+          writer.append_vector (block.phases);
+          writer.append_vector (block.env);
+          frame.n_noise  = block.noise.size();
+          frame.n_freqs  = block.freqs.size();
+          frame.n_phases = block.phases.size();
+          frame.n_env    = block.env.size();
+          frame.env_f0   = block.env_f0;
+          mapped_frames.push_back (frame);
+        }
+
+      MappedAudio mapped_audio {};
+      mapped_audio.mix_freq                 = audio->mix_freq;
+      mapped_audio.frame_size_ms            = audio->frame_size_ms;
+      mapped_audio.frame_step_ms            = audio->frame_step_ms;
+      mapped_audio.attack_start_ms          = audio->attack_start_ms;
+      mapped_audio.attack_end_ms            = audio->attack_end_ms;
+      mapped_audio.fundamental_freq         = audio->fundamental_freq;
+      mapped_audio.original_samples_norm_db = audio->original_samples_norm_db;
+      mapped_audio.zeropad                  = audio->zeropad;
+      mapped_audio.loop_type                = audio->loop_type;
+      mapped_audio.loop_start               = audio->loop_start;
+      mapped_audio.loop_end                 = audio->loop_end;
+      mapped_audio.zero_values_at_start     = audio->zero_values_at_start;
+      mapped_audio.sample_count             = audio->sample_count;
+      mapped_audio.n_frames                 = mapped_frames.size();
+      mapped_audio.frames_offset            = writer.append_vector (mapped_frames);
+      mapped_audio.n_original_samples       = audio->original_samples.size();
+      mapped_audio.original_samples_offset  = writer.append_vector (audio->original_samples);
+
+      audio_index[audio] = mapped_audios.size();
+      mapped_audios.push_back (mapped_audio);
+    }
+
+  vector<MappedWave> mapped_waves;
+  for (const auto& wave : waves)
+    {
+      MappedWave mapped_wave {};
+
+      mapped_wave.midi_note          = wave.midi_note;
+      mapped_wave.channel            = wave.channel;
+      mapped_wave.velocity_range_min = wave.velocity_range_min;
+      mapped_wave.velocity_range_max = wave.velocity_range_max;
+      mapped_wave.audio_index        = wave.audio ? audio_index[wave.audio] : MAPPED_NO_AUDIO;
+      mapped_wave.path_len           = wave.path.size();
+      mapped_wave.path_offset        = writer.append (wave.path.data(), wave.path.size());
+      mapped_waves.push_back (mapped_wave);
+    }
+
+  memcpy (header.magic, MAPPED_MAGIC, sizeof (header.magic));
+  header.version           = SPECTMORPH_MAPPED_FILE_VERSION;
+  header.n_waves           = mapped_waves.size();
+  header.n_audios          = mapped_audios.size();
+  header.name_len          = name.size();
+  header.name_offset       = writer.append (name.data(), name.size());
+  header.short_name_len    = short_name.size();
+  header.short_name_offset = writer.append (short_name.data(), short_name.size());
+  header.waves_offset      = writer.append_vector (mapped_waves);
+  header.audios_offset     = writer.append_vector (mapped_audios);
+  writer.patch (0, &header, sizeof (header));
+
+  GenericOutP out = StdioOut::open (filename);
+  if (!out)
+    return Error::Code::FILE_NOT_FOUND;
+
+  const auto& data = writer.data();
+  if (out->write (data.data(), data.size()) != int (data.size()))
+    return Error::Code::FILE_NOT_FOUND;
+
+  return Error::Code::NONE;
+}
+
+/* map_frames: frame data is not copied, the audio objects point into the file (see AudioMappedFrames) */
+Error
+WavSet::load_mapped (GenericInP file, bool map_frames)
+{
+  if (G_BYTE_ORDER != G_LITTLE_ENDIAN)
+    return Error::Code::FORMAT_INVALID;
+
+  /* normally the file is memory mapped, otherwise we need to read it */
+  vector<unsigned char> file_data;
+  size_t                size;
+  const unsigned char  *mem = file->mmap_mem (size);
+  if (!mem)
+    {
+      unsigned char buffer[64 * 1024];
+      int len;
+
+      while ((len = file->read (buffer, sizeof (buffer))) > 0)
+        file_data.insert (file_data.end(), buffer, buffer + len);
+
+      mem = file_data.data();
+      size = file_data.size();
+    }
+
+  MappedReader reader (mem, size);
+  MappedHeader header;
+  if (!reader.read (0, header) || memcmp (header.magic, MAPPED_MAGIC, sizeof (header.magic)) != 0)
+    return Error::Code::FORMAT_INVALID;
+
+  if (header.version != SPECTMORPH_MAPPED_FILE_VERSION)
+    return Error::Code::FORMAT_INVALID;
+
+  if (!reader.read_string (header.name_offset, header.name_len, name) ||
+      !reader.read_string (header.short_name_offset, header.short_name_len, short_name))
+    return Error::Code::PARSE_ERROR;
+
+  vector<Audio *> audios;
+  auto parse_error = [&]()
+    {
+      /* all audio objects used by waves are in audios */
+      waves.clear();
+      for (auto audio : audios)
+        delete audio;
+      return Error::Code::PARSE_ERROR;
+    };
+
+  for (uint32_t a = 0; a < header.n_audios; a++)
+    {
+      MappedAudio mapped_audio;
+      if (!reader.read (header.audios_offset + a * sizeof (MappedAudio), mapped_audio))
+        return parse_error();
+
+      Audio *audio = new Audio();
+      audios.push_back (audio);
+
+      audio->mix_freq                 = mapped_audio.mix_freq;
+      audio->frame_size_ms            = mapped_audio.frame_size_ms;
+      audio->frame_step_ms            = mapped_audio.frame_step_ms;
+      audio->attack_start_ms          = mapped_audio.attack_start_ms;
+      audio->attack_end_ms            = mapped_audio.attack_end_ms;
+      audio->fundamental_freq         = mapped_audio.fundamental_freq;
+      audio->original_samples_norm_db = mapped_audio.original_samples_norm_db;
+      audio->zeropad                  = mapped_audio.zeropad;
+      if (mapped_audio.loop_type < Audio::LOOP_NONE || mapped_audio.loop_type > Audio::LOOP_TIME_PING_PONG)
+        return parse_error();
+
+      audio->loop_type                = static_cast<Audio::LoopType> (mapped_audio.loop_type);
+      audio->loop_start               = mapped_audio.loop_start;
+      audio->loop_end                 = mapped_audio.loop_end;
+      audio->zero_values_at_start     = mapped_audio.zero_values_at_start;
+      audio->sample_count             = mapped_audio.sample_count;
+
+      if (!reader.read_vector (mapped_audio.original_samples_offset, mapped_audio.n_original_samples, audio->original_samples))
+        return parse_error();
+
+      if (!reader.get (mapped_audio.frames_offset, mapped_audio.n_frames, sizeof (MappedFrame)))
+        return parse_error();
+
+      AudioMappedFrames mapped_frames;
+      mapped_frames.frames.resize (mapped_audio.n_frames);
+      for (uint32_t f = 0; f < mapped_audio.n_frames; f++)
+        {
+          MappedFrame frame;
+          reader.read (mapped_audio.frames_offset + f * sizeof (MappedFrame), frame);
+
+          AudioMappedFrames::Frame& mframe = mapped_frames.frames[f];
+          uint64_t offset = frame.data_offset;
+          auto get_array = [&] (uint32_t n, const uint16_t*& ptr)
+            {
+              /* arrays are aligned (see MappedWriter::append), so we can use them in place */
+              ptr = reinterpret_cast<const uint16_t *> (reader.get (offset, n, sizeof (uint16_t)));
+
+              /* next array starts at the next aligned offset */
+              offset += n * sizeof (uint16_t);
+              offset = (offset + MAPPED_ALIGN - 1) / MAPPED_ALIGN * MAPPED_ALIGN;
+              return ptr != nullptr;
+            };
+          if (!get_array (frame.n_noise, mframe.noise) ||
+              !get_array (frame.n_freqs, mframe.freqs) ||
+              !get_array (frame.n_freqs, mframe.mags) ||
+              !get_array (frame.n_phases, mframe.phases) ||
+              !get_array (frame.n_env, mframe.env))
+            return parse_error();
+
+          mframe.n_noise  = frame.n_noise;
+          mframe.n_freqs  = frame.n_freqs;
+          mframe.n_phases = frame.n_phases;
+          mframe.n_env    = frame.n_env;
+          mframe.env_f0   = frame.env_f0;
+
+          // ensure that freqs are sorted (we need that for LiveDecoder)
+          if (!std::is_sorted (mframe.freqs, mframe.freqs + mframe.n_freqs))
+            return parse_error();
+        }
+      if (map_frames)
+        {
+          audio->mapped_frames.reset (new AudioMappedFrames (std::move (mapped_frames)));
+        }
+      else
+        {
+          audio->contents.resize (mapped_frames.frames.size());
+          for (size_t f = 0; f < mapped_frames.frames.size(); f++)
+            mapped_frames.copy_frame (f, audio->contents[f]);
+        }
+    }
+
+  for (uint32_t w = 0; w < header.n_waves; w++)
+    {
+      MappedWave mapped_wave;
+      if (!reader.read (header.waves_offset + w * sizeof (MappedWave), mapped_wave))
+        return parse_error();
+
+      WavSetWave wave;
+      wave.midi_note          = mapped_wave.midi_note;
+      wave.channel            = mapped_wave.channel;
+      wave.velocity_range_min = mapped_wave.velocity_range_min;
+      wave.velocity_range_max = mapped_wave.velocity_range_max;
+
+      if (!reader.read_string (mapped_wave.path_offset, mapped_wave.path_len, wave.path))
+        return parse_error();
+
+      if (mapped_wave.audio_index != MAPPED_NO_AUDIO)
+        {
+          if (mapped_wave.audio_index >= audios.size())
+            return parse_error();
+          wave.audio = audios[mapped_wave.audio_index];
+        }
+      waves.push_back (wave);
+    }
+
+  /* audio objects that are not referenced by any wave */
+  set<Audio *> used_audios;
+  for (const auto& wave : waves)
+    used_audios.insert (wave.audio);
+  for (auto audio : audios)
+    if (!used_audios.count (audio))
+      delete audio;
+
+  /* the audio objects point into the file data, so we keep it until clear() */
+  if (map_frames)
+    {
+      mapped_file = file;
+      mapped_data = std::move (file_data);
+    }
   return Error::Code::NONE;
 }
 
@@ -279,9 +842,162 @@ WavSet::clear()
 
   // now that everything has been delete-d, we can reset the waves vector
   waves.clear();
+
+  // no audio object points into the data of a mapped file anymore
+  mapped_file.reset();
+  mapped_data = vector<unsigned char>();
 }
 
 WavSet::~WavSet()
 {
   clear();
 }
+
+/**
+ * Loads the frames of lazily loaded audio objects that were requested during
+ * playback (not rt safe).
+ *
+ * \returns true if frames were loaded
+ */
+bool
+WavSet::load_requested_frames()
+{
+  bool loaded = false;
+
+  for (auto& wave : waves)
+    {
+      Audio *audio = wave.audio;
+      if (audio && audio->lazy_frames_wanted())
+        {
+          /* after errors, lazy_frames_wanted() returns false, so we don't retry */
+          Error error = audio->load_lazy_frames();
+          if (error)
+            fprintf (stderr, "wavset: error loading frames from %s: %s\n", audio->lazy_frames->filename.c_str(), error.message());
+          loaded = true;
+        }
+    }
+  return loaded;
+}
+
+/**
+ * Sets the number of frames that are loaded ahead of the playback position for
+ * lazily loaded audio objects (the default is the number of frames loaded initially).
+ * This needs to be called before the wav set is used for playback.
+ */
+void
+WavSet::set_lazy_load_lookahead (size_t frames)
+{
+  for (auto& wave : waves)
+    {
+      if (wave.audio && wave.audio->lazy_frames)
+        wave.audio->lazy_frames->lookahead = frames;
+    }
+}
+
+/**
+ * Streams the frames of long waves without loop (more than min_frames frames)
+ * from the file, instead of keeping them in memory (see AudioStream). Only the
+ * head frames stay in the Audio objects of these waves. Each streamed wave starts
+ * with n_readers readers, so this many voices can play it at the same time; if
+ * more voices play it, the AudioStreamer thread adds readers to the pool.
+ *
+ * This needs to be called after loading from filename, before the wav set is
+ * used for playback; waves that can't be streamed (for instance because of
+ * compressed frames) are kept in memory.
+ */
+void
+WavSet::open_streams (const string& filename, size_t min_frames, size_t n_readers)
+{
+  if (is_mapped_file (filename))
+    return;
+
+  /* each Audio is stored once in the file (as blob), in the order of the waves */
+  map<Audio *, int>          blob_index;
+  map<Audio *, WavSetWave *> streamed;
+  for (auto& wave : waves)
+    {
+      Audio *audio = wave.audio;
+      if (!audio)
+        continue;
+
+      if (!blob_index.count (audio))
+        {
+          const int index = blob_index.size();
+          blob_index[audio] = index;
+
+          if (audio->loop_type != Audio::LOOP_NONE || audio->contents.size() <= min_frames)
+            continue;
+
+          auto stream = std::make_shared<AudioStream>();
+          Error error = stream->open (filename, index);
+          if (error)
+            continue;
+
+          wave.stream = stream;
+          wave.stream_readers = std::make_shared<AudioStreamReaderPool> (stream, n_readers);
+          AudioStreamer::the()->add_pool (wave.stream_readers);
+
+          /* the frames after the head frames are only available through the stream */
+          audio->lazy_frames.reset();
+          audio->contents.assign (stream->audio()->contents.begin(), stream->audio()->contents.end());
+          audio->contents.shrink_to_fit();
+
+          streamed[audio] = &wave;
+        }
+      else if (streamed.count (audio))
+        {
+          /* waves sharing the same Audio also share the stream */
+          wave.stream = streamed[audio]->stream;
+          wave.stream_readers = streamed[audio]->stream_readers;
+        }
+    }
+}
+
+/**
+ * Decodes the frame data of all waves to float once (see AudioFloatCache); this
+ * should be called after the wav set contents are final.
+ */
+void
+WavSet::build_float_cache()
+{
+  for (auto& wave : waves)
+    {
+      /* lazily loaded frames are not final yet */
+      if (wave.audio && !wave.audio->float_cache && !wave.audio->lazy_frames)
+        wave.audio->build_float_cache();
+    }
+}
+
+size_t
+WavSet::float_cache_mem_usage() const
+{
+  set<Audio *> done; // same Audio can be used more than once
+
+  size_t mem_usage = 0;
+  for (const auto& wave : waves)
+    {
+      if (wave.audio && wave.audio->float_cache && done.insert (wave.audio).second)
+        mem_usage += wave.audio->float_cache->mem_usage();
+    }
+  return mem_usage;
+}
+
+size_t
+WavSet::mem_usage() const
+{
+  set<Audio *> done; // same Audio can be used more than once
+
+  size_t mem_usage = sizeof (WavSet) + waves.capacity() * sizeof (WavSetWave);
+  for (const auto& wave : waves)
+    {
+      if (wave.audio && done.insert (wave.audio).second)
+        {
+          mem_usage += wave.audio->mem_usage();
+          if (wave.stream)
+            mem_usage += wave.stream->mem_usage();
+        }
+    }
+  /* a file that is memory mapped is not counted, it only uses the page cache */
+  mem_usage += mapped_data.capacity();
+  return mem_usage;
+}
@@ -5,12 +5,16 @@
 
 #include <vector>
 #include <string>
+#include <memory>
 
 #include "smaudio.hh"
 
 namespace SpectMorph
 {
 
+class AudioStream;
+class AudioStreamReaderPool;
+
 class WavSetWave
 {
 public:
@@ -21,12 +25,21 @@ public:
   std::string path;
   Audio      *audio;
 
+  /* only set for waves that are streamed (see WavSet::open_streams) */
+  std::shared_ptr<AudioStream>           stream;
+  std::shared_ptr<AudioStreamReaderPool> stream_readers;
+
   WavSetWave();
   ~WavSetWave();
 };
 
 class WavSet
 {
+  /* data of a mapped file loaded with AUDIO_MAP_FRAMES, used by the audio objects */
+  GenericInP                 mapped_file;
+  std::vector<unsigned char> mapped_data; // only if the file could not be mapped
+
+  Error load_mapped (GenericInP file, bool map_frames);
 public:
   ~WavSet();
 
@@ -36,8 +49,20 @@ public:
 
   void clear();
 
-  Error load (const std::string& filename, AudioLoadOptions load_options = AUDIO_LOAD_DEBUG);
+  Error load (const std::string& filename, AudioLoadOptions load_options = AUDIO_LOAD_DEBUG, size_t lazy_load_frames = 0,
+              int n_threads = 1);
   Error save (const std::string& filename, bool embed_models = false);
+  Error save_mapped (const std::string& filename) const;
+
+  static bool is_mapped_file (const std::string& filename);
+
+  bool   load_requested_frames();
+  void   set_lazy_load_lookahead (size_t frames);
+  void   open_streams (const std::string& filename, size_t min_frames, size_t n_readers = 16);
+
+  void   build_float_cache();
+  size_t float_cache_mem_usage() const;
+  size_t mem_usage() const;
 };
 
 }
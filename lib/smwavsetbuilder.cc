@@ -5,6 +5,7 @@
 #include "smbinbuffer.hh"
 #include "sminstenccache.hh"
 #include "smaudiotool.hh"
+#include "smparallel.hh"
 
 #include <mutex>
 
@@ -71,35 +72,59 @@ WavSetBuilder::killed()
   return kill_function && kill_function();
 }
 
-WavSet *
-WavSetBuilder::run()
+Audio *
+WavSetBuilder::encode_sample (const SampleData& sd)
 {
-  for (auto& sd : sample_data_vec)
-    {
-      /* clipping */
-      const WavData& wav_data = sd.shared->wav_data();
-      assert (wav_data.n_channels() == 1);
+  /* clipping */
+  const WavData& wav_data = sd.shared->wav_data();
+  assert (wav_data.n_channels() == 1);
 
-      /* if we have a loop, the loop end determines the real end of the recording */
-      int iclipend = wav_data.n_values();
-      if (sd.loop == Sample::Loop::NONE)
-        iclipend = std::clamp<int> (sm_round_positive (sd.clip_end_ms * wav_data.mix_freq() / 1000.0), 0, wav_data.n_values());
+  /* if we have a loop, the loop end determines the real end of the recording */
+  int iclipend = wav_data.n_values();
+  if (sd.loop == Sample::Loop::NONE)
+    iclipend = std::clamp<int> (sm_round_positive (sd.clip_end_ms * wav_data.mix_freq() / 1000.0), 0, wav_data.n_values());
 
-      int iclipstart = std::clamp (sm_round_positive (sd.clip_start_ms * wav_data.mix_freq() / 1000.0), 0, iclipend);
+  int iclipstart = std::clamp (sm_round_positive (sd.clip_start_ms * wav_data.mix_freq() / 1000.0), 0, iclipend);
+
+  std::shared_ptr<const Audio> cached_audio = InstEncCache::the()->encode (cache_group, wav_data, sd.shared->wav_data_hash(), sd.midi_note,
+                                                                          iclipstart, iclipend, encoder_config, kill_function);
+  if (!cached_audio)
+    return nullptr;
+
+  /* the wav set owns its audio objects, and we change loop, volume and tuning afterwards */
+  Audio *audio = cached_audio->clone();
+  if (keep_samples)
+    audio->original_samples = wav_data.samples(); // FIXME: clipping?
+
+  return audio;
+}
 
+WavSet *
+WavSetBuilder::run()
+{
+  /* samples are independent, so they can be encoded concurrently; the post passes below
+   * need all waves, so they run after all samples are done
+   */
+  vector<std::unique_ptr<Audio>> audios (sample_data_vec.size());
+  sm_parallel_for (sample_data_vec.size(),
+    [&] (size_t i)
+      {
+        if (!killed())
+          audios[i].reset (encode_sample (sample_data_vec[i]));
+      },
+    n_threads);
+
+  for (size_t i = 0; i < sample_data_vec.size(); i++)
+    {
+      if (!audios[i]) // killed?
+        return nullptr;
 
       WavSetWave new_wave;
-      new_wave.midi_note = sd.midi_note;
+      new_wave.midi_note = sample_data_vec[i].midi_note;
       new_wave.channel = 0;
       new_wave.velocity_range_min = 0;
       new_wave.velocity_range_max = 127;
-      new_wave.audio = InstEncCache::the()->encode (cache_group, wav_data, sd.shared->wav_data_hash(), sd.midi_note, iclipstart, iclipend, encoder_config, kill_function);
-
-      if (!new_wave.audio) // killed?
-        return nullptr;
-
-      if (keep_samples)
-        new_wave.audio->original_samples = wav_data.samples(); // FIXME: clipping?
+      new_wave.audio = audios[i].release();
 
       wav_set->waves.push_back (new_wave);
     }
@@ -108,6 +133,9 @@ WavSetBuilder::run()
   apply_auto_volume();
   apply_auto_tune();
 
+  if (float_cache)
+    wav_set->build_float_cache();
+
   WavSet *result = wav_set;
   wav_set = nullptr;
 
@@ -261,3 +289,45 @@ WavSetBuilder::set_cache_group (InstEncCache::Group *group)
 {
   cache_group = group;
 }
+
+void
+WavSetBuilder::set_float_cache (bool new_float_cache)
+{
+  float_cache = new_float_cache;
+}
+
+void
+WavSetBuilder::set_n_threads (int new_n_threads)
+{
+  n_threads = new_n_threads;
+}
+
+string
+WavSetBuilder::content_hash() const
+{
+  /* list everything that affects the WavSet built by run(), so that equal
+   * hashes mean that the results of run() will be identical (see WavSetStore)
+   */
+  assert (wav_set); // needs to be called before run()
+
+  string depends;
+
+  depends += wav_set->name + "\n";
+  depends += wav_set->short_name + "\n";
+  depends += string_printf ("%.17g\n", global_volume);
+  depends += string_printf ("%d %d %.17g\n", auto_volume.enabled, auto_volume.method, auto_volume.gain);
+  depends += string_printf ("%d %d %d %.17g %.17g\n", auto_tune.enabled, auto_tune.method, auto_tune.partials, auto_tune.time, auto_tune.amount);
+  if (encoder_config.enabled)
+    {
+      for (const auto& entry : encoder_config.entries)
+        depends += entry.param + "=" + entry.value + "\n";
+    }
+  depends += string_printf ("%d %d\n", keep_samples, float_cache);
+  for (const auto& sd : sample_data_vec)
+    {
+      depends += sd.shared->wav_data_hash() + "\n";
+      depends += string_printf ("%d %.17g %d %.17g %.17g %.17g %.17g\n", sd.midi_note, sd.volume, int (sd.loop),
+                                sd.clip_start_ms, sd.clip_end_ms, sd.loop_start_ms, sd.loop_end_ms);
+    }
+  return sha1_hash (depends);
+}
@@ -36,6 +36,8 @@ class WavSetBuilder
   Instrument::AutoTune       auto_tune;
   Instrument::EncoderConfig  encoder_config;
   bool keep_samples;
+  bool float_cache = false;
+  int  n_threads = 1;
 
   void apply_loop_settings();
   void apply_volume_settings();
@@ -43,12 +45,16 @@ class WavSetBuilder
   void apply_auto_tune();
 
   void add_sample (const Sample *sample);
+  Audio *encode_sample (const SampleData& sd);
 public:
   WavSetBuilder (const Instrument *instrument, bool keep_samples);
   ~WavSetBuilder();
 
   void set_kill_function (const std::function<bool()>& kill_function);
   void set_cache_group (InstEncCache::Group *group);
+  void set_float_cache (bool float_cache);
+  void set_n_threads (int n_threads); // encode samples in parallel (0: one thread per cpu core)
+  std::string content_hash() const;
   WavSet *run();
 };
 
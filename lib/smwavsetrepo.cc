@@ -2,10 +2,15 @@
 
 #include "smwavsetrepo.hh"
 #include "smmain.hh"
+#include "smconfig.hh"
+#include "smwavsetstore.hh"
+
+#include <algorithm>
 
 using namespace SpectMorph;
 
 using std::string;
+using std::vector;
 
 WavSetRepo*
 WavSetRepo::the()
@@ -13,22 +18,201 @@ WavSetRepo::the()
   return Global::wav_set_repo();
 }
 
-WavSet*
+static string
+file_content_hash (const string& filename)
+{
+  GenericInP in = GenericIn::open (filename);
+  if (!in)
+    return "";
+
+  size_t remaining;
+  const unsigned char *mem = in->mmap_mem (remaining);
+  if (mem)
+    return sha1_hash (mem, remaining);
+
+  vector<unsigned char> data;
+  unsigned char buffer[64 * 1024];
+  int len;
+  while ((len = in->read (buffer, sizeof (buffer))) > 0)
+    data.insert (data.end(), buffer, buffer + len);
+
+  return sha1_hash (data.data(), data.size());
+}
+
+std::shared_ptr<WavSet>
 WavSetRepo::get (const string& filename)
 {
-  std::lock_guard<std::mutex> lock (mutex);
+  {
+    std::lock_guard<std::mutex> lock (mutex);
+
+    auto it = wav_set_map.find (filename);
+    if (it != wav_set_map.end())
+      {
+        Entry& entry = it->second;
+        entry.last_use = use_counter++;
+        entry.hits++;
+        hits++;
+        return entry.wav_set;
+      }
+  }
+
+  /* hashing and loading the file is slow, so we don't hold the lock while doing it:
+   * other threads can still get WavSets that are already loaded
+   */
+  Config cfg;
+
+  /* identical files (for instance copies of the same instrument) share one WavSet */
+  const string hash = file_content_hash (filename);
+  const string key = "smset:" + hash;
+
+  std::shared_ptr<WavSet> wav_set;
+  if (!hash.empty())
+    wav_set = WavSetStore::the()->lookup (key);
 
-  WavSet*& wav_set = wav_set_map[filename];
   if (!wav_set)
     {
-      wav_set = new WavSet();
-      wav_set->load (filename, AUDIO_SKIP_DEBUG);
+      WavSet *new_wav_set = new WavSet();
+      new_wav_set->load (filename, AUDIO_MAP_FRAMES, std::max (cfg.lazy_load_frames(), 0), /* n_threads: one per core */ 0);
+      if (cfg.stream_frames() > 0)
+        new_wav_set->open_streams (filename, cfg.stream_frames());
+      if (cfg.lazy_load_lookahead() > 0)
+        new_wav_set->set_lazy_load_lookahead (cfg.lazy_load_lookahead());
+
+      if (cfg.float_frame_cache())
+        new_wav_set->build_float_cache();
+
+      if (!hash.empty())
+        wav_set = WavSetStore::the()->insert (key, new_wav_set);
+      else
+        wav_set.reset (new_wav_set);
+    }
+
+  std::lock_guard<std::mutex> lock (mutex);
+
+  misses++;
+
+  /* if another thread loaded the same file in the meantime, use its WavSet */
+  Entry& entry = wav_set_map[filename];
+  if (!entry.wav_set)
+    {
+      entry.wav_set = wav_set;
+      entry.mem_usage = wav_set->mem_usage();
+    }
+  entry.last_use = use_counter++;
+
+  if (cfg.lazy_load_frames() > 0 && !loader_thread.joinable())
+    loader_thread = std::thread (&WavSetRepo::loader_thread_main, this);
+
+  mem_budget = size_t (std::max (cfg.wav_set_repo_mb(), 0)) * 1024 * 1024;
+
+  std::shared_ptr<WavSet> result = entry.wav_set; // pin before evicting
+  evict_L (filename);
+
+  return result;
+}
+
+void
+WavSetRepo::evict_L (const string& keep_filename)
+{
+  if (!mem_budget)
+    return;
+
+  size_t mem_usage = 0;
+  for (const auto& [filename, entry] : wav_set_map)
+    mem_usage += entry.mem_usage;
+
+  while (mem_usage > mem_budget)
+    {
+      /* find least recently used WavSet which is not pinned */
+      auto lru = wav_set_map.end();
+      for (auto it = wav_set_map.begin(); it != wav_set_map.end(); it++)
+        {
+          if (it->first != keep_filename && it->second.wav_set.use_count() == 1)
+            {
+              if (lru == wav_set_map.end() || it->second.last_use < lru->second.last_use)
+                lru = it;
+            }
+        }
+      if (lru == wav_set_map.end()) // all remaining WavSets are in use
+        return;
+
+      mem_usage -= lru->second.mem_usage;
+      wav_set_map.erase (lru);
+      evictions++;
+    }
+}
+
+WavSetRepo::Stats
+WavSetRepo::stats()
+{
+  std::lock_guard<std::mutex> lock (mutex);
+
+  Stats stats;
+  stats.hits       = hits;
+  stats.misses     = misses;
+  stats.evictions  = evictions;
+  stats.mem_budget = mem_budget;
+
+  vector<std::pair<uint64, WavSetInfo>> infos;
+  for (const auto& [filename, entry] : wav_set_map)
+    {
+      WavSetInfo info;
+      info.filename  = filename;
+      info.mem_usage = entry.mem_usage;
+      info.hits      = entry.hits;
+      info.pinned    = entry.wav_set.use_count() > 1;
+
+      stats.mem_usage += entry.mem_usage;
+      infos.emplace_back (entry.last_use, info);
+    }
+  std::sort (infos.begin(), infos.end(), [] (const auto& a, const auto& b) { return a.first < b.first; });
+  for (const auto& [last_use, info] : infos)
+    stats.wav_sets.push_back (info);
+
+  return stats;
+}
+
+void
+WavSetRepo::loader_thread_main()
+{
+  while (!loader_quit.load())
+    {
+      vector<std::pair<string, std::shared_ptr<WavSet>>> wav_sets;
+      {
+        std::lock_guard<std::mutex> lock (mutex);
+        for (const auto& [filename, entry] : wav_set_map)
+          wav_sets.emplace_back (filename, entry.wav_set);
+      }
+
+      /* frames are requested from the audio thread (playback position), so we need to poll */
+      bool loaded = false;
+      for (const auto& [filename, wav_set] : wav_sets)
+        {
+          if (wav_set->load_requested_frames())
+            {
+              /* we are the only thread that modifies the frames, so this is race free */
+              const size_t mem_usage = wav_set->mem_usage();
+
+              std::lock_guard<std::mutex> lock (mutex);
+              auto it = wav_set_map.find (filename);
+              if (it != wav_set_map.end() && it->second.wav_set == wav_set)
+                it->second.mem_usage = mem_usage;
+              evict_L ("");
+
+              loaded = true;
+            }
+        }
+
+      if (!loaded)
+        std::this_thread::sleep_for (std::chrono::milliseconds (5));
     }
-  return wav_set;
 }
 
 WavSetRepo::~WavSetRepo()
 {
-  for (auto w : wav_set_map)
-    delete w.second;
+  if (loader_thread.joinable())
+    {
+      loader_quit.store (true);
+      loader_thread.join();
+    }
 }
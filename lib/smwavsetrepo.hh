@@ -6,19 +6,70 @@
 #include "smwavset.hh"
 
 #include <mutex>
+#include <thread>
+#include <atomic>
+#include <memory>
 
 #include <unordered_map>
 
 namespace SpectMorph
 {
 
+/*
+ * Cache for WavSets loaded from files
+ *
+ * The shared pointer returned by get() pins the WavSet: as long as someone
+ * (for instance the config of an active morph plan) holds a reference, it
+ * will not be evicted. If a memory budget is configured (wav_set_repo_mb),
+ * unpinned WavSets are evicted in least recently used order once the total
+ * memory usage exceeds the budget.
+ */
 class WavSetRepo {
+public:
+  struct WavSetInfo
+  {
+    std::string filename;
+    size_t      mem_usage = 0;
+    uint64      hits = 0;
+    bool        pinned = false;
+  };
+  struct Stats
+  {
+    uint64                  hits = 0;
+    uint64                  misses = 0;
+    uint64                  evictions = 0;
+    size_t                  mem_usage = 0;
+    size_t                  mem_budget = 0; // 0 means unlimited
+    std::vector<WavSetInfo> wav_sets;       // least recently used first
+  };
+private:
+  struct Entry
+  {
+    std::shared_ptr<WavSet> wav_set;
+    size_t                  mem_usage = 0;
+    uint64                  last_use = 0;
+    uint64                  hits = 0;
+  };
   std::mutex mutex;
-  std::unordered_map<std::string, WavSet *> wav_set_map;
+  std::unordered_map<std::string, Entry> wav_set_map;
+
+  uint64     use_counter = 0;
+  uint64     hits = 0;
+  uint64     misses = 0;
+  uint64     evictions = 0;
+  size_t     mem_budget = 0;
+
+  /* loads frames of lazily loaded wav sets on demand */
+  std::thread       loader_thread;
+  std::atomic<bool> loader_quit { false };
+
+  void loader_thread_main();
+  void evict_L (const std::string& keep_filename);
 public:
   ~WavSetRepo();
 
-  WavSet *get (const std::string& filename);
+  std::shared_ptr<WavSet> get (const std::string& filename);
+  Stats                   stats();
 
   static WavSetRepo *the(); // Singleton
 };
@@ -0,0 +1,68 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smwavsetstore.hh"
+#include "smmain.hh"
+
+using namespace SpectMorph;
+
+using std::string;
+
+WavSetStore*
+WavSetStore::the()
+{
+  return Global::wav_set_store();
+}
+
+void
+WavSetStore::remove_expired_L()
+{
+  for (auto it = wav_set_map.begin(); it != wav_set_map.end();)
+    {
+      if (it->second.expired())
+        it = wav_set_map.erase (it);
+      else
+        it++;
+    }
+}
+
+std::shared_ptr<WavSet>
+WavSetStore::lookup (const string& key)
+{
+  std::lock_guard<std::mutex> lock (mutex);
+
+  auto it = wav_set_map.find (key);
+  if (it != wav_set_map.end())
+    return it->second.lock(); // nullptr if expired
+
+  return nullptr;
+}
+
+std::shared_ptr<WavSet>
+WavSetStore::insert (const string& key, WavSet *take_wav_set)
+{
+  std::unique_ptr<WavSet> wav_set (take_wav_set);
+  std::lock_guard<std::mutex> lock (mutex);
+
+  remove_expired_L();
+
+  /* if another thread created a WavSet with the same content in the meantime,
+   * use the existing one and free ours
+   */
+  std::weak_ptr<WavSet>& entry = wav_set_map[key];
+  std::shared_ptr<WavSet> result = entry.lock();
+  if (!result)
+    {
+      result = std::shared_ptr<WavSet> (wav_set.release());
+      entry = result;
+    }
+  return result;
+}
+
+size_t
+WavSetStore::size()
+{
+  std::lock_guard<std::mutex> lock (mutex);
+
+  remove_expired_L();
+  return wav_set_map.size();
+}
@@ -0,0 +1,39 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#ifndef SPECTMORPH_WAVSET_STORE_HH
+#define SPECTMORPH_WAVSET_STORE_HH
+
+#include "smwavset.hh"
+
+#include <mutex>
+#include <memory>
+#include <map>
+
+namespace SpectMorph
+{
+
+/*
+ * Process wide store for read-only WavSets, indexed by a hash of their content
+ *
+ * Different users (projects / plugin instances, WavSetRepo) that need a WavSet
+ * with the same content get the same (shared) object, instead of each user
+ * holding its own copy of identical Audio data. The store only keeps weak
+ * references, so a WavSet is freed as soon as the last user releases it.
+ */
+class WavSetStore
+{
+  std::mutex                                    mutex;
+  std::map<std::string, std::weak_ptr<WavSet>> wav_set_map;
+
+  void remove_expired_L();
+public:
+  std::shared_ptr<WavSet> lookup (const std::string& key);
+  std::shared_ptr<WavSet> insert (const std::string& key, WavSet *take_wav_set);
+  size_t                  size();
+
+  static WavSetStore *the(); // Singleton
+};
+
+}
+
+#endif
@@ -39,6 +39,7 @@
 #define SPECTMORPH_UI_URI   SPECTMORPH_URI "#ui"
 
 #define SPECTMORPH__plan    SPECTMORPH_URI "#plan"
+#define SPECTMORPH__plan_data SPECTMORPH_URI "#plan_data"
 #define SPECTMORPH__volume  SPECTMORPH_URI "#volume"
 
 #ifndef LV2_STATE__StateChanged
@@ -56,6 +57,7 @@ public:
     LV2_URID atom_URID;
     LV2_URID atom_Blank;
     LV2_URID atom_Bool;
+    LV2_URID atom_Chunk;
     LV2_URID atom_Double;
     LV2_URID atom_Float;
     LV2_URID atom_Int;
@@ -64,6 +66,7 @@ public:
     LV2_URID atom_String;
     LV2_URID midi_MidiEvent;
     LV2_URID spectmorph_plan;
+    LV2_URID spectmorph_plan_data;
     LV2_URID spectmorph_volume;
     LV2_URID state_StateChanged;
     LV2_URID time_bar;
@@ -85,6 +88,7 @@ public:
     uris.atom_URID          = map->map (map->handle, LV2_ATOM__URID);
     uris.atom_Blank         = map->map (map->handle, LV2_ATOM__Blank);
     uris.atom_Bool          = map->map (map->handle, LV2_ATOM__Bool);
+    uris.atom_Chunk         = map->map (map->handle, LV2_ATOM__Chunk);
     uris.atom_Double        = map->map (map->handle, LV2_ATOM__Double);
     uris.atom_Float         = map->map (map->handle, LV2_ATOM__Float);
     uris.atom_Int           = map->map (map->handle, LV2_ATOM__Int);
@@ -93,6 +97,7 @@ public:
     uris.atom_String        = map->map (map->handle, LV2_ATOM__String);
     uris.midi_MidiEvent     = map->map (map->handle, LV2_MIDI__MidiEvent);
     uris.spectmorph_plan    = map->map (map->handle, SPECTMORPH__plan);
+    uris.spectmorph_plan_data = map->map (map->handle, SPECTMORPH__plan_data);
     uris.spectmorph_volume  = map->map (map->handle, SPECTMORPH__volume);
     uris.state_StateChanged = map->map (map->handle, LV2_STATE__StateChanged);
     uris.time_bar           = map->map (map->handle, LV2_TIME__bar);
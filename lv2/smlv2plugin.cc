@@ -340,14 +340,15 @@ save(LV2_Handle                instance,
    *  -> ignore state changed events during save
    */
   self->project.set_state_changed_notify (false);
-  string plan_str = self->project.save_plan_lv2 (abstract_path);
+  vector<unsigned char> plan_data = self->project.save_plan_lv2_binary (abstract_path);
   self->project.set_state_changed_notify (true);
 
+  /* binary plan (the plan file format is endian independent), older versions used a hex string */
   store (handle,
-         self->uris.spectmorph_plan,
-         plan_str.c_str(),
-         plan_str.size() + 1,
-         self->uris.atom_String,
+         self->uris.spectmorph_plan_data,
+         plan_data.data(),
+         plan_data.size(),
+         self->uris.atom_Chunk,
          LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
 
   float f_volume = self->project.volume();
@@ -356,7 +357,7 @@ save(LV2_Handle                instance,
          self->uris.atom_Float,
          LV2_STATE_IS_POD);
 
-  LV2_DEBUG ("state save called: %s\nstate volume: %f\n", plan_str.c_str(), f_volume);
+  LV2_DEBUG ("state save called: %zd bytes plan\nstate volume: %f\n", plan_data.size(), f_volume);
   return LV2_STATE_SUCCESS;
 }
 
@@ -426,8 +427,14 @@ restore(LV2_Handle                  instance,
   /* state changed notifications should not be sent if state was changed due to restore */
   self->project.set_state_changed_notify (false);
 
-  value = retrieve (handle, self->uris.spectmorph_plan, &size, &type, &valflags);
-  if (value && type == self->uris.atom_String)
+  value = retrieve (handle, self->uris.spectmorph_plan_data, &size, &type, &valflags);
+  if (value && type == self->uris.atom_Chunk)
+    {
+      LV2_DEBUG (" -> plan_data: %zd bytes\n", size);
+
+      self->project.load_plan_lv2_binary (absolute_path, (const unsigned char *) value, size);
+    }
+  else if ((value = retrieve (handle, self->uris.spectmorph_plan, &size, &type, &valflags)) && type == self->uris.atom_String)
     {
       const char *plan_str = (const char *)value;
       LV2_DEBUG (" -> plan_str: %s\n", plan_str);
@@ -73,6 +73,7 @@ struct Options
   bool          track_sines;
   float         fundamental_freq;
   int           optimization_level;
+  int           n_threads;
   double        loop_start;
   double        loop_end;
   Audio::LoopType loop_type;
@@ -93,6 +94,7 @@ Options::Options ()
   program_name = "smenc";
   fundamental_freq = 0; // unset
   optimization_level = 0;
+  n_threads = 1;
   strip_models = false;
   keep_samples = false;
   track_sines = true;   // perform peak tracking to find sine components
@@ -162,6 +164,10 @@ Options::parse (int   *argc_p,
         {
           optimization_level = atoi (opt_arg);
         }
+      else if (check_arg (argc, argv, &i, "-j", &opt_arg))
+        {
+          n_threads = atoi (opt_arg);
+        }
       else if (check_arg (argc, argv, &i, "-s"))
         {
           strip_models = true;
@@ -241,6 +247,7 @@ Options::print_usage ()
   sm_printf (" -f <freq>                   specify fundamental frequency in Hz\n");
   sm_printf (" -m <note>                   specify midi note for fundamental frequency\n");
   sm_printf (" -O <level>                  set optimization level\n");
+  sm_printf (" -j <threads>                number of encoder threads (0: one per cpu core)\n");
   sm_printf (" -s                          produced stripped models\n");
   sm_printf (" --no-attack                 skip attack time optimization\n");
   sm_printf (" --no-sines                  skip partial tracking\n");
@@ -466,6 +473,7 @@ main (int argc, char **argv)
         }
 
       Encoder encoder (enc_params);
+      encoder.set_n_threads (options.n_threads);
       encoder.encode (wav_data, channel, options.optimization_level, options.attack, options.track_sines);
       if (options.strip_models)
         {
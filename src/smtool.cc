@@ -12,6 +12,9 @@
 #include "smutils.hh"
 #include "smfft.hh"
 #include "smaudiotool.hh"
+#include "smwavsetrepo.hh"
+
+#include <inttypes.h>
 
 using namespace SpectMorph;
 using std::vector;
@@ -214,6 +217,7 @@ compute_energy (const Audio& audio, double percent, bool from_loop)
 class Command
 {
   string            m_mode;
+  string            m_filename;
   bool              m_need_save;
   const WavSetWave *m_wave;
 public:
@@ -231,6 +235,12 @@ public:
     return args.size() == 0;
   }
   virtual bool exec (Audio& audio) = 0;
+  /* commands that operate on the whole wav set return true here (exec is not called then) */
+  virtual bool
+  exec_wav_set (WavSet& wav_set)
+  {
+    return false;
+  }
   virtual void usage (bool one_line)
   {
     printf ("\n");
@@ -242,6 +252,16 @@ public:
   {
     return m_mode;
   }
+  string
+  filename() const
+  {
+    return m_filename;
+  }
+  void
+  set_filename (const string& filename)
+  {
+    m_filename = filename;
+  }
   bool
   need_save() const
   {
@@ -436,6 +456,10 @@ public:
 
     size_t total_bytes = (freq_bytes + mag_bytes + phase_bytes + noise_bytes);
     sm_printf ("data rate    : %.2f K/s\n", total_bytes / 1024.0 / (audio.sample_count / audio.mix_freq));
+
+    /* additional memory required if frames are decoded once during load (float_frame_cache) */
+    AudioFloatCache float_cache (audio);
+    sm_printf ("float_cache  : %zd bytes\n", float_cache.mem_usage());
     return true;
   }
 } size_command;
@@ -1181,6 +1205,41 @@ public:
   }
 } strip_all_command;
 
+class CompressFramesCommand : public Command
+{
+  bool compress = true;
+public:
+  CompressFramesCommand() : Command ("compress-frames")
+  {
+    set_need_save (true);
+  }
+  bool
+  parse_args (vector<string>& args)
+  {
+    if (args.size() == 0)
+      return true;
+
+    if (args.size() == 1 && (args[0] == "on" || args[0] == "off"))
+      {
+        compress = (args[0] == "on");
+        return true;
+      }
+    return false;
+  }
+  bool
+  exec (Audio& audio)
+  {
+    /* frames with debug information (original_fft, debug_samples) are saved uncompressed */
+    audio.compress_frames = compress;
+    return true;
+  }
+  void
+  usage (bool one_line)
+  {
+    printf ("[on|off]\n");
+  }
+} compress_frames_command;
+
 class ExtractSMCommand : public Command
 {
   int note;
@@ -1218,6 +1277,136 @@ public:
   }
 } extract_sm_command;
 
+class SaveMappedCommand : public Command
+{
+  string filename;
+public:
+  SaveMappedCommand() : Command ("save-mapped")
+  {
+  }
+  bool
+  parse_args (vector<string>& args)
+  {
+    if (args.size() == 1)
+      {
+        filename = args[0];
+        return true;
+      }
+    return false;
+  }
+  void
+  usage (bool one_line)
+  {
+    printf ("<mapped_smset_filename>\n");
+  }
+  bool
+  exec (Audio& audio)
+  {
+    fprintf (stderr, "smtool: save-mapped only supports wav sets\n");
+    exit (1);
+  }
+  bool
+  exec_wav_set (WavSet& wav_set)
+  {
+    Error error = wav_set.save_mapped (filename);
+    if (error)
+      {
+        fprintf (stderr, "smtool: error saving mapped file %s: %s\n", filename.c_str(), error.message());
+        exit (1);
+      }
+    return true;
+  }
+} save_mapped_command;
+
+class SaveTaggedCommand : public Command
+{
+  string filename;
+public:
+  SaveTaggedCommand() : Command ("save-tagged")
+  {
+  }
+  bool
+  parse_args (vector<string>& args)
+  {
+    if (args.size() == 1)
+      {
+        filename = args[0];
+        return true;
+      }
+    return false;
+  }
+  void
+  usage (bool one_line)
+  {
+    printf ("<smset_filename>\n");
+  }
+  bool
+  exec (Audio& audio)
+  {
+    fprintf (stderr, "smtool: save-tagged only supports wav sets\n");
+    exit (1);
+  }
+  bool
+  exec_wav_set (WavSet& wav_set)
+  {
+    Error error = wav_set.save (filename);
+    if (error)
+      {
+        fprintf (stderr, "smtool: error saving file %s: %s\n", filename.c_str(), error.message());
+        exit (1);
+      }
+    return true;
+  }
+} save_tagged_command;
+
+class RepoStatsCommand : public Command
+{
+  vector<string> filenames;
+public:
+  RepoStatsCommand() : Command ("repo-stats")
+  {
+  }
+  bool
+  parse_args (vector<string>& args)
+  {
+    filenames = args;
+    return true;
+  }
+  void
+  usage (bool one_line)
+  {
+    printf ("[ <smset_filename>... ]\n");
+  }
+  bool
+  exec (Audio& audio)
+  {
+    fprintf (stderr, "smtool: repo-stats only supports wav sets\n");
+    exit (1);
+  }
+  bool
+  exec_wav_set (WavSet& wav_set)
+  {
+    /* load all files through the repo (like the morph plan would do), using the memory budget from the config */
+    WavSetRepo::the()->get (filename());
+    for (auto f : filenames)
+      WavSetRepo::the()->get (f);
+
+    WavSetRepo::Stats stats = WavSetRepo::the()->stats();
+    sm_printf ("hits         : %" PRIu64 "\n", stats.hits);
+    sm_printf ("misses       : %" PRIu64 "\n", stats.misses);
+    sm_printf ("evictions    : %" PRIu64 "\n", stats.evictions);
+    sm_printf ("mem_usage    : %zd bytes\n", stats.mem_usage);
+    if (stats.mem_budget)
+      sm_printf ("mem_budget   : %zd bytes\n", stats.mem_budget);
+    else
+      sm_printf ("mem_budget   : unlimited\n");
+
+    for (const auto& info : stats.wav_sets)
+      sm_printf ("%12zd bytes %6" PRIu64 " hits %s %s\n", info.mem_usage, info.hits, info.pinned ? "pinned" : "      ", info.filename.c_str());
+    return true;
+  }
+} repo_stats_command;
+
 int
 main (int argc, char **argv)
 {
@@ -1240,14 +1429,19 @@ main (int argc, char **argv)
   const string& mode = argv[2];
 
   /* figure out file type (we support SpectMorph::WavSet and SpectMorph::Audio) */
-  InFile *file = new InFile (argv[1]);
-  if (!file->open_ok())
+  const bool mapped = WavSet::is_mapped_file (argv[1]);
+  string file_type = "SpectMorph::WavSet";
+  if (!mapped)
     {
-      fprintf (stderr, "%s: can't open input file: %s\n", argv[0], argv[1]);
-      exit (1);
+      InFile *file = new InFile (argv[1]);
+      if (!file->open_ok())
+        {
+          fprintf (stderr, "%s: can't open input file: %s\n", argv[0], argv[1]);
+          exit (1);
+        }
+      file_type = file->file_type();
+      delete file;
     }
-  string file_type = file->file_type();
-  delete file;
 
   Audio *audio = NULL;
   WavSet *wav_set = NULL;
@@ -1287,6 +1481,7 @@ main (int argc, char **argv)
           assert (!found_command);
           found_command = true;
 
+          cmd->set_filename (argv[1]);
           if (!cmd->parse_args (args))
             {
               printf ("usage: smtool <sm_file> %s ", cmd->mode().c_str());
@@ -1295,7 +1490,7 @@ main (int argc, char **argv)
             }
           if (audio)
             cmd->exec (*audio);
-          if (wav_set)
+          if (wav_set && !cmd->exec_wav_set (*wav_set))
             {
               set<Audio *> done;
 
@@ -1337,7 +1532,8 @@ main (int argc, char **argv)
         }
       if (wav_set)
         {
-          Error error = wav_set->save (argv[1]);
+          /* keep file format */
+          Error error = mapped ? wav_set->save_mapped (argv[1]) : wav_set->save (argv[1]);
           if (error)
             {
               fprintf (stderr, "error saving wavset file: %s\n", argv[1]);
@@ -683,6 +683,7 @@ main (int argc, char **argv)
         }
 
       WavSetBuilder builder (&inst, /* keep_samples */ false);
+      builder.set_n_threads (0);
       std::unique_ptr<WavSet> smset (builder.run());
       assert (smset);
 
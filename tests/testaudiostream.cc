@@ -0,0 +1,278 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "smaudiostream.hh"
+#include "smwavset.hh"
+#include "smmorphsourcemodule.hh"
+#include "smrandom.hh"
+
+#include <stdio.h>
+#include <assert.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <thread>
+
+using namespace SpectMorph;
+
+using std::vector;
+using std::string;
+
+static Audio *
+random_audio (Random& random, int frames)
+{
+  Audio *audio = new Audio();
+
+  audio->mix_freq = 48000;
+  audio->frame_size_ms = 40;
+  audio->frame_step_ms = 10;
+  audio->fundamental_freq = 440;
+  audio->zeropad = 4;
+  audio->loop_type = Audio::LOOP_NONE;
+  audio->sample_count = frames * 480;
+
+  for (int f = 0; f < frames; f++)
+    {
+      AudioBlock block;
+      size_t n_partials = random.random_uint32() % 100;
+
+      for (size_t p = 0; p < n_partials; p++)
+        {
+          block.freqs.push_back (random.random_uint32() & 0xffff);
+          block.mags.push_back (random.random_uint32() & 0xffff);
+          block.phases.push_back (random.random_uint32() & 0xffff);
+        }
+      for (size_t i = 0; i < Audio::N_NOISE_BANDS; i++)
+        block.noise.push_back (random.random_uint32() & 0xffff);
+      std::sort (block.freqs.begin(), block.freqs.end());
+
+      block.env_f0 = random.random_double_range (0.5, 2);
+      audio->contents.push_back (block);
+    }
+  return audio;
+}
+
+static bool
+same_block (const RTAudioBlock& rt_block, const AudioBlock& block)
+{
+  if (rt_block.freqs.size() != block.freqs.size() || rt_block.noise.size() != block.noise.size())
+    return false;
+
+  for (size_t i = 0; i < block.freqs.size(); i++)
+    if (rt_block.freqs[i] != block.freqs[i] || rt_block.mags[i] != block.mags[i])
+      return false;
+
+  for (size_t i = 0; i < block.noise.size(); i++)
+    if (rt_block.noise[i] != block.noise[i])
+      return false;
+
+  return true;
+}
+
+static void
+test_stream (const Audio *audio, const string& filename, int blob_index)
+{
+  const size_t HEAD = 100;
+
+  auto stream = std::make_shared<AudioStream>();
+  Error error = stream->open (filename, blob_index, HEAD);
+  assert (!error);
+  assert (stream->n_frames() == audio->contents.size());
+  assert (stream->head_frames() == HEAD);
+  assert (stream->audio()->mix_freq == audio->mix_freq);
+  assert (stream->audio()->sample_count == audio->sample_count);
+
+  /* all frames can be read, also out of order */
+  AudioBlock block;
+  for (size_t f = audio->contents.size(); f-- > 0;)
+    {
+      assert (stream->read_frame (f, block));
+      assert (block.freqs == audio->contents[f].freqs);
+      assert (block.mags == audio->contents[f].mags);
+      assert (block.phases == audio->contents[f].phases);
+      assert (block.noise == audio->contents[f].noise);
+      assert (block.env_f0 == audio->contents[f].env_f0);
+    }
+
+  RTMemoryArea rt_memory_area;
+
+  /* synchronous filling: no underruns */
+  AudioStreamSource source (stream, false);
+  for (int rep = 0; rep < 2; rep++)
+    {
+      source.retrigger (0, 440, 100);
+      for (size_t f = 0; f < audio->contents.size(); f++)
+        {
+          source.reader()->fill();
+
+          RTAudioBlock rt_block (&rt_memory_area);
+          assert (source.rt_audio_block (f, rt_block));
+          assert (same_block (rt_block, audio->contents[f]));
+          rt_memory_area.free_all();
+        }
+      RTAudioBlock rt_block (&rt_memory_area);
+      assert (!source.rt_audio_block (audio->contents.size(), rt_block));
+    }
+  assert (source.reader()->underruns() == 0);
+
+  /* playback moves backwards: released frames are not used, but the last head frame */
+  source.retrigger (0, 440, 100);
+  for (size_t f = 0; f < HEAD + 50; f++)
+    {
+      source.reader()->fill();
+
+      RTAudioBlock rt_block (&rt_memory_area);
+      assert (source.rt_audio_block (f, rt_block));
+      rt_memory_area.free_all();
+    }
+  for (size_t f = 0; f < 2000; f++)
+    source.reader()->fill();
+  {
+    RTAudioBlock rt_block (&rt_memory_area);
+    assert (source.rt_audio_block (HEAD + 10, rt_block));
+    assert (same_block (rt_block, audio->contents[HEAD - 1]));
+    rt_memory_area.free_all();
+  }
+  assert (source.reader()->underruns() == 0);
+
+  /* underrun: last available frame is used */
+  source.retrigger (0, 440, 100);
+  RTAudioBlock rt_block (&rt_memory_area);
+  assert (source.rt_audio_block (HEAD + 10, rt_block));
+  assert (same_block (rt_block, audio->contents[HEAD - 1]));
+  assert (source.reader()->underruns() == 1);
+  rt_memory_area.free_all();
+
+  /* background thread */
+  AudioStreamSource thread_source (stream);
+  thread_source.retrigger (0, 440, 100);
+  for (size_t f = 0; f < audio->contents.size(); f++)
+    {
+      for (int timeout = 0; ; timeout++)
+        {
+          RTAudioBlock rt_block (&rt_memory_area);
+          assert (thread_source.rt_audio_block (f, rt_block));
+          bool ok = same_block (rt_block, audio->contents[f]);
+          rt_memory_area.free_all();
+
+          if (ok)
+            break;
+
+          assert (timeout < 10000);
+          std::this_thread::sleep_for (std::chrono::microseconds (100));
+        }
+    }
+}
+
+static void
+play_source (LiveDecoderSource& source, const Audio *audio, size_t n_frames)
+{
+  RTMemoryArea rt_memory_area;
+
+  source.retrigger (0, 440, 100);
+  for (size_t f = 0; f < n_frames; f++)
+    {
+      for (int timeout = 0; ; timeout++)
+        {
+          RTAudioBlock rt_block (&rt_memory_area);
+          assert (source.rt_audio_block (f, rt_block));
+          bool ok = same_block (rt_block, audio->contents[f]);
+          rt_memory_area.free_all();
+
+          if (ok)
+            break;
+
+          assert (timeout < 10000);
+          std::this_thread::sleep_for (std::chrono::microseconds (100));
+        }
+    }
+  RTAudioBlock rt_block (&rt_memory_area);
+  assert (!source.rt_audio_block (n_frames, rt_block));
+}
+
+static void
+test_wav_set_streams (const WavSet& ref_wav_set, const string& filename)
+{
+  WavSet wav_set;
+  Error error = wav_set.load (filename, AUDIO_SKIP_DEBUG);
+  assert (!error);
+  wav_set.waves[0].audio->fundamental_freq = 220; // so that the sources play the second wave
+
+  /* only the longer wave is streamed */
+  const size_t n_frames = ref_wav_set.waves[1].audio->contents.size();
+  wav_set.open_streams (filename, n_frames - 1, 2);
+  assert (!wav_set.waves[0].stream);
+  assert (wav_set.waves[1].stream && wav_set.waves[1].stream_readers->n_readers() == 2);
+  assert (wav_set.waves[1].audio->contents.size() == AudioStream::DEFAULT_HEAD_FRAMES);
+
+  /* two voices can stream at the same time */
+  SimpleWavSetSource source1, source2, source3;
+  for (auto source : { &source1, &source2, &source3 })
+    source->set_wav_set (&wav_set);
+
+  play_source (source1, ref_wav_set.waves[1].audio, n_frames);
+  play_source (source2, ref_wav_set.waves[1].audio, n_frames);
+
+  /* no reader left: the voice holds the last head frame until the pool has grown */
+  source3.retrigger (0, 440, 100);
+
+  RTMemoryArea rt_memory_area;
+  RTAudioBlock rt_block (&rt_memory_area);
+  assert (source3.rt_audio_block (AudioStream::DEFAULT_HEAD_FRAMES, rt_block));
+  rt_memory_area.free_all();
+
+  play_source (source3, ref_wav_set.waves[1].audio, n_frames);
+  assert (wav_set.waves[1].stream_readers->n_readers() > 2);
+
+  /* reader is available again after the wav set of a source changes */
+  source1.set_wav_set (nullptr);
+
+  SimpleWavSetSource source4;
+  source4.set_wav_set (&wav_set);
+  play_source (source4, ref_wav_set.waves[1].audio, n_frames);
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  Random random;
+  random.set_seed (18);
+
+  WavSet wav_set;
+  for (int note = 60; note < 62; note++)
+    {
+      WavSetWave wave;
+      wave.midi_note = note;
+      wave.audio = random_audio (random, 2000 + note);
+      wav_set.waves.push_back (wave);
+    }
+  Error error = wav_set.save ("testaudiostream.smset");
+  assert (!error);
+
+  error = wav_set.waves[1].audio->save ("testaudiostream.sm");
+  assert (!error);
+
+  test_stream (wav_set.waves[0].audio, "testaudiostream.smset", 0);
+  test_stream (wav_set.waves[1].audio, "testaudiostream.smset", 1);
+  test_stream (wav_set.waves[1].audio, "testaudiostream.sm", -1);
+  test_wav_set_streams (wav_set, "testaudiostream.smset");
+
+  /* compressed frames can't be streamed */
+  wav_set.waves[0].audio->compress_frames = true;
+  error = wav_set.waves[0].audio->save ("testaudiostream.sm");
+  assert (!error);
+
+  AudioStream compressed_stream;
+  assert (compressed_stream.open ("testaudiostream.sm", -1));
+
+  for (auto filename : { "testaudiostream.smset", "testaudiostream.sm" })
+    {
+      if (unlink (filename) != 0)
+        {
+          perror ("unlink failed");
+          return 1;
+        }
+    }
+}
@@ -0,0 +1,86 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "smencoder.hh"
+#include "smwavdata.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+using namespace SpectMorph;
+
+using std::string;
+
+static Audio *
+encode (const WavData& wav_data, int n_threads)
+{
+  EncoderParams enc_params;
+  enc_params.setup_params (wav_data, 440);
+
+  Encoder encoder (enc_params);
+  encoder.set_n_threads (n_threads);
+
+  bool ok = encoder.encode (wav_data, /* channel */ 0, /* opt */ 1, /* attack */ true, /* sines */ true);
+  assert (ok);
+
+  return encoder.save_as_audio();
+}
+
+static void
+assert_same_audio (const Audio& a, const Audio& b)
+{
+  assert (a.fundamental_freq == b.fundamental_freq);
+  assert (a.mix_freq == b.mix_freq);
+  assert (a.frame_size_ms == b.frame_size_ms);
+  assert (a.frame_step_ms == b.frame_step_ms);
+  assert (a.attack_start_ms == b.attack_start_ms);
+  assert (a.attack_end_ms == b.attack_end_ms);
+  assert (a.zeropad == b.zeropad);
+  assert (a.loop_type == b.loop_type);
+  assert (a.loop_start == b.loop_start);
+  assert (a.loop_end == b.loop_end);
+  assert (a.zero_values_at_start == b.zero_values_at_start);
+  assert (a.sample_count == b.sample_count);
+  assert (a.original_samples == b.original_samples);
+  assert (a.original_samples_norm_db == b.original_samples_norm_db);
+
+  assert (a.contents.size() == b.contents.size());
+  for (size_t f = 0; f < a.contents.size(); f++)
+    {
+      const AudioBlock& block_a = a.contents[f];
+      const AudioBlock& block_b = b.contents[f];
+
+      assert (block_a.noise == block_b.noise);
+      assert (block_a.freqs == block_b.freqs);
+      assert (block_a.mags == block_b.mags);
+      assert (block_a.phases == block_b.phases);
+      assert (block_a.env == block_b.env);
+      assert (block_a.env_f0 == block_b.env_f0);
+      assert (block_a.original_fft == block_b.original_fft);
+      assert (block_a.debug_samples == block_b.debug_samples);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  const char *srcdir = getenv ("srcdir"); // set by make check
+  const string filename = string (srcdir ? srcdir : ".") + "/saw440.wav";
+
+  WavData wav_data;
+  if (!wav_data.load (filename))
+    {
+      fprintf (stderr, "testencthreads: can't load %s: %s\n", filename.c_str(), wav_data.error_blurb());
+      return 1;
+    }
+
+  /* the encoder result must not depend on the number of threads */
+  std::unique_ptr<Audio> audio1 (encode (wav_data, 1));
+  std::unique_ptr<Audio> audio4 (encode (wav_data, 4));
+
+  assert (audio1->contents.size() > 0);
+  assert_same_audio (*audio1, *audio4);
+}
@@ -0,0 +1,200 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "smaudio.hh"
+#include "smframecodec.hh"
+#include "sminfile.hh"
+#include "smmemout.hh"
+#include "smmmapin.hh"
+#include "smrandom.hh"
+#include "smutils.hh"
+
+#include <stdio.h>
+#include <assert.h>
+
+#include <algorithm>
+
+using namespace SpectMorph;
+
+using std::vector;
+
+/* partials change slowly from frame to frame (like in real sounds), unless smooth is false */
+static void
+random_audio (Random& random, Audio& audio, int frames, bool smooth)
+{
+  audio.mix_freq = 48000;
+  audio.frame_size_ms = 40;
+  audio.frame_step_ms = 10;
+  audio.zeropad = 4;
+  audio.sample_count = frames * 480;
+
+  AudioBlock block;
+  for (int f = 0; f < frames; f++)
+    {
+      if (!smooth || f == 0)
+        {
+          const size_t n_partials = 10 + random.random_uint32() % 90;
+
+          block = AudioBlock();
+          for (size_t p = 0; p < n_partials; p++)
+            {
+              block.freqs.push_back (random.random_uint32() & 0xffff);
+              block.mags.push_back (random.random_uint32() & 0xffff);
+              block.phases.push_back (random.random_uint32() & 0xffff);
+            }
+          for (size_t i = 0; i < Audio::N_NOISE_BANDS; i++)
+            block.noise.push_back (random.random_uint32() & 0xffff);
+          std::sort (block.freqs.begin(), block.freqs.end());
+        }
+      else
+        {
+          for (size_t p = 0; p < block.freqs.size(); p++)
+            {
+              block.mags[p] += int (random.random_uint32() % 200) - 100;
+              block.phases[p] = random.random_uint32() & 0xffff;
+            }
+          for (auto& n : block.noise)
+            n += int (random.random_uint32() % 40) - 20;
+        }
+      if (f % 10 == 0)
+        {
+          block.env.resize (random.random_uint32() % 50);
+          for (auto& e : block.env)
+            e = random.random_uint32() & 0xffff;
+        }
+      block.env_f0 = random.random_double_range (0.5, 2);
+      audio.contents.push_back (block);
+    }
+}
+
+static void
+assert_same_frames (const Audio& a, const Audio& b, size_t n_frames)
+{
+  for (size_t f = 0; f < n_frames; f++)
+    {
+      const AudioBlock& block_a = a.contents[f];
+      const AudioBlock& block_b = b.contents[f];
+
+      assert (block_a.noise == block_b.noise);
+      assert (block_a.freqs == block_b.freqs);
+      assert (block_a.mags == block_b.mags);
+      assert (block_a.phases == block_b.phases);
+      assert (block_a.env == block_b.env);
+      assert (block_a.env_f0 == block_b.env_f0);
+      assert (block_a.original_fft == block_b.original_fft);
+      assert (block_a.debug_samples == block_b.debug_samples);
+    }
+}
+
+static size_t
+save_load (Audio& audio, bool compress, Audio& loaded)
+{
+  vector<unsigned char> data;
+
+  audio.compress_frames = compress;
+  Error error = audio.save (MemOut::open (&data));
+  assert (!error);
+
+  error = loaded.load (MMapIn::open_vector (data), AUDIO_LOAD_DEBUG);
+  assert (!error);
+  assert (loaded.contents.size() == audio.contents.size());
+
+  /* older versions can't load compressed frames, so the file version must differ */
+  InFile ifile (MMapIn::open_vector (data));
+  assert (ifile.file_version() == (loaded.compress_frames ? SPECTMORPH_COMPRESSED_FILE_VERSION : SPECTMORPH_BINARY_FILE_VERSION));
+
+  return data.size();
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  Random random;
+  random.set_seed (17);
+
+  for (bool smooth : { true, false })
+    {
+      Audio audio;
+      random_audio (random, audio, 500, smooth);
+
+      Audio plain, compressed;
+      size_t plain_size = save_load (audio, false, plain);
+      size_t compressed_size = save_load (audio, true, compressed);
+
+      assert_same_frames (audio, plain, audio.contents.size());
+      assert_same_frames (audio, compressed, audio.contents.size());
+      assert (!plain.compress_frames);
+      assert (compressed.compress_frames);
+
+      /* partial load: the remaining frames are loaded on demand */
+      for (bool compress : { false, true })
+        {
+          vector<unsigned char> data;
+          audio.compress_frames = compress;
+          Error error = audio.save (MemOut::open (&data));
+          assert (!error);
+
+          Audio lazy;
+          error = lazy.load (MMapIn::open_vector (data), AUDIO_LOAD_DEBUG, 123);
+          assert (!error);
+          assert (lazy.frames_available() == 123 && !lazy.lazy_frames_wanted());
+          assert_same_frames (audio, lazy, 123);
+          assert (lazy.contents[123].freqs.empty());
+
+          /* only frames up to the playback position + lookahead (123) are loaded */
+          lazy.request_frames (200);
+          assert (lazy.lazy_frames_wanted());
+          error = lazy.load_lazy_frames();
+          assert (!error);
+          assert (lazy.frames_available() == 323 && !lazy.lazy_frames_wanted());
+          assert_same_frames (audio, lazy, 323);
+          assert (lazy.contents[323].freqs.empty());
+
+          lazy.request_frames (450);
+          error = lazy.load_lazy_frames();
+          assert (!error);
+          assert (lazy.frames_available() == audio.contents.size());
+          assert_same_frames (audio, lazy, audio.contents.size());
+          assert (!lazy.lazy_frames->ifile && !lazy.lazy_frames->decoder);
+        }
+
+      printf ("%-6s: uncompressed %zd bytes, compressed %zd bytes (%.1f%%)\n", smooth ? "smooth" : "random",
+              plain_size, compressed_size, compressed_size * 100.0 / plain_size);
+    }
+
+  /* empty audio */
+  Audio empty, empty_loaded;
+  save_load (empty, true, empty_loaded);
+
+  /* debug information is not supported by FrameCodec, so these frames are stored uncompressed */
+  Audio debug_audio;
+  random_audio (random, debug_audio, 20, true);
+  debug_audio.contents[5].original_fft = { 1, 2, 3 };
+  assert (!FrameCodec::can_encode (debug_audio.contents));
+
+  Audio debug_loaded;
+  save_load (debug_audio, true, debug_loaded);
+  assert_same_frames (debug_audio, debug_loaded, debug_audio.contents.size());
+  assert (!debug_loaded.compress_frames);
+
+  /* corrupt data must be rejected, not crash */
+  vector<unsigned char> frame_data;
+  Audio audio;
+  random_audio (random, audio, 100, true);
+  FrameCodec::encode (audio.contents, frame_data);
+  for (size_t size = 0; size < frame_data.size(); size++)
+    {
+      vector<AudioBlock> contents (audio.contents.size());
+      assert (!FrameCodec::decode (frame_data.data(), size, contents));
+    }
+  for (int i = 0; i < 1000; i++)
+    {
+      vector<unsigned char> corrupt_data = frame_data;
+      corrupt_data[random.random_uint32() % corrupt_data.size()] ^= 1 + random.random_uint32() % 255;
+
+      vector<AudioBlock> contents (audio.contents.size());
+      FrameCodec::decode (corrupt_data.data(), corrupt_data.size(), contents);
+    }
+}
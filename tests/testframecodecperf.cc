@@ -0,0 +1,151 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "smaudio.hh"
+#include "smwavset.hh"
+#include "smframecodec.hh"
+#include "smmemout.hh"
+#include "smmmapin.hh"
+#include "smrandom.hh"
+#include "smutils.hh"
+
+#include <stdio.h>
+#include <assert.h>
+
+#include <algorithm>
+
+using namespace SpectMorph;
+
+using std::vector;
+
+/* partials change slowly from frame to frame, like in real sounds */
+static Audio *
+smooth_audio (Random& random, int frames)
+{
+  Audio *audio = new Audio();
+  audio->mix_freq = 48000;
+  audio->frame_size_ms = 40;
+  audio->frame_step_ms = 10;
+  audio->zeropad = 4;
+  audio->sample_count = frames * 480;
+
+  AudioBlock block;
+  for (size_t p = 0; p < 60; p++)
+    {
+      block.freqs.push_back (random.random_uint32() & 0xffff);
+      block.mags.push_back (random.random_uint32() & 0xffff);
+      block.phases.push_back (random.random_uint32() & 0xffff);
+    }
+  std::sort (block.freqs.begin(), block.freqs.end());
+  block.noise.resize (Audio::N_NOISE_BANDS, 30000);
+
+  for (int f = 0; f < frames; f++)
+    {
+      for (size_t p = 0; p < block.freqs.size(); p++)
+        {
+          block.mags[p] += int (random.random_uint32() % 200) - 100;
+          block.phases[p] = random.random_uint32() & 0xffff;
+        }
+      for (auto& n : block.noise)
+        n += int (random.random_uint32() % 40) - 20;
+      block.env_f0 = 1;
+      audio->contents.push_back (block);
+    }
+  return audio;
+}
+
+static size_t
+frame_data_bytes (const Audio& audio)
+{
+  size_t bytes = 0;
+  for (const auto& block : audio.contents)
+    bytes += (block.noise.size() + block.freqs.size() + block.mags.size() + block.phases.size() + block.env.size()) * sizeof (uint16_t);
+  return bytes;
+}
+
+/* best of reps runs */
+template<class Func> static double
+best_time (int reps, Func func)
+{
+  double best = 1e30;
+  for (int rep = 0; rep < reps; rep++)
+    {
+      const double start = get_time();
+      func();
+      best = std::min (best, get_time() - start);
+    }
+  return best;
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  /* use audio objects of a wav set, if specified, otherwise synthetic data */
+  WavSet wav_set;
+  if (argc > 1)
+    {
+      Error error = wav_set.load (argv[1], AUDIO_SKIP_DEBUG);
+      if (error)
+        {
+          fprintf (stderr, "testframecodecperf: can't load %s: %s\n", argv[1], error.message());
+          return 1;
+        }
+    }
+  else
+    {
+      Random random;
+      random.set_seed (42);
+
+      for (int i = 0; i < 10; i++)
+        {
+          WavSetWave wave;
+          wave.audio = smooth_audio (random, 1000);
+          wav_set.waves.push_back (wave);
+        }
+    }
+
+  double t_plain = 0, t_compressed = 0, t_decode = 0;
+  size_t n_frames = 0, n_bytes = 0, plain_size = 0, compressed_size = 0;
+  for (const auto& wave : wav_set.waves)
+    {
+      Audio& audio = *wave.audio;
+
+      vector<unsigned char> plain_data, compressed_data, frame_data;
+      audio.compress_frames = false;
+      audio.save (MemOut::open (&plain_data));
+      audio.compress_frames = true;
+      audio.save (MemOut::open (&compressed_data));
+      FrameCodec::encode (audio.contents, frame_data);
+
+      t_plain += best_time (5, [&]()
+        {
+          Audio loaded;
+          Error error = loaded.load (MMapIn::open_vector (plain_data), AUDIO_SKIP_DEBUG);
+          assert (!error);
+        });
+      t_compressed += best_time (5, [&]()
+        {
+          Audio loaded;
+          Error error = loaded.load (MMapIn::open_vector (compressed_data), AUDIO_SKIP_DEBUG);
+          assert (!error);
+        });
+      t_decode += best_time (5, [&]()
+        {
+          vector<AudioBlock> contents (audio.contents.size());
+          bool ok = FrameCodec::decode (frame_data.data(), frame_data.size(), contents);
+          assert (ok);
+        });
+
+      n_frames        += audio.contents.size();
+      n_bytes         += frame_data_bytes (audio);
+      plain_size      += plain_data.size();
+      compressed_size += compressed_data.size();
+    }
+  printf ("%zd frames, %.2f MB frame data, file size: plain %.2f MB, compressed %.2f MB (%.1f%%)\n",
+          n_frames, n_bytes / 1e6, plain_size / 1e6, compressed_size / 1e6, compressed_size * 100.0 / plain_size);
+  printf ("load plain:       %8.2f ms  %6.2f us/frame  %8.2f MB/s\n", t_plain * 1000, t_plain * 1e6 / n_frames, n_bytes / 1e6 / t_plain);
+  printf ("load compressed:  %8.2f ms  %6.2f us/frame  %8.2f MB/s\n", t_compressed * 1000, t_compressed * 1e6 / n_frames, n_bytes / 1e6 / t_compressed);
+  printf ("FrameCodec only:  %8.2f ms  %6.2f us/frame  %8.2f MB/s\n", t_decode * 1000, t_decode * 1e6 / n_frames, n_bytes / 1e6 / t_decode);
+}
@@ -8,6 +8,7 @@
 #include "smfft.hh"
 #include "smutils.hh"
 #include "smpandaresampler.hh"
+#include "smrandom.hh"
 
 #include <stdio.h>
 #include <assert.h>
@@ -61,18 +62,24 @@ perf_test()
   int RUNS = 1000 * 1000 * 5;
   double start, end, t;
 
-  synth.clear_partials();
-  t = 1e30;
-  for (int reps = 0; reps < 12; reps++)
+  for (int sse = 0; sse < 2; sse++)
     {
-      start = get_time();
-      for (int r = 0; r < RUNS; r++)
-        synth.render_partial (freq_mag[0], freq_mag[1], uphase[0]);
-      end = get_time();
-      t = min (t, end - start);
-    }
+      sm_enable_sse (sse);
+      IFFTSynth rp_synth (block_size, mix_freq, IFFTSynth::WIN_HANN);
+
+      rp_synth.clear_partials();
+      t = 1e30;
+      for (int reps = 0; reps < 12; reps++)
+        {
+          start = get_time();
+          for (int r = 0; r < RUNS; r++)
+            rp_synth.render_partial (freq_mag[0], freq_mag[1], uphase[0]);
+          end = get_time();
+          t = min (t, end - start);
+        }
 
-  printf ("render_partial: clocks per sample: %f\n", clocks_per_sec * t / RUNS / block_size);
+      printf ("render_partial (sse=%d): clocks per sample: %f\n", sse, clocks_per_sec * t / RUNS / block_size);
+    }
 
   AlignedArray<float, 16> sse_samples (block_size);
 
@@ -199,6 +206,40 @@ test_negative_phase()
 }
 
 
+void
+test_sse()
+{
+  const double mix_freq = 48000;
+  const size_t block_size = 1024;
+
+  /* render the same partials with the scalar and the SSE version of render_partial() */
+  vector<float> spectrum[2];
+  for (int sse = 0; sse < 2; sse++)
+    {
+      sm_enable_sse (sse);
+
+      IFFTSynth synth (block_size, mix_freq, IFFTSynth::WIN_HANN);
+      Random    random;
+
+      random.set_seed (42);
+      synth.clear_partials();
+      for (int p = 0; p < 1000; p++)
+        {
+          const float freq = random.random_double_range (10, 23900);
+          const float mag = random.random_double_range (0.01, 1);
+          synth.render_partial (freq, mag, random.random_uint32());
+        }
+      spectrum[sse].assign (synth.fft_input(), synth.fft_input() + block_size);
+    }
+  sm_enable_sse (true);
+
+  double max_diff = 0;
+  for (size_t i = 0; i < block_size; i++)
+    max_diff = max (max_diff, std::abs (double (spectrum[0][i]) - spectrum[1][i]));
+  sm_printf ("# test_sse: %.17g\n", max_diff);
+  assert (max_diff < 1e-6);
+}
+
 void
 test_accs()
 {
@@ -550,7 +591,7 @@ test_portaslide (bool verbose)
 }
 
 void
-test_saw_perf()
+test_saw_perf (int unison_voices)
 {
   double mix_freq = 48000;
   double freq = 110;
@@ -574,6 +615,7 @@ test_saw_perf()
       live_decoder.enable_noise (false);
       live_decoder.enable_sines (i == 1);
       live_decoder.enable_debug_fft_perf (i == 0);
+      live_decoder.set_unison_voices (unison_voices, 10);
       live_decoder.precompute_tables (mix_freq);
       live_decoder.retrigger (0, freq, 127);
 
@@ -592,7 +634,80 @@ test_saw_perf()
 
   const double clocks_per_sec = 2500.0 * 1000 * 1000;
   double time = t[1] - t[0]; // time without fft time
-  printf ("LiveDecoder: clocks per sample per partial: %f\n", clocks_per_sec * time / RUNS / PARTIALS / samples.size());
+  printf ("LiveDecoder (unison voices %d): clocks per sample per partial: %f\n", unison_voices,
+          clocks_per_sec * time / RUNS / PARTIALS / unison_voices / samples.size());
+}
+
+void
+test_combined_noise()
+{
+  const double mix_freq = 48000;
+
+  AudioBlock audio_block;
+  for (size_t partial = 1; partial <= 20; partial++)
+    push_partial_f (audio_block, partial, 0.1 / partial, 0.9);
+  for (int i = 0; i < 32; i++)
+    audio_block.noise.push_back (sm_factor2idb (0.001 * (1 + i % 3)));
+
+  /* render the same note with separate noise IFFT and with combined sine/noise IFFT */
+  vector<float> samples[2];
+  for (int combined = 0; combined < 2; combined++)
+    {
+      ConstBlockSource source (audio_block, mix_freq);
+
+      RTMemoryArea rt_memory_area;
+      LiveDecoder live_decoder (&source, mix_freq);
+      live_decoder.enable_combined_ifft (combined);
+      live_decoder.set_random_seed (42);
+      live_decoder.retrigger (0, 440, 127);
+
+      samples[combined].resize (mix_freq);
+      for (size_t offset = 0; offset < samples[combined].size(); offset += 1000)
+        {
+          const size_t n_values = min<size_t> (1000, samples[combined].size() - offset);
+          live_decoder.process (rt_memory_area, n_values, nullptr, &samples[combined][offset]);
+        }
+    }
+  double max_diff = 0;
+  for (size_t i = 0; i < samples[0].size(); i++)
+    max_diff = max (max_diff, std::abs (double (samples[0][i]) - samples[1][i]));
+  sm_printf ("# test_combined_noise: %.17g\n", max_diff);
+  assert (max_diff < 1e-4);
+}
+
+void
+test_many_partials()
+{
+  const double mix_freq = 48000;
+
+  /* more partials than LiveDecoder can synthesize: only the partials above the
+   * first 2048 are loud, so keeping the first partials would result in (almost) silence
+   */
+  AudioBlock audio_block;
+  for (size_t partial = 1; partial <= 3000; partial++)
+    push_partial_f (audio_block, partial, partial > 2048 ? 0.01 : 1e-7, 0.5);
+
+  ConstBlockSource source (audio_block, mix_freq);
+
+  RTMemoryArea rt_memory_area;
+  LiveDecoder live_decoder (&source, mix_freq);
+  live_decoder.enable_noise (false);
+  live_decoder.retrigger (0, 4, 127);
+
+  vector<float> samples (mix_freq / 2);
+  for (size_t offset = 0; offset < samples.size(); offset += 1000)
+    {
+      const size_t n_values = min<size_t> (1000, samples.size() - offset);
+      live_decoder.process (rt_memory_area, n_values, nullptr, &samples[offset]);
+    }
+
+  double energy = 0;
+  for (size_t i = samples.size() / 2; i < samples.size(); i++)
+    energy += samples[i] * samples[i];
+
+  const double rms = sqrt (energy / (samples.size() / 2));
+  sm_printf ("# test_many_partials: rms %.17g\n", rms);
+  assert (rms > 0.05);
 }
 
 int
@@ -608,7 +723,8 @@ main (int argc, char **argv)
     }
   if (argc == 2 && strcmp (argv[1], "saw_perf") == 0)
     {
-      test_saw_perf();
+      test_saw_perf (1);
+      test_saw_perf (5);
       return 0;
     }
   if (argc == 2 && strcmp (argv[1], "accs") == 0)
@@ -666,4 +782,7 @@ main (int argc, char **argv)
 
   test_portaslide (false);
   test_negative_phase();
+  test_sse();
+  test_combined_noise();
+  test_many_partials();
 }
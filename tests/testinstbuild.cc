@@ -3,15 +3,46 @@
 #include "smmain.hh"
 #include "smwavsetbuilder.hh"
 #include "sminstenccache.hh"
+#include "smmemout.hh"
 
+#include <glib.h>
 #include <assert.h>
+#include <unistd.h>
 
 using namespace SpectMorph;
 using std::vector;
+using std::string;
+
+static vector<unsigned char>
+audio_data (const Audio *audio)
+{
+  vector<unsigned char> data;
+  audio->save (MemOut::open (&data));
+  return data;
+}
+
+static void
+remove_cache_files (const string& cache_dir)
+{
+  vector<string> files;
+  Error error = read_dir (cache_dir, files);
+  assert (!error);
+
+  for (const auto& filename : files)
+    unlink ((cache_dir + "/" + filename).c_str());
+}
 
 int
 main (int argc, char **argv)
 {
+  /* parallel: use an empty cache directory, so that both builds really encode the samples */
+  string tmp_dir;
+  if (argc == 3 && strcmp (argv[1], "parallel") == 0)
+    {
+      char tmp_template[] = "/tmp/testinstbuild-XXXXXX";
+      tmp_dir = g_mkdtemp (tmp_template);
+      g_setenv ("XDG_DATA_HOME", tmp_dir.c_str(), true);
+    }
   Main main (&argc, &argv);
 
   if (argc == 3 && strcmp (argv[1], "kill") == 0)
@@ -35,6 +66,41 @@ main (int argc, char **argv)
       std::unique_ptr<WavSet> wav_set (builder.run());
       kill_func(); // take time at end
 
+      return 0;
+    }
+  if (argc == 3 && strcmp (argv[1], "parallel") == 0)
+    {
+      const string cache_dir = sm_get_user_dir (USER_DIR_CACHE);
+      assert (cache_dir.compare (0, tmp_dir.size(), tmp_dir) == 0);
+
+      Instrument inst;
+      inst.load (argv[2]);
+
+      std::unique_ptr<WavSet> wav_set[2];
+      for (int p = 0; p < 2; p++)
+        {
+          InstEncCache::the()->clear();
+          remove_cache_files (cache_dir);
+
+          double t = get_time();
+
+          WavSetBuilder builder (&inst, /* keep_samples */ false);
+          builder.set_n_threads (p ? 0 : 1);
+          wav_set[p].reset (builder.run());
+
+          printf ("%s: %.2f ms\n", p ? "parallel" : "sequential", (get_time() - t) * 1000);
+        }
+      // encoding must not depend on the number of threads
+      assert (wav_set[0]->waves.size() == wav_set[1]->waves.size());
+      for (size_t w = 0; w < wav_set[0]->waves.size(); w++)
+        {
+          assert (wav_set[0]->waves[w].midi_note == wav_set[1]->waves[w].midi_note);
+          assert (audio_data (wav_set[0]->waves[w].audio) == audio_data (wav_set[1]->waves[w].audio));
+        }
+      remove_cache_files (cache_dir);
+      rmdir (cache_dir.c_str());
+      rmdir ((tmp_dir + "/spectmorph").c_str());
+      rmdir (tmp_dir.c_str());
       return 0;
     }
   assert (argc == 2);
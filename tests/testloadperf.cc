@@ -0,0 +1,101 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smindex.hh"
+#include "smwavset.hh"
+#include "sminfile.hh"
+#include "smstdioin.hh"
+#include "smmain.hh"
+#include "smutils.hh"
+
+#include <stdio.h>
+#include <assert.h>
+
+using namespace SpectMorph;
+using std::string;
+using std::vector;
+
+/* load all audio objects of a wav set file, using either memory mapped or stdio input */
+static size_t
+load_audios (const string& filename, bool use_mmap)
+{
+  InFile ifile (use_mmap ? GenericIn::open (filename) : StdioIn::open (filename));
+  assert (ifile.open_ok());
+
+  size_t n_frames = 0;
+  while (ifile.event() != InFile::END_OF_FILE)
+    {
+      assert (ifile.event() != InFile::READ_ERROR);
+
+      if (ifile.event() == InFile::BLOB && ifile.event_name() == "audio")
+        {
+          Audio audio;
+          Error error = audio.load (ifile.open_blob(), AUDIO_SKIP_DEBUG);
+          assert (!error);
+
+          n_frames += audio.contents.size();
+        }
+      ifile.next_event();
+    }
+  return n_frames;
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  Index index;
+  if (!index.load_file (argc > 1 ? argv[1] : "instruments:standard"))
+    {
+      fprintf (stderr, "testloadperf: can't load index (usage: testloadperf [<index>])\n");
+      return 1;
+    }
+
+  double t_wav_set = 0, t_wav_set1 = 0, t_mmap = 0, t_stdio = 0;
+  size_t n_frames = 0;
+
+  for (auto smset : index.smsets())
+    {
+      const string filename = index.smset_dir() + "/" + smset;
+      if (WavSet::is_mapped_file (filename)) // not parsed by InFile
+        continue;
+
+      /* best of 3 runs to reduce the influence of disk cache / scheduling */
+      double best[4] = { 1e30, 1e30, 1e30, 1e30 };
+      size_t frames = 0;
+      for (int rep = 0; rep < 3; rep++)
+        {
+          double start = get_time();
+          WavSet wav_set;
+          Error error = wav_set.load (filename, AUDIO_SKIP_DEBUG, 0, /* n_threads: one per core */ 0);
+          assert (!error);
+          best[0] = std::min (best[0], get_time() - start);
+
+          start = get_time();
+          frames = load_audios (filename, true);
+          best[1] = std::min (best[1], get_time() - start);
+
+          start = get_time();
+          load_audios (filename, false);
+          best[2] = std::min (best[2], get_time() - start);
+
+          start = get_time();
+          WavSet wav_set1;
+          error = wav_set1.load (filename, AUDIO_SKIP_DEBUG, 0, /* n_threads */ 1);
+          assert (!error);
+          best[3] = std::min (best[3], get_time() - start);
+        }
+      printf ("%-30s %7zd frames: wav set %8.2f ms  (1 thread %8.2f ms)  mmap %8.2f ms  stdio %8.2f ms\n", smset.c_str(), frames,
+              best[0] * 1000, best[3] * 1000, best[1] * 1000, best[2] * 1000);
+
+      t_wav_set += best[0];
+      t_wav_set1 += best[3];
+      t_mmap    += best[1];
+      t_stdio   += best[2];
+      n_frames  += frames;
+    }
+  printf ("\n");
+  printf ("total %zd frames: wav set %.2f ms  (1 thread %.2f ms)  mmap %.2f ms  stdio %.2f ms\n", n_frames,
+          t_wav_set * 1000, t_wav_set1 * 1000, t_mmap * 1000, t_stdio * 1000);
+  printf ("mmap: %.2f us/frame, stdio: %.2f us/frame\n", t_mmap * 1e6 / n_frames, t_stdio * 1e6 / n_frames);
+}
@@ -0,0 +1,237 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "smwavset.hh"
+#include "smrandom.hh"
+#include "smrtmemory.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+using namespace SpectMorph;
+
+using std::vector;
+using std::string;
+
+static vector<uint16_t>
+random_vector (Random& random, size_t n, bool sorted = false)
+{
+  vector<uint16_t> vec;
+  for (size_t i = 0; i < n; i++)
+    vec.push_back (random.random_uint32() & 0xffff);
+  if (sorted)
+    std::sort (vec.begin(), vec.end());
+  return vec;
+}
+
+static Audio *
+random_audio (Random& random, int frames)
+{
+  Audio *audio = new Audio();
+
+  audio->mix_freq = 48000;
+  audio->frame_size_ms = 40;
+  audio->frame_step_ms = 10;
+  audio->fundamental_freq = random.random_double_range (100, 1000);
+  audio->zeropad = 4;
+  audio->loop_type = Audio::LOOP_FRAME_FORWARD;
+  audio->loop_start = frames / 3;
+  audio->loop_end = frames / 2;
+  audio->sample_count = frames * 480;
+  audio->original_samples_norm_db = -3;
+  for (int i = 0; i < 100; i++)
+    audio->original_samples.push_back (random.random_double_range (-1, 1));
+
+  for (int f = 0; f < frames; f++)
+    {
+      AudioBlock block;
+      size_t n_partials = random.random_uint32() % 100;
+
+      block.noise = random_vector (random, Audio::N_NOISE_BANDS);
+      block.freqs = random_vector (random, n_partials, true);
+      block.mags = random_vector (random, n_partials);
+      block.phases = random_vector (random, n_partials);
+      block.env = random_vector (random, random.random_uint32() % 50);
+      block.env_f0 = random.random_double_range (0.5, 2);
+      audio->contents.push_back (block);
+    }
+  return audio;
+}
+
+static bool
+read_file (const string& filename, vector<unsigned char>& data)
+{
+  FILE *file = fopen (filename.c_str(), "rb");
+  if (!file)
+    return false;
+
+  unsigned char buffer[1024];
+  size_t len;
+  while ((len = fread (buffer, 1, sizeof (buffer), file)) > 0)
+    data.insert (data.end(), buffer, buffer + len);
+  fclose (file);
+  return true;
+}
+
+static bool
+write_file (const string& filename, const vector<unsigned char>& data)
+{
+  FILE *file = fopen (filename.c_str(), "wb");
+  if (!file)
+    return false;
+
+  bool ok = fwrite (data.data(), 1, data.size(), file) == data.size();
+  return fclose (file) == 0 && ok;
+}
+
+static void
+assert_same_audio (const Audio *a, const Audio *b)
+{
+  assert (a->mix_freq == b->mix_freq);
+  assert (a->frame_size_ms == b->frame_size_ms);
+  assert (a->frame_step_ms == b->frame_step_ms);
+  assert (a->fundamental_freq == b->fundamental_freq);
+  assert (a->zeropad == b->zeropad);
+  assert (a->loop_type == b->loop_type);
+  assert (a->loop_start == b->loop_start);
+  assert (a->loop_end == b->loop_end);
+  assert (a->sample_count == b->sample_count);
+  assert (a->original_samples_norm_db == b->original_samples_norm_db);
+  assert (a->original_samples == b->original_samples);
+  assert (a->contents.size() == b->contents.size());
+
+  for (size_t f = 0; f < a->contents.size(); f++)
+    {
+      const AudioBlock& block_a = a->contents[f];
+      const AudioBlock& block_b = b->contents[f];
+
+      assert (block_a.noise == block_b.noise);
+      assert (block_a.freqs == block_b.freqs);
+      assert (block_a.mags == block_b.mags);
+      assert (block_a.phases == block_b.phases);
+      assert (block_a.env == block_b.env);
+      assert (block_a.env_f0 == block_b.env_f0);
+    }
+}
+
+/* const access, so the view is not copied */
+static bool
+same_data (const vector<uint16_t>& vec, const RTVector<uint16_t>& rt_vec)
+{
+  if (vec.size() != rt_vec.size())
+    return false;
+
+  for (size_t i = 0; i < vec.size(); i++)
+    if (vec[i] != rt_vec[i])
+      return false;
+  return true;
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  Random random;
+  random.set_seed (15);
+
+  WavSet wav_set;
+  wav_set.name = "mapped-test";
+  wav_set.short_name = "mt";
+  for (int note = 40; note < 80; note += 10)
+    {
+      WavSetWave wave;
+      wave.midi_note = note;
+      wave.path = "note" + std::to_string (note) + ".wav";
+      wave.audio = random_audio (random, 50 + note);
+      wav_set.waves.push_back (wave);
+    }
+  /* same audio used twice (different velocity) */
+  WavSetWave shared_wave = wav_set.waves[0];
+  shared_wave.velocity_range_min = 64;
+  wav_set.waves.push_back (shared_wave);
+
+  Error error = wav_set.save_mapped ("testmappedwavset.out");
+  assert (!error);
+  assert (WavSet::is_mapped_file ("testmappedwavset.out"));
+
+  WavSet loaded;
+  error = loaded.load ("testmappedwavset.out");
+  assert (!error);
+
+  assert (loaded.name == wav_set.name);
+  assert (loaded.short_name == wav_set.short_name);
+  assert (loaded.waves.size() == wav_set.waves.size());
+  for (size_t i = 0; i < wav_set.waves.size(); i++)
+    {
+      assert (loaded.waves[i].midi_note == wav_set.waves[i].midi_note);
+      assert (loaded.waves[i].channel == wav_set.waves[i].channel);
+      assert (loaded.waves[i].velocity_range_min == wav_set.waves[i].velocity_range_min);
+      assert (loaded.waves[i].velocity_range_max == wav_set.waves[i].velocity_range_max);
+      assert (loaded.waves[i].path == wav_set.waves[i].path);
+      assert_same_audio (loaded.waves[i].audio, wav_set.waves[i].audio);
+    }
+  assert (loaded.waves[0].audio == loaded.waves.back().audio);
+
+  /* frames used in place: views of the mapped file must match the original frames */
+  WavSet mapped;
+  error = mapped.load ("testmappedwavset.out", AUDIO_MAP_FRAMES);
+  assert (!error);
+  assert (mapped.waves.size() == wav_set.waves.size());
+
+  RTMemoryArea rt_memory_area;
+  for (size_t i = 0; i < wav_set.waves.size(); i++)
+    {
+      const Audio *audio = wav_set.waves[i].audio;
+      Audio *mapped_audio = mapped.waves[i].audio;
+
+      assert (mapped_audio->mapped_frames && mapped_audio->contents.empty());
+      assert (mapped_audio->n_frames() == audio->contents.size());
+
+      mapped_audio->build_float_cache();
+      for (size_t f = 0; f < audio->contents.size(); f++)
+        {
+          const AudioBlock& block = audio->contents[f];
+
+          RTAudioBlock view (&rt_memory_area);
+          view.assign_view (*mapped_audio, f);
+          assert (view.freqs.borrowed() && view.mags.borrowed() && view.noise.borrowed());
+          assert (same_data (block.freqs, view.freqs));
+          assert (same_data (block.mags, view.mags));
+          assert (same_data (block.noise, view.noise));
+          for (size_t p = 0; p < block.freqs.size(); p++)
+            assert (view.freqs_f (p) == block.freqs_f (p) && view.mags_f (p) == block.mags_f (p));
+        }
+
+      /* copies have the frame data in contents */
+      std::unique_ptr<Audio> mapped_clone (mapped_audio->clone());
+      assert (!mapped_clone->mapped_frames);
+      assert_same_audio (mapped_clone.get(), audio);
+    }
+  assert (mapped.waves[0].audio == mapped.waves.back().audio);
+
+  /* invalid loop type must be rejected */
+  vector<unsigned char> data;
+  assert (read_file ("testmappedwavset.out", data));
+
+  uint64_t audios_offset;
+  memcpy (&audios_offset, &data[64], sizeof (audios_offset)); // MappedHeader::audios_offset
+  const int32_t bad_loop_type = 42;
+  memcpy (&data[audios_offset + 32], &bad_loop_type, sizeof (bad_loop_type)); // MappedAudio::loop_type
+  assert (write_file ("testmappedwavset.out", data));
+
+  WavSet bad;
+  error = bad.load ("testmappedwavset.out");
+  assert (error);
+
+  if (unlink ("testmappedwavset.out") != 0)
+    {
+      perror ("unlink testmappedwavset.out failed");
+      return 1;
+    }
+}
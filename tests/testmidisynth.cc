@@ -8,6 +8,7 @@
 #include "smmicroconf.hh"
 
 #include <unistd.h>
+#include <inttypes.h>
 
 using namespace SpectMorph;
 
@@ -84,6 +85,17 @@ main (int argc, char **argv)
             {
               midi_synth.add_pitch_expression_event (0, d, ch, i);
             }
+          else if (script_parser.command ("render_threads", i))
+            {
+              midi_synth.set_render_threads (i);
+            }
+          else if (script_parser.command ("modulation_stats"))
+            {
+              auto stats = midi_synth.modulation_cache_stats();
+              const uint64 total = stats.hits + stats.misses;
+              fprintf (stderr, "modulation cache: %" PRIu64 " hits, %" PRIu64 " misses (%.1f%% hit rate)\n",
+                       stats.hits, stats.misses, total ? stats.hits * 100.0 / total : 0.0);
+            }
           else
             {
               script_parser.die_if_unknown();
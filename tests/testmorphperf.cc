@@ -0,0 +1,136 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmorphutils.hh"
+#include "smrandom.hh"
+#include "smmain.hh"
+#include "smutils.hh"
+
+#include <stdio.h>
+#include <assert.h>
+
+using namespace SpectMorph;
+using std::vector;
+
+static AudioBlock
+random_block (Random& random, size_t n_partials, bool distinct_mags, int mag_offset = 0)
+{
+  AudioBlock block;
+
+  /* harmonic partials with random detuning + some inharmonic partials */
+  for (size_t p = 1; p <= n_partials; p++)
+    {
+      double freq = p * random.random_double_range (0.97, 1.03);
+      if (random.random_uint32() % 4 == 0)
+        freq = random.random_double_range (1, n_partials);
+
+      block.freqs.push_back (sm_freq2ifreq (freq));
+      if (distinct_mags)
+        block.mags.push_back (p * 257 + 2 * (random.random_uint32() % 100) + mag_offset);
+      else
+        block.mags.push_back (sm_factor2idb (random.random_double_range (0.001, 1)));
+    }
+  for (size_t i = 0; i < Audio::N_NOISE_BANDS; i++)
+    block.noise.push_back (sm_factor2idb (random.random_double_range (0.001, 0.01)));
+
+  block.sort_freqs();
+  return block;
+}
+
+static bool
+same_output (const RTAudioBlock& a, const RTAudioBlock& b)
+{
+  if (a.freqs.size() != b.freqs.size())
+    return false;
+  for (size_t i = 0; i < a.freqs.size(); i++)
+    if (a.freqs[i] != b.freqs[i] || a.mags[i] != b.mags[i])
+      return false;
+  return true;
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  const MorphUtils::MatchEngine engines[2] = { MorphUtils::MatchEngine::SORT_SEARCH, MorphUtils::MatchEngine::LINEAR };
+  const char *engine_names[2] = { "sort+search", "linear" };
+
+  RTMemoryArea rt_memory_area;
+  Random       random;
+  random.set_seed (42);
+
+  /* with distinct magnitudes (even for left, odd for right block), the order of matching is well
+   * defined, so both engines must agree
+   */
+  for (int test = 0; test < 1000; test++)
+    {
+      AudioBlock left = random_block (random, 10 + test % 200, true, 0);
+      AudioBlock right = random_block (random, 10 + (test * 7) % 200, true, 1);
+
+      RTAudioBlock left_block (&rt_memory_area), right_block (&rt_memory_area);
+      left_block.assign (left);
+      right_block.assign (right);
+
+      const double morphing = random.random_double_range (-1, 1);
+      RTAudioBlock out_a (&rt_memory_area), out_b (&rt_memory_area);
+      MorphUtils::morph (out_a, true, left_block, true, right_block, morphing, MorphUtils::MorphMode::LINEAR, engines[0]);
+      MorphUtils::morph (out_b, true, left_block, true, right_block, morphing, MorphUtils::MorphMode::LINEAR, engines[1]);
+
+      assert (same_output (out_a, out_b));
+      rt_memory_area.free_all();
+    }
+
+  /* performance */
+  for (size_t n_partials : { 50, 200, 800 })
+    {
+      const int N_BLOCKS = 64;
+
+      vector<AudioBlock> blocks;
+      for (int b = 0; b < N_BLOCKS; b++)
+        blocks.push_back (random_block (random, n_partials, false));
+
+      int n_different = 0;
+      for (int b = 0; b + 1 < N_BLOCKS; b++)
+        {
+          RTAudioBlock left_block (&rt_memory_area), right_block (&rt_memory_area);
+          left_block.assign_view (blocks[b]);
+          right_block.assign_view (blocks[b + 1]);
+
+          RTAudioBlock out_a (&rt_memory_area), out_b (&rt_memory_area);
+          MorphUtils::morph (out_a, true, left_block, true, right_block, 0.3, MorphUtils::MorphMode::LINEAR, engines[0]);
+          MorphUtils::morph (out_b, true, left_block, true, right_block, 0.3, MorphUtils::MorphMode::LINEAR, engines[1]);
+
+          if (!same_output (out_a, out_b))
+            n_different++;
+          rt_memory_area.free_all();
+        }
+
+      double t[2];
+      for (int e = 0; e < 2; e++)
+        {
+          const int RUNS = 200000 / n_partials;
+
+          t[e] = 1e30;
+          for (int reps = 0; reps < 5; reps++)
+            {
+              const double start = get_time();
+              for (int r = 0; r < RUNS; r++)
+                {
+                  for (int b = 0; b + 1 < N_BLOCKS; b++)
+                    {
+                      RTAudioBlock left_block (&rt_memory_area), right_block (&rt_memory_area), out_block (&rt_memory_area);
+                      left_block.assign_view (blocks[b]);
+                      right_block.assign_view (blocks[b + 1]);
+
+                      MorphUtils::morph (out_block, true, left_block, true, right_block, 0.3, MorphUtils::MorphMode::LINEAR, engines[e]);
+                      rt_memory_area.free_all();
+                    }
+                }
+              t[e] = std::min (t[e], (get_time() - start) / RUNS / (N_BLOCKS - 1));
+            }
+          printf ("%4zd partials: %-12s %8.3f us/morph\n", n_partials, engine_names[e], t[e] * 1e6);
+        }
+      printf ("%4zd partials: speedup %.2f, %d of %d outputs differ (equal magnitudes matched in different order)\n",
+              n_partials, t[0] / t[1], n_different, N_BLOCKS - 1);
+    }
+}
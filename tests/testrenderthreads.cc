@@ -0,0 +1,175 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "smmidisynth.hh"
+#include "smproject.hh"
+#include "smsynthinterface.hh"
+#include "smmorphoutput.hh"
+#include "smmorphlinear.hh"
+#include "smmorphwavsource.hh"
+#include "smencoder.hh"
+#include "smwavdata.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <assert.h>
+
+using namespace SpectMorph;
+
+using std::string;
+using std::vector;
+
+static std::shared_ptr<WavSet>
+encode_wav_set (const WavData& wav_data)
+{
+  EncoderParams enc_params;
+  enc_params.setup_params (wav_data, 440);
+
+  Encoder encoder (enc_params);
+  bool ok = encoder.encode (wav_data, /* channel */ 0, /* opt */ 1, /* attack */ true, /* sines */ true);
+  assert (ok);
+
+  auto wav_set = std::make_shared<WavSet>();
+
+  WavSetWave wave;
+  wave.midi_note = 69;
+  wave.channel = 0;
+  wave.velocity_range_min = 0;
+  wave.velocity_range_max = 127;
+  wave.audio = encoder.save_as_audio();
+  wave.audio->loop_type = Audio::LOOP_FRAME_FORWARD;
+  wave.audio->loop_start = wave.audio->contents.size() / 2;
+  wave.audio->loop_end = wave.audio->contents.size() - 1;
+  wav_set->waves.push_back (wave);
+
+  return wav_set;
+}
+
+static MorphWavSource *
+add_wav_source (Project& project, const std::shared_ptr<WavSet>& wav_set)
+{
+  MorphPlan& plan = *project.morph_plan();
+
+  auto wav_source = static_cast<MorphWavSource *> (MorphOperator::create ("SpectMorph::MorphWavSource", &plan));
+  plan.add_operator (wav_source, MorphPlan::ADD_POS_AUTO);
+
+  /* adding the operator starts a rebuild of the (empty) default instrument, wait for it */
+  const int object_id = wav_source->object_id();
+  while (project.rebuild_active (object_id))
+    usleep (10 * 1000);
+  project.try_update_synth();
+
+  /* use our wav set instead, without encoding it again */
+  std::shared_ptr<WavSet> new_wav_set = wav_set;
+  project.add_rebuild_result (object_id, new_wav_set); // swaps old and new wav set
+  return wav_source;
+}
+
+/* renders the same notes (some of them on the same key, so voices can share results) */
+static vector<float>
+render (const std::shared_ptr<WavSet>& wav_set, int n_threads)
+{
+  Project project;
+  project.set_random_seed (42);
+  project.set_mix_freq (48000);
+
+  /* replace the default plan */
+  MorphPlan& plan = *project.morph_plan();
+  while (!plan.operators().empty())
+    plan.remove (plan.operators().back());
+
+  auto output = static_cast<MorphOutput *> (MorphOperator::create ("SpectMorph::MorphOutput", &plan));
+  plan.add_operator (output, MorphPlan::ADD_POS_AUTO);
+
+  auto linear = static_cast<MorphLinear *> (MorphOperator::create ("SpectMorph::MorphLinear", &plan));
+  plan.add_operator (linear, MorphPlan::ADD_POS_AUTO);
+
+  linear->set_left_op (add_wav_source (project, wav_set));
+  linear->set_right_op (add_wav_source (project, wav_set));
+  linear->set_morphing (0.3);
+  output->set_channel_op (0, linear);
+
+  plan.emit_plan_changed();
+  project.try_update_synth();
+
+  MidiSynth& midi_synth = *project.midi_synth();
+  midi_synth.set_render_threads (n_threads);
+  assert (midi_synth.render_threads() == n_threads);
+
+  const size_t block_size = 256;
+  vector<float> samples, block (block_size);
+  for (int b = 0; b < 500; b++)
+    {
+      if (b == 0 || b == 30)
+        {
+          unsigned char note_on[3] = { 0x90, 69, 100 };
+          midi_synth.add_midi_event (b * 7 % block_size, note_on);
+        }
+      if (b == 10)
+        {
+          /* same key on two other channels at the same time: these voices play the same frames */
+          unsigned char note_on1[3] = { 0x91, 69, 80 };
+          unsigned char note_on2[3] = { 0x92, 69, 80 };
+          midi_synth.add_midi_event (17, note_on1);
+          midi_synth.add_midi_event (17, note_on2);
+        }
+      if (b == 20)
+        {
+          unsigned char note_on[3] = { 0x90, 64, 100 };
+          midi_synth.add_midi_event (100, note_on);
+        }
+      if (b == 300)
+        {
+          for (unsigned char ch = 0; ch < 3; ch++)
+            {
+              unsigned char note_off[3] = { uint8 (0x80 + ch), 69, 0 };
+              midi_synth.add_midi_event (50, note_off);
+            }
+        }
+      if (b == 350)
+        {
+          unsigned char note_off[3] = { 0x80, 64, 0 };
+          midi_synth.add_midi_event (0, note_off);
+        }
+      midi_synth.process (block.data(), block_size);
+      samples.insert (samples.end(), block.begin(), block.end());
+    }
+  return samples;
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  const char *srcdir = getenv ("srcdir"); // set by make check
+  const string filename = string (srcdir ? srcdir : ".") + "/saw440.wav";
+
+  WavData wav_data;
+  if (!wav_data.load (filename))
+    {
+      fprintf (stderr, "testrenderthreads: can't load %s: %s\n", filename.c_str(), wav_data.error_blurb());
+      return 1;
+    }
+  auto wav_set = encode_wav_set (wav_data);
+
+  /* the output must not depend on the number of render threads */
+  const vector<float> samples1 = render (wav_set, 1);
+  const vector<float> samples3 = render (wav_set, 3);
+
+  assert (samples1.size() == samples3.size());
+
+  double max_abs = 0, max_diff = 0;
+  for (size_t i = 0; i < samples1.size(); i++)
+    {
+      max_abs = std::max (max_abs, std::abs (double (samples1[i])));
+      max_diff = std::max (max_diff, std::abs (double (samples1[i]) - samples3[i]));
+    }
+  printf ("# testrenderthreads: max_abs %.5f, max_diff %g\n", max_abs, max_diff);
+  fflush (stdout);
+
+  assert (max_abs > 0.01);
+  /* voices are summed in a different order, so we can't expect bit exact results */
+  assert (max_diff < 1e-5);
+}
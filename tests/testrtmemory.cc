@@ -0,0 +1,193 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smrtmemory.hh"
+#include "smmain.hh"
+#include "smmath.hh"
+
+#include <assert.h>
+
+using namespace SpectMorph;
+
+using std::vector;
+
+static void
+test_view()
+{
+  RTMemoryArea rt_memory_area;
+
+  vector<uint16_t> vec { 1, 2, 3, 4 };
+
+  /* a view shares the data */
+  RTVector<uint16_t> view (&rt_memory_area);
+  view.assign_view (vec);
+
+  const RTVector<uint16_t>& const_view = view;
+  assert (view.borrowed());
+  assert (view.size() == 4);
+  assert (view.data() == vec.data());
+  assert (const_view[2] == 3);
+  assert (view.borrowed()); // const access doesn't copy
+
+  /* first non-const operator[] copies */
+  view[1] = 42;
+  assert (!view.borrowed());
+  assert (view.data() != vec.data());
+  assert (vec[1] == 2);
+  assert (view[0] == 1 && view[1] == 42 && view[2] == 3 && view[3] == 4);
+
+  /* first back() copies */
+  RTVector<uint16_t> view2 (&rt_memory_area);
+  view2.assign_view (vec);
+  view2.back() = 5;
+  assert (!view2.borrowed());
+  assert (vec[3] == 4);
+  assert (view2[3] == 5);
+}
+
+static void
+test_view_of_view()
+{
+  RTMemoryArea rt_memory_area;
+
+  vector<uint16_t> vec { 1, 2, 3, 4 };
+
+  RTVector<uint16_t> view (&rt_memory_area);
+  view.assign_view (vec);
+
+  RTVector<uint16_t> view2 (&rt_memory_area);
+  view2.assign_view (view);
+  assert (view2.borrowed() && view2.data() == vec.data());
+
+  RTVector<uint16_t> copy (&rt_memory_area);
+  copy.assign (view);
+  assert (copy.borrowed() && copy.data() == vec.data());
+
+  /* a modified vector is copied by assign() */
+  view[0] = 7;
+  RTVector<uint16_t> copy2 (&rt_memory_area);
+  copy2.assign (view);
+  assert (!copy2.borrowed() && copy2.data() != view.data());
+  assert (copy2[0] == 7);
+}
+
+static void
+test_float_cache()
+{
+  RTMemoryArea rt_memory_area;
+
+  Audio audio;
+  audio.contents.resize (1);
+
+  AudioBlock& block = audio.contents[0];
+  for (int i = 1; i <= 10; i++)
+    {
+      block.freqs.push_back (sm_freq2ifreq (i));
+      block.mags.push_back (sm_factor2idb (1.0 / i));
+    }
+  block.noise.resize (32);
+  audio.build_float_cache();
+
+  /* modify frame data after building the cache, so we can see which values are used */
+  const uint16_t ifreq_cached = block.freqs[0];
+  const uint16_t imag_cached = block.mags[0];
+  block.freqs[0] = sm_freq2ifreq (0.5);
+  block.mags[0] = sm_factor2idb (0.5);
+
+  RTAudioBlock rt_block (&rt_memory_area);
+  rt_block.assign_view (audio, 0);
+  assert (rt_block.freqs_f (0) == sm_ifreq2freq (ifreq_cached));
+  assert (rt_block.mags_f (0) == sm_idb2factor (imag_cached));
+
+  /* a view of the view also uses the cache */
+  RTAudioBlock rt_view (&rt_memory_area);
+  rt_view.assign_view (rt_block);
+  assert (rt_view.freqs_f (0) == sm_ifreq2freq (ifreq_cached));
+
+  /* after modification, the float cache must not be used anymore */
+  rt_block.freqs[1] = sm_freq2ifreq (2.5);
+  rt_block.mags[1] = sm_factor2idb (0.25);
+  assert (rt_block.freqs_f (0) == sm_ifreq2freq (block.freqs[0]));
+  assert (rt_block.freqs_f (1) == sm_ifreq2freq (sm_freq2ifreq (2.5)));
+  assert (rt_block.mags_f (0) == sm_idb2factor (block.mags[0]));
+  assert (rt_block.mags_f (1) == sm_idb2factor (sm_factor2idb (0.25)));
+
+  /* views of a modified block don't inherit the float cache */
+  RTAudioBlock rt_view2 (&rt_memory_area);
+  rt_view2.assign_view (rt_block);
+  assert (rt_view2.freqs_f (1) == sm_ifreq2freq (sm_freq2ifreq (2.5)));
+  assert (rt_view2.mags_f (1) == sm_idb2factor (sm_factor2idb (0.25)));
+}
+
+static void
+test_sort_freqs()
+{
+  RTMemoryArea rt_memory_area;
+
+  AudioBlock block;
+  for (int i = 1; i <= 10; i++)
+    {
+      block.freqs.push_back (sm_freq2ifreq (i));
+      block.mags.push_back (sm_factor2idb (1.0 / i));
+    }
+
+  /* sorting already sorted data must not copy the view */
+  RTAudioBlock rt_block (&rt_memory_area);
+  rt_block.assign_view (block);
+  rt_block.sort_freqs();
+  assert (rt_block.freqs.borrowed() && rt_block.mags.borrowed());
+
+  /* unsorted data is copied and sorted */
+  std::swap (block.freqs[2], block.freqs[5]);
+  std::swap (block.mags[2], block.mags[5]);
+
+  RTAudioBlock rt_block2 (&rt_memory_area);
+  rt_block2.assign_view (block);
+  rt_block2.sort_freqs();
+  assert (!rt_block2.freqs.borrowed() && !rt_block2.mags.borrowed());
+  for (int i = 0; i < 10; i++)
+    {
+      assert (rt_block2.freqs[i] == sm_freq2ifreq (i + 1));
+      assert (rt_block2.mags[i] == sm_factor2idb (1.0 / (i + 1)));
+    }
+  assert (block.freqs[2] == sm_freq2ifreq (6));
+}
+
+static void
+test_keep_loudest_partials()
+{
+  RTMemoryArea rt_memory_area;
+
+  AudioBlock block;
+  const vector<double> mags { 0.1, 0.5, 0.2, 0.5, 0.9, 0.5, 0.3 };
+  for (size_t i = 0; i < mags.size(); i++)
+    {
+      block.freqs.push_back (sm_freq2ifreq (i + 1));
+      block.mags.push_back (sm_factor2idb (mags[i]));
+    }
+
+  RTAudioBlock rt_block (&rt_memory_area);
+  rt_block.assign_view (block);
+  rt_block.keep_loudest_partials (10);
+  assert (rt_block.freqs.borrowed() && rt_block.freqs.size() == 7);
+
+  /* loudest partials stay in frequency order, partials with equal magnitude are kept while there is room */
+  rt_block.keep_loudest_partials (3);
+  assert (rt_block.freqs.size() == 3 && rt_block.mags.size() == 3);
+  assert (rt_block.freqs[0] == sm_freq2ifreq (2));
+  assert (rt_block.freqs[1] == sm_freq2ifreq (4));
+  assert (rt_block.freqs[2] == sm_freq2ifreq (5));
+  assert (rt_block.mags[2] == sm_factor2idb (0.9));
+  assert (block.freqs.size() == 7);
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  test_view();
+  test_view_of_view();
+  test_float_cache();
+  test_sort_freqs();
+  test_keep_loudest_partials();
+}